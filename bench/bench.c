@@ -0,0 +1,397 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// bench - Times the stages of the compiler on generated sources of growing sizes
+
+// Every stage is timed on its own, on sources 1x, 10x and 100x (by default) the base size,
+// so that anything which does not scale linearly shows up as growing time per byte.
+// Each size is measured in a separate process, so that the peak RSS belongs to that size only.
+//
+// Allocations are counted by wrapping malloc and friends at link time (see the Makefile).
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+
+#include "generator.h"
+
+#include "lexer/lexer.h"
+#include "lexer/token_list.h"
+#include "parser/parser.h"
+#include "resolver/resolver.h"
+#include "ast/ast.h"
+
+#define DEFAULT_BASE_KIB 256
+#define DEFAULT_REPEATS 3
+#define MAX_FACTORS 8
+#define GENERATOR_SEED 1
+
+// Counters of the wrapped allocation functions
+static size_t _num_allocs = 0;
+static size_t _allocated_bytes = 0;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t num, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    _num_allocs += 1;
+    _allocated_bytes += size;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t num, size_t size) {
+    _num_allocs += 1;
+    _allocated_bytes += num * size;
+    return __real_calloc(num, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    _num_allocs += 1;
+    _allocated_bytes += size;
+    return __real_realloc(ptr, size);
+}
+
+enum _stage_t {
+    STAGE_LEX = 0,      // lexer_process_source_code
+    STAGE_PARSE,        // parser_process_token_list
+    STAGE_PULL,         // lexing and parsing together, the parser pulling tokens from the lexer
+    STAGE_RESOLVE,      // resolver_process_ast
+    STAGE_LEX_OUTPUT,   // lexer_write_output
+    STAGE_PARSE_OUTPUT, // parser_write_output
+    STAGES_NUM
+};
+
+static const char* _stage_names[] = {
+    [STAGE_LEX] = "lex",
+    [STAGE_PARSE] = "parse",
+    [STAGE_PULL] = "lex+parse",
+    [STAGE_RESOLVE] = "resolve",
+    [STAGE_LEX_OUTPUT] = "lex-output",
+    [STAGE_PARSE_OUTPUT] = "parse-output",
+};
+
+// Result of one stage on one size (best of the repeats)
+struct _result_t {
+    unsigned int stage;
+    unsigned int factor;
+    size_t bytes;
+    size_t tokens;
+    double seconds;
+    size_t allocs;
+    size_t alloc_bytes;
+    long peak_rss_kib;
+};
+
+double _now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+long _peak_rss_kib() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Runs one stage repeats times on the source, keeping the fastest run
+// Every run starts from scratch, whatever the previous stages produced is made again (but not timed)
+void _run_stage(unsigned int stage, const char* source, int repeats, FILE* devnull, struct _result_t* result) {
+    result->seconds = -1.0;
+
+    for(int r = 0; r < repeats; r++) {
+        ast_global_scope_t* ast = ast_global_scope_make();
+        lexer_token_list_t* list = lexer_token_list_make();
+        resolver_symbols_t* symbols = resolver_symbols_make();
+
+        if(stage != STAGE_LEX && stage != STAGE_PULL) {
+            lexer_process_source_code(source, ast->names, list);
+        }
+
+        if(stage == STAGE_PARSE_OUTPUT || stage == STAGE_RESOLVE) {
+            parser_process_token_list(list, ast);
+        }
+
+        size_t allocs_before = _num_allocs;
+        size_t bytes_before = _allocated_bytes;
+        double start = _now();
+
+        switch(stage) {
+            case STAGE_LEX: {
+                lexer_process_source_code(source, ast->names, list);
+                break;
+            }
+
+            case STAGE_PARSE: {
+                parser_process_token_list(list, ast);
+                break;
+            }
+
+            case STAGE_PULL: {
+                lexer_state_t lexer;
+                lexer_state_init(&lexer, source, ast->names);
+
+                lexer_token_iterator_t iter;
+                lexer_token_iter_from_lexer(&lexer, &iter);
+
+                parser_process_tokens(&iter, ast);
+                break;
+            }
+
+            case STAGE_RESOLVE: {
+                resolver_process_ast(ast, symbols);
+                break;
+            }
+
+            case STAGE_LEX_OUTPUT: {
+                lexer_write_output(devnull, list);
+                fflush(devnull);
+                break;
+            }
+
+            case STAGE_PARSE_OUTPUT: {
+                parser_write_output(devnull, ast);
+                fflush(devnull);
+                break;
+            }
+
+            default:
+                break;
+        }
+
+        double seconds = _now() - start;
+
+        if(result->seconds < 0 || seconds < result->seconds) {
+            result->seconds = seconds;
+            result->allocs = _num_allocs - allocs_before;
+            result->alloc_bytes = _allocated_bytes - bytes_before;
+        }
+
+        // The pull stage never makes the list, take the number of tokens from a separate lexing
+        if(list->num_tokens == 0) {
+            lexer_process_source_code(source, ast->names, list);
+        }
+        result->tokens = list->num_tokens;
+
+        resolver_symbols_destroy(symbols);
+        lexer_token_list_destroy(list);
+        ast_global_scope_destroy(ast);
+    }
+
+    result->stage = stage;
+    result->peak_rss_kib = _peak_rss_kib();
+}
+
+// Child process: measures all the stages on one size, writes the results to fd
+void _run_size(unsigned int factor, size_t base_size, int repeats, int fd) {
+    size_t length = 0;
+    char* source = bench_generate_source(base_size * factor, GENERATOR_SEED, &length);
+
+    FILE* devnull = fopen("/dev/null", "w");
+
+    for(unsigned int stage = 0; stage < STAGES_NUM; stage++) {
+        struct _result_t result;
+        _run_stage(stage, source, repeats, devnull, &result);
+
+        result.factor = factor;
+        result.bytes = length;
+
+        if(write(fd, &result, sizeof(result)) != (ssize_t) sizeof(result)) break;
+    }
+
+    fclose(devnull);
+    free(source);
+}
+
+// Looks up the speed of the same stage and size in the baseline file, returns MB/s or -1 if not found
+double _baseline_speed(FILE* baseline, struct _result_t* result) {
+    if(baseline == NULL) return -1.0;
+
+    rewind(baseline);
+
+    char stage[64];
+    unsigned int factor = 0;
+    double mb_per_s = 0.0;
+
+    char line[256];
+    while(fgets(line, sizeof(line), baseline) != NULL) {
+        if(sscanf(line, "%63s %u %lf", stage, &factor, &mb_per_s) != 3) continue;
+
+        if(factor == result->factor && strcmp(stage, _stage_names[result->stage]) == 0) {
+            return mb_per_s;
+        }
+    }
+
+    return -1.0;
+}
+
+// Writes the machine and the settings of the run as a comment, results are only comparable with the same ones
+void _write_machine(FILE* out, size_t base_size, int repeats) {
+    struct utsname name;
+    if(uname(&name) != 0) strcpy(name.machine, "unknown");
+
+    // Linux names the CPU in /proc/cpuinfo, elsewhere it stays unknown
+    char cpu[128] = "unknown";
+    char line[256];
+    FILE* cpuinfo = fopen("/proc/cpuinfo", "r");
+    while(cpuinfo != NULL && fgets(line, sizeof(line), cpuinfo) != NULL) {
+        char* colon = strchr(line, ':');
+        if(strncmp(line, "model name", 10) == 0 && colon != NULL) {
+            snprintf(cpu, sizeof(cpu), "%s", colon + 2);
+            cpu[strcspn(cpu, "\n")] = '\0';
+            break;
+        }
+    }
+    if(cpuinfo != NULL) fclose(cpuinfo);
+
+#ifdef __OPTIMIZE__
+    const char* optimized = "optimized";
+#else
+    const char* optimized = "not optimized";
+#endif
+
+    fprintf(out, "# %s, %s, %ld CPUs, %s; compiler %s, %s; base %zu KiB, best of %d\n", cpu, name.machine,
+        sysconf(_SC_NPROCESSORS_ONLN), name.release, __VERSION__, optimized, base_size / 1024, repeats);
+}
+
+void _print_bench_usage_and_exit() {
+    puts("bench - Benchmark of the compiler stages on generated sources");
+    puts("Usage: bench [-k <KiB>] [-x <factor>]... [-r <repeats>] [-b <baseline file>] [-o <results file>]");
+    puts("\t-k <KiB>\t- base size of the generated source (default: 256)");
+    puts("\t-x <factor>\t- size to measure, as a multiple of the base size (default: 1, 10 and 100)");
+    puts("\t-r <repeats>\t- number of runs of every stage, the fastest one counts (default: 3)");
+    puts("\t-b <filename>\t- results file from an earlier run to compare against");
+    puts("\t-o <filename>\t- write the results to the file as well, to be used as a baseline later");
+    exit(0);
+}
+
+int main(int argc, char** argv) {
+    size_t base_size = (size_t) DEFAULT_BASE_KIB * 1024;
+    int repeats = DEFAULT_REPEATS;
+    unsigned int factors[MAX_FACTORS];
+    size_t num_factors = 0;
+    FILE* baseline = NULL;
+    FILE* results = NULL;
+
+    int c = 0;
+    while((c = getopt(argc, argv, "hk:x:r:b:o:")) != -1) {
+        switch(c) {
+            case 'k': base_size = (size_t) strtoul(optarg, NULL, 10) * 1024; break;
+            case 'r': repeats = atoi(optarg); break;
+
+            case 'x': {
+                if(num_factors < MAX_FACTORS) factors[num_factors++] = (unsigned int) strtoul(optarg, NULL, 10);
+                break;
+            }
+
+            case 'b': {
+                baseline = fopen(optarg, "r");
+                if(baseline == NULL) fprintf(stderr, "[bench] Warning: cannot open baseline file %s, not comparing\n", optarg);
+                break;
+            }
+
+            case 'o': {
+                results = fopen(optarg, "w");
+                if(results == NULL) {
+                    fprintf(stderr, "[bench] Error: cannot open file %s for writing\n", optarg);
+                    return 1;
+                }
+                break;
+            }
+
+            default:
+                _print_bench_usage_and_exit();
+        }
+    }
+
+    if(num_factors == 0) {
+        factors[0] = 1;
+        factors[1] = 10;
+        factors[2] = 100;
+        num_factors = 3;
+    }
+
+    if(repeats < 1) repeats = 1;
+
+    printf("%-13s %6s %10s %10s %10s %10s %12s %12s %10s %10s\n",
+        "stage", "factor", "MB", "MB/s", "Mtok/s", "ns/byte", "allocs", "alloc MB", "peak MB", "vs base");
+
+    if(results != NULL) {
+        _write_machine(results, base_size, repeats);
+        fprintf(results, "# stage factor MB/s tokens/s allocs peak_rss_kib\n");
+    }
+
+    for(size_t f = 0; f < num_factors; f++) {
+        int fds[2];
+        if(pipe(fds) != 0) {
+            fprintf(stderr, "[bench] Error: cannot create a pipe\n");
+            return 1;
+        }
+
+        fflush(stdout);
+
+        pid_t pid = fork();
+        if(pid == 0) {
+            close(fds[0]);
+            _run_size(factors[f], base_size, repeats, fds[1]);
+            close(fds[1]);
+            _exit(0);
+        }
+
+        close(fds[1]);
+
+        struct _result_t result;
+        while(read(fds[0], &result, sizeof(result)) == (ssize_t) sizeof(result)) {
+            double mb = (double) result.bytes / 1e6;
+            double mb_per_s = mb / result.seconds;
+            double tokens_per_s = (double) result.tokens / result.seconds;
+
+            char comparison[32] = "-";
+            double baseline_speed = _baseline_speed(baseline, &result);
+            if(baseline_speed > 0) {
+                snprintf(comparison, sizeof(comparison), "%+.1f%%", (mb_per_s / baseline_speed - 1.0) * 100.0);
+            }
+
+            printf("%-13s %5ux %10.2f %10.2f %10.2f %10.2f %12zu %12.2f %10.2f %10s\n",
+                _stage_names[result.stage], result.factor, mb, mb_per_s, tokens_per_s / 1e6,
+                result.seconds * 1e9 / (double) result.bytes, result.allocs,
+                (double) result.alloc_bytes / 1e6, (double) result.peak_rss_kib / 1024.0, comparison
+            );
+
+            if(results != NULL) {
+                fprintf(results, "%s %u %.3f %.0f %zu %ld\n", _stage_names[result.stage], result.factor,
+                    mb_per_s, tokens_per_s, result.allocs, result.peak_rss_kib);
+            }
+        }
+
+        close(fds[0]);
+        waitpid(pid, NULL, 0);
+    }
+
+    if(baseline != NULL) fclose(baseline);
+    if(results != NULL) fclose(results);
+
+    return 0;
+}
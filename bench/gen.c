@@ -0,0 +1,41 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// gen - Writes a generated decrout source of given size to stdout
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "generator.h"
+
+int main(int argc, char** argv) {
+    if(argc < 2) {
+        fprintf(stderr, "Usage: gen <size in KiB> [seed]\n");
+        return 1;
+    }
+
+    size_t size = (size_t) strtoul(argv[1], NULL, 10) * 1024;
+    uint32_t seed = argc > 2 ? (uint32_t) strtoul(argv[2], NULL, 10) : 1;
+
+    size_t length = 0;
+    char* source = bench_generate_source(size, seed, &length);
+
+    fwrite(source, 1, length, stdout);
+    free(source);
+
+    return 0;
+}
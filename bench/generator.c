@@ -0,0 +1,228 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// generator - Deterministic generator of large, valid decrout sources for benchmarks
+
+#include "generator.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Deepest nesting of generated types
+#define MAX_TYPE_DEPTH 4
+
+static const char* _builtin_names[] = {
+    "void", "bool", "char", "u8", "i8", "u16", "i16", "u32", "i32", "u64", "i64"
+};
+#define BUILTIN_NAMES_NUM (sizeof(_builtin_names) / sizeof(_builtin_names[0]))
+
+static const char* _operators[] = {
+    "+", "-", "*", "/", "&", "|", "^", "==", "<>", "<=", ">=", "&&", "||"
+};
+#define OPERATORS_NUM (sizeof(_operators) / sizeof(_operators[0]))
+
+static const char* _comment_words[] = {
+    "routine", "pointer", "declaration", "value", "global", "scope", "symbol", "type", "the", "of"
+};
+#define COMMENT_WORDS_NUM (sizeof(_comment_words) / sizeof(_comment_words[0]))
+
+// Output buffer together with the state of the generator
+struct _generator_t {
+    char* buffer;
+    size_t length;
+    size_t alloc;
+    uint32_t rng;           // xorshift32 state, never 0
+    size_t num_symbols;     // Symbols declared so far, initializers refer to those
+};
+
+uint32_t _random(struct _generator_t* g) {
+    uint32_t x = g->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    g->rng = x;
+    return x;
+}
+
+// Random number from 0 to n - 1
+uint32_t _random_below(struct _generator_t* g, uint32_t n) {
+    return _random(g) % n;
+}
+
+void _emit(struct _generator_t* g, const char* str, size_t length) {
+    if(g->length + length + 1 > g->alloc) {
+        while(g->length + length + 1 > g->alloc) {
+            g->alloc *= 2;
+        }
+        g->buffer = realloc(g->buffer, g->alloc);
+    }
+
+    memcpy(g->buffer + g->length, str, length);
+    g->length += length;
+    g->buffer[g->length] = '\0';
+}
+
+void _emit_str(struct _generator_t* g, const char* str) {
+    _emit(g, str, strlen(str));
+}
+
+void _emit_symbol(struct _generator_t* g, size_t index) {
+    char symbol[32];
+    int length = snprintf(symbol, sizeof(symbol), "sym_%zu", index);
+    _emit(g, symbol, (size_t) length);
+}
+
+void _emit_type(struct _generator_t* g, int depth) {
+    uint32_t kind = depth >= MAX_TYPE_DEPTH ? 0 : _random_below(g, 6);
+
+    switch(kind) {
+        // Pointer
+        case 1:
+        case 2: {
+            _emit_str(g, ">");
+            _emit_type(g, depth + 1);
+            break;
+        }
+
+        // Routine, with or without arguments
+        case 3: {
+            _emit_str(g, "rt");
+
+            uint32_t num_args = _random_below(g, 4);
+            if(num_args > 0) {
+                _emit_str(g, " [");
+                for(uint32_t i = 0; i < num_args; i++) {
+                    if(i != 0) _emit_str(g, ", ");
+                    _emit_type(g, depth + 1);
+                }
+                _emit_str(g, "]");
+            }
+
+            _emit_str(g, ": ");
+            _emit_type(g, depth + 1);
+            break;
+        }
+
+        // Builtin
+        default: {
+            _emit_str(g, _builtin_names[_random_below(g, BUILTIN_NAMES_NUM)]);
+            break;
+        }
+    }
+}
+
+void _emit_operand(struct _generator_t* g) {
+    char literal[64];
+    int length = 0;
+
+    switch(_random_below(g, 8)) {
+        case 0: length = snprintf(literal, sizeof(literal), "%u", _random(g)); break;
+        case 1: length = snprintf(literal, sizeof(literal), "0x%X", _random(g)); break;
+        case 2: length = snprintf(literal, sizeof(literal), "0%o", _random_below(g, 4096)); break;
+        case 3: length = snprintf(literal, sizeof(literal), "0b%d%d%d1", (int) _random_below(g, 2), (int) _random_below(g, 2), (int) _random_below(g, 2)); break;
+        case 4: length = snprintf(literal, sizeof(literal), "\"string %u with \\\"escapes\\\"\"", _random_below(g, 1000)); break;
+        case 5: length = snprintf(literal, sizeof(literal), "'%c'", 'a' + (char) _random_below(g, 26)); break;
+
+        // Symbols declared earlier
+        default: {
+            if(g->num_symbols == 0) {
+                length = snprintf(literal, sizeof(literal), "%u", _random_below(g, 100));
+            } else {
+                length = snprintf(literal, sizeof(literal), "sym_%zu", (size_t) _random_below(g, (uint32_t) g->num_symbols));
+            }
+            break;
+        }
+    }
+
+    _emit(g, literal, (size_t) length);
+}
+
+void _emit_expression(struct _generator_t* g, int depth) {
+    uint32_t num_operands = 1 + _random_below(g, 4);
+
+    for(uint32_t i = 0; i < num_operands; i++) {
+        if(i != 0) {
+            _emit_str(g, " ");
+            _emit_str(g, _operators[_random_below(g, OPERATORS_NUM)]);
+            _emit_str(g, " ");
+        }
+
+        if(depth < 2 && _random_below(g, 5) == 0) {
+            _emit_str(g, "(");
+            _emit_expression(g, depth + 1);
+            _emit_str(g, ")");
+        } else {
+            _emit_operand(g);
+        }
+    }
+}
+
+void _emit_comment(struct _generator_t* g) {
+    _emit_str(g, "#");
+
+    uint32_t num_words = 3 + _random_below(g, 10);
+    for(uint32_t i = 0; i < num_words; i++) {
+        _emit_str(g, " ");
+        _emit_str(g, _comment_words[_random_below(g, COMMENT_WORDS_NUM)]);
+    }
+
+    _emit_str(g, "\n");
+}
+
+void _emit_declaration(struct _generator_t* g) {
+    _emit_str(g, _random_below(g, 2) == 0 ? "const " : "decl ");
+    _emit_symbol(g, g->num_symbols);
+
+    // Either the type, the initializer or both
+    uint32_t form = _random_below(g, 3);
+
+    if(form != 2) {
+        _emit_str(g, ": ");
+        _emit_type(g, 0);
+    }
+
+    if(form != 0) {
+        _emit_str(g, " = ");
+        _emit_expression(g, 0);
+    }
+
+    _emit_str(g, ";\n");
+
+    g->num_symbols += 1;
+}
+
+char* bench_generate_source(size_t size, uint32_t seed, size_t* length_ptr) {
+    struct _generator_t g;
+    g.alloc = size + 4096;
+    g.buffer = malloc(g.alloc);
+    g.buffer[0] = '\0';
+    g.length = 0;
+    g.rng = seed != 0 ? seed : 1;
+    g.num_symbols = 0;
+
+    while(g.length < size) {
+        switch(_random_below(&g, 10)) {
+            case 0: _emit_comment(&g); break;
+            case 1: _emit_str(&g, "\n"); break;
+            default: _emit_declaration(&g); break;
+        }
+    }
+
+    *length_ptr = g.length;
+    return g.buffer;
+}
@@ -0,0 +1,33 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// generator - Deterministic generator of large, valid decrout sources for benchmarks
+
+// The generated code consists of global const/decl declarations with nested pointer
+// and routine types, initializers made of literals, identifiers and operators,
+// and comments in between. The same size and seed always give the same source.
+
+#ifndef _I_BENCH_GENERATOR_H_
+#define _I_BENCH_GENERATOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Returns a malloc'ed, null-terminated source of at least size bytes (it always ends
+// with a whole declaration), the actual length is stored in length_ptr
+char* bench_generate_source(size_t size, uint32_t seed, size_t* length_ptr);
+
+#endif
@@ -21,16 +21,177 @@
 #include <stdlib.h>
 
 #include "decl_list.h"
+#include "expr_list.h"
+#include "types/types.h"
+#include "types/type_table.h"
+#include "utils/intern.h"
+#include "utils/strbuf.h"
 
-ast_global_scope_t* ast_global_scope_make() {
+// Makes the scope with the given table of names
+ast_global_scope_t* _ast_global_scope_make_with(utils_intern_table_t* names) {
     ast_global_scope_t* ast = malloc(sizeof(ast_global_scope_t));
 
-    ast->decls = ast_decl_list_make();
+    ast_decl_vec_init(&(ast->decls));
+    ast->names = names;
+    ast->types = type_table_make();
+    ast->is_part = 0;
+
+    ast_expr_vec_init(&(ast->exprs));
+    ast_index_vec_init(&(ast->expr_args));
+    ast_stmt_vec_init(&(ast->stmts));
+    ast_routine_vec_init(&(ast->routines));
+    ast_decl_vec_init(&(ast->locals));
+    utils_strbuf_init(&(ast->literals));
 
     return ast;
 }
 
+ast_global_scope_t* ast_global_scope_make() {
+    // Builtin types are resolved by the ids of their names, so those go in first
+    utils_intern_table_t* names = utils_intern_table_make();
+    type_intern_builtins(names);
+
+    return _ast_global_scope_make_with(names);
+}
+
+ast_global_scope_t* ast_global_scope_make_part(ast_global_scope_t* whole) {
+    ast_global_scope_t* part = _ast_global_scope_make_with(whole->names);
+    part->is_part = 1;
+
+    return part;
+}
+
 void ast_global_scope_destroy(ast_global_scope_t* ast) {
-    ast_decl_list_destroy(ast->decls);
+    ast_decl_vec_deinit(&(ast->decls));
+    if(!ast->is_part) utils_intern_table_destroy(ast->names);
+    type_table_destroy(ast->types);
+
+    ast_expr_vec_deinit(&(ast->exprs));
+    ast_index_vec_deinit(&(ast->expr_args));
+    ast_stmt_vec_deinit(&(ast->stmts));
+    ast_routine_vec_deinit(&(ast->routines));
+    ast_decl_vec_deinit(&(ast->locals));
+    utils_strbuf_deinit(&(ast->literals));
+
     free(ast);
 }
+
+// Shifts the ids of a declaration of a part, base is the number of expressions before the part
+void _ast_shift_decl(ast_decl_t* decl, const type_id_t* type_ids, uint32_t expr_base) {
+    if(decl->type != TYPE_ID_NONE) decl->type = type_ids[decl->type];
+    if(decl->value != AST_EXPR_NONE) decl->value += expr_base;
+}
+
+void ast_global_scope_merge(ast_global_scope_t* ast, const ast_global_scope_t* part) {
+    type_id_t* type_ids = malloc((part->types->num_types + 1) * sizeof(type_id_t));
+    type_table_merge(ast->types, part->types, type_ids);
+
+    uint32_t expr_base = (uint32_t) UTILS_VEC_LENGTH(&(ast->exprs));
+    uint32_t args_base = (uint32_t) UTILS_VEC_LENGTH(&(ast->expr_args));
+    uint32_t stmt_base = (uint32_t) UTILS_VEC_LENGTH(&(ast->stmts));
+    uint32_t routine_base = (uint32_t) UTILS_VEC_LENGTH(&(ast->routines));
+    uint32_t local_base = (uint32_t) UTILS_VEC_LENGTH(&(ast->locals));
+    uint32_t literal_base = (uint32_t) UTILS_STRBUF_LENGTH(&(ast->literals));
+
+    // Everything is appended as it is, then only the new elements are shifted in place
+    ast_decl_vec_append(&(ast->decls), part->decls.arr, UTILS_VEC_LENGTH(&(part->decls)));
+    ast_decl_vec_append(&(ast->locals), part->locals.arr, UTILS_VEC_LENGTH(&(part->locals)));
+    ast_expr_vec_append(&(ast->exprs), part->exprs.arr, UTILS_VEC_LENGTH(&(part->exprs)));
+    ast_index_vec_append(&(ast->expr_args), part->expr_args.arr, UTILS_VEC_LENGTH(&(part->expr_args)));
+    ast_stmt_vec_append(&(ast->stmts), part->stmts.arr, UTILS_VEC_LENGTH(&(part->stmts)));
+    ast_routine_vec_append(&(ast->routines), part->routines.arr, UTILS_VEC_LENGTH(&(part->routines)));
+    if(UTILS_STRBUF_LENGTH(&(part->literals)) != 0) {
+        utils_strbuf_append(&(ast->literals), UTILS_STRBUF_DATA(&(part->literals)), UTILS_STRBUF_LENGTH(&(part->literals)));
+    }
+
+    for(size_t idx = UTILS_VEC_LENGTH(&(ast->decls)) - UTILS_VEC_LENGTH(&(part->decls)); idx < UTILS_VEC_LENGTH(&(ast->decls)); idx++) {
+        _ast_shift_decl(&UTILS_VEC_AT(&(ast->decls), idx), type_ids, expr_base);
+    }
+
+    for(size_t idx = local_base; idx < UTILS_VEC_LENGTH(&(ast->locals)); idx++) {
+        _ast_shift_decl(&UTILS_VEC_AT(&(ast->locals), idx), type_ids, expr_base);
+    }
+
+    for(size_t idx = expr_base; idx < UTILS_VEC_LENGTH(&(ast->exprs)); idx++) {
+        ast_expr_t* expr = AST_EXPR_GET(ast, idx);
+
+        switch(expr->kind) {
+            case AST_EXPR_STRING:
+            case AST_EXPR_CHAR: expr->left += literal_base; break;
+            case AST_EXPR_UNARY:
+            case AST_EXPR_MEMBER: expr->left += expr_base; break;
+            case AST_EXPR_BINARY: expr->left += expr_base; expr->right += expr_base; break;
+            case AST_EXPR_ROUTINE: expr->left += routine_base; break;
+
+            // Args are shifted through the calls, the counts in front of them stay as they are
+            case AST_EXPR_CALL: {
+                expr->left += expr_base;
+                expr->right += args_base;
+
+                uint32_t num_args = UTILS_VEC_AT(&(ast->expr_args), expr->right);
+                for(uint32_t i = 1; i <= num_args; i++) {
+                    UTILS_VEC_AT(&(ast->expr_args), expr->right + i) += expr_base;
+                }
+                break;
+            }
+
+            default: break;
+        }
+    }
+
+    for(size_t idx = stmt_base; idx < UTILS_VEC_LENGTH(&(ast->stmts)); idx++) {
+        ast_stmt_t* stmt = &UTILS_VEC_AT(&(ast->stmts), idx);
+
+        if(stmt->kind == AST_STMT_DECL) {
+            stmt->value += local_base;
+        } else if(stmt->value != AST_EXPR_NONE) {
+            stmt->value += expr_base;
+        }
+    }
+
+    for(size_t idx = routine_base; idx < UTILS_VEC_LENGTH(&(ast->routines)); idx++) {
+        ast_routine_t* routine = &UTILS_VEC_AT(&(ast->routines), idx);
+
+        routine->type = type_ids[routine->type];
+        routine->first_param += local_base;
+        routine->first_stmt += stmt_base;
+    }
+
+    free(type_ids);
+}
+
+ast_expr_id_t ast_add_expr(ast_global_scope_t* ast, ast_expr_t expr) {
+    ast_expr_id_t id = (ast_expr_id_t) UTILS_VEC_LENGTH(&(ast->exprs));
+    ast_expr_vec_push(&(ast->exprs), expr);
+
+    return id;
+}
+
+static const char* _ast_expr_op_strings[AST_EXPR_OPS_NUM] = {
+    [AST_EXPR_OP_NEG] = "-",
+    [AST_EXPR_OP_BIT_NOT] = "~",
+    [AST_EXPR_OP_LOG_NOT] = "!",
+    [AST_EXPR_OP_DEREF] = "@",
+    [AST_EXPR_OP_ADDR] = "$",
+    [AST_EXPR_OP_INDEX] = "@",
+    [AST_EXPR_OP_MUL] = "*",
+    [AST_EXPR_OP_DIV] = "/",
+    [AST_EXPR_OP_ADD] = "+",
+    [AST_EXPR_OP_SUB] = "-",
+    [AST_EXPR_OP_LT] = "<",
+    [AST_EXPR_OP_GT] = ">",
+    [AST_EXPR_OP_LT_EQ] = "<=",
+    [AST_EXPR_OP_GT_EQ] = ">=",
+    [AST_EXPR_OP_EQ] = "==",
+    [AST_EXPR_OP_NOT_EQ] = "<>",
+    [AST_EXPR_OP_BIT_AND] = "&",
+    [AST_EXPR_OP_BIT_XOR] = "^",
+    [AST_EXPR_OP_BIT_OR] = "|",
+    [AST_EXPR_OP_LOG_AND] = "&&",
+    [AST_EXPR_OP_LOG_OR] = "||",
+    [AST_EXPR_OP_ASSIGN] = "=",
+};
+
+const char* ast_expr_op_string(ast_expr_op_t op) {
+    return (size_t) op < AST_EXPR_OPS_NUM ? _ast_expr_op_strings[op] : "?";
+}
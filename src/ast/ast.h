@@ -16,39 +16,170 @@
 
 // ast - AST structures, used during parsing
 
-// All of the structures here own all their data, unless otherwise noted (for example - for static builtin type infos)
-// this means that destruction should free all owned resources
+// All of the structures here are kept in the arrays of the global scope, one array per kind of node, and they refer
+// to each other, to their types (in the table of types) and to their symbols (in the table of names) only by 32-bit ids.
+// There are no pointers inside of the nodes, so the arrays can be written out and read back as they are (any change
+// to the nodes is a change of the binary format, see io/binfile.h), and passes over the AST are scans of those arrays.
+// Nothing is freed one by one - destroying the global scope frees everything at once
 // The topmost structure should be the ast_global_scope_t
 
 #ifndef _I_AST_AST_H_
 #define _I_AST_AST_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include "types/types.h"
+#include "types/type_table.h"
+#include "utils/intern.h"
+#include "utils/strbuf.h"
 #include "decl_list.h"
+#include "expr_list.h"
+
+// Expressions are not a tree of separately allocated nodes, but flat nodes stored one after another
+// in a single array of the global scope and referred to by their indices (ast_expr_id_t).
+// Operands are always added before the nodes which use them, so every node refers only to
+// nodes with lower ids and the whole array can be walked in order without any recursion.
+typedef uint32_t ast_expr_id_t;
+
+#define AST_EXPR_NONE UINT32_MAX
+
+enum ast_expr_kind_t {
+    AST_EXPR_INTEGER = 0,   // Numeric literal, left and right are the low and the high half of the value
+    AST_EXPR_STRING,        // String literal, left is the offset of its text (with quotes) in literals, right its length
+    AST_EXPR_CHAR,          // Char literal, same as string literal
+    AST_EXPR_SYMBOL,        // Symbol, left is the id of its name
+    AST_EXPR_UNARY,         // Operation op on left
+    AST_EXPR_BINARY,        // Operation op on left and right
+    AST_EXPR_CALL,          // Call of left, the args are in expr_args from right, preceded by their number
+    AST_EXPR_MEMBER,        // Member of left, right is the id of its name
+    AST_EXPR_ROUTINE,       // Routine literal, left is the index in routines
+};
+typedef enum ast_expr_kind_t ast_expr_kind_t;
+
+enum ast_expr_op_t {
+    // Unary, prefix
+    AST_EXPR_OP_NEG = 0,    // -
+    AST_EXPR_OP_BIT_NOT,    // ~
+    AST_EXPR_OP_LOG_NOT,    // !
+    // Unary, postfix
+    AST_EXPR_OP_DEREF,      // @
+    AST_EXPR_OP_ADDR,       // $
+    // Binary
+    AST_EXPR_OP_INDEX,      // @, value at left offset by right elements
+    AST_EXPR_OP_MUL,        // *
+    AST_EXPR_OP_DIV,        // /
+    AST_EXPR_OP_ADD,        // +
+    AST_EXPR_OP_SUB,        // -
+    AST_EXPR_OP_LT,         // <
+    AST_EXPR_OP_GT,         // >
+    AST_EXPR_OP_LT_EQ,      // <=
+    AST_EXPR_OP_GT_EQ,      // >=
+    AST_EXPR_OP_EQ,         // ==
+    AST_EXPR_OP_NOT_EQ,     // <>
+    AST_EXPR_OP_BIT_AND,    // &
+    AST_EXPR_OP_BIT_XOR,    // ^
+    AST_EXPR_OP_BIT_OR,     // |
+    AST_EXPR_OP_LOG_AND,    // &&
+    AST_EXPR_OP_LOG_OR,     // ||
+    AST_EXPR_OP_ASSIGN,     // =, also evaluates to the assigned value
+#define AST_EXPR_OPS_NUM (AST_EXPR_OP_ASSIGN + 1)
+};
+typedef enum ast_expr_op_t ast_expr_op_t;
+
+// A node of an expression, 20 bytes
+struct ast_expr_t {
+    uint8_t kind;           // ast_expr_kind_t
+    uint8_t op;             // ast_expr_op_t of unary and binary operations
+    uint16_t reserved;
+    uint32_t line_ref;      // Position of the first token of the node (of the operator for operations)
+    uint32_t char_ref;
+    uint32_t left;          // Meaning of those depends on the kind, see above
+    uint32_t right;
+};
+typedef struct ast_expr_t ast_expr_t;
+
+enum ast_stmt_kind_t {
+    AST_STMT_DECL = 0,      // Declaration, value is the index in locals
+    AST_STMT_RETURN,        // Return, value is the returned expression (or AST_EXPR_NONE)
+    AST_STMT_EXPR,          // Expression evaluated for its side effects
+};
+typedef enum ast_stmt_kind_t ast_stmt_kind_t;
+
+struct ast_stmt_t {
+    uint32_t kind;          // ast_stmt_kind_t
+    uint32_t line_ref;
+    uint32_t char_ref;
+    uint32_t value;
+};
+typedef struct ast_stmt_t ast_stmt_t;
+
+// A routine literal, such as rt [ x: u32 ]: u32 { return x * x; }
+// Params are declarations in locals, the statements of the body are one after another in stmts
+struct ast_routine_t {
+    uint32_t line_ref;
+    uint32_t char_ref;
+    type_id_t type;         // Routine type made of the types of the params and the return type
+    uint32_t first_param;
+    uint32_t num_params;
+    uint32_t first_stmt;
+    uint32_t num_stmts;
+    uint32_t reserved;
+};
+typedef struct ast_routine_t ast_routine_t;
 
 // Topmost structure of the AST, containing the global scope
 // The global scope may contain only declarations!
 struct ast_global_scope_t {
-    struct ast_decl_list_t* decls;
+    ast_decl_vec_t decls;
+    utils_intern_table_t* names; // All the identifiers in the source, symbols of the AST are ids in it
+    type_table_t* types; // All the unique types in the source, types of the AST are ids in it
+
+    ast_expr_vec_t exprs; // Nodes of all the expressions, see ast_expr_t
+    ast_index_vec_t expr_args; // Args of calls, every list preceded by its length
+    ast_stmt_vec_t stmts; // Statements of the bodies of all the routines
+    ast_routine_vec_t routines;
+    ast_decl_vec_t locals; // Params and declarations inside of routines
+    utils_strbuf_t literals; // Text of string and char literals, one after another
+
+    int is_part; // Made with ast_global_scope_make_part(), the names belong to another scope
 };
 typedef struct ast_global_scope_t ast_global_scope_t;
 
-// Structure which describes a declaration
+// Structure which describes a declaration, 24 bytes
 struct ast_decl_t {
-    size_t line_ref; // line pos and char pos point to the const/decl keyword position in the file for further error reporting
-    size_t char_ref;
-    int is_const; // 1 - Const or 0 - non-const
-    type_info_t* type; // Declaration has a type, or if the type is meant to be inferred this could perhaps be NULL
-    char* symbol; // Symbol name string
-    // TODO: Here should be a field of type ast_expr_t* etc etc
+    uint32_t line_ref; // line pos and char pos point to the const/decl keyword position in the file for further error reporting
+    uint32_t char_ref;
+    uint32_t is_const; // 1 - Const or 0 - non-const
+    type_id_t type; // Id of the type in the table of types, TYPE_ID_NONE if the type is meant to be inferred
+    utils_intern_id_t symbol; // Id of the symbol in the table of names, same symbols have the same ids
+    ast_expr_id_t value; // Initial value, AST_EXPR_NONE if there is none (also for an empty one, as in "= ;")
 };
 typedef struct ast_decl_t ast_decl_t;
 
-// TODO: Model expressions, statements, scopes and all that here
-
 ast_global_scope_t* ast_global_scope_make();
 void ast_global_scope_destroy(ast_global_scope_t*);
 
+// Makes an empty scope for a part of the source, which interns into the table of names of the whole one
+// The table of names is not destroyed with the part, and it has to be only read while the part is filled
+ast_global_scope_t* ast_global_scope_make_part(ast_global_scope_t* whole);
+
+// Appends everything from the part to the scope, as if it was parsed right after the scope's own nodes
+// Types are merged into the table of the scope, ids and indices of the part are shifted past the ones of the scope
+void ast_global_scope_merge(ast_global_scope_t* ast, const ast_global_scope_t* part);
+
+// Adds the node to the expressions of the AST and returns its id
+ast_expr_id_t ast_add_expr(ast_global_scope_t* ast, ast_expr_t expr);
+
+// Text of the operator as written in the source
+const char* ast_expr_op_string(ast_expr_op_t op);
+
+#define AST_EXPR_GET(ast, id) (&UTILS_VEC_AT(&((ast)->exprs), (id)))
+
+// Name of the symbol of a declaration (owned by the table of names)
+#define AST_DECL_SYMBOL(ast, decl) UTILS_INTERN_GET((ast)->names, (decl)->symbol)
+
+// Type of a declaration or a routine, NULL if it is to be inferred (owned by the table of types)
+#define AST_TYPE_GET(ast, id) ((id) != TYPE_ID_NONE ? TYPE_TABLE_GET((ast)->types, (id)) : NULL)
+
 #endif
@@ -20,14 +20,10 @@
 
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
-#include "utils/list.h"
-#include "types/types.h"
+#include "ast.h"
+#include "utils/vec.h"
 
-void ast_decl_destroy(ast_decl_t* decl) {
-    type_destroy(decl->type);
-    free(decl->symbol);
-    free(decl);
-}
-
-UTILS_LIST_MAKE_IMPLEMENTATION(ast_decl, struct ast_decl_t, 8, ast_decl_destroy)
+// Declarations do not own anything (types and names are ids in the tables of the AST), nothing to clean up for the elements
+UTILS_VEC_MAKE_IMPLEMENTATION(ast_decl, struct ast_decl_t, 64)
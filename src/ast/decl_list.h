@@ -22,9 +22,10 @@
 
 #include <stddef.h>
 
-#include "ast.h"
-#include "utils/list.h"
+#include "utils/vec.h"
 
-UTILS_LIST_MAKE_DECLARATION(ast_decl, struct ast_decl_t)
+// Declarations are stored by value, one after another
+struct ast_decl_t;
+UTILS_VEC_MAKE_DECLARATION(ast_decl, struct ast_decl_t)
 
 #endif
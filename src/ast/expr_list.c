@@ -0,0 +1,32 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// expr_list - Vecs of the nodes of expressions, statements and routines
+
+#include "expr_list.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+#include "utils/vec.h"
+
+// Nothing is owned by the elements, types are in the table and names in the table of names
+UTILS_VEC_MAKE_IMPLEMENTATION(ast_expr, struct ast_expr_t, 256)
+UTILS_VEC_MAKE_IMPLEMENTATION(ast_stmt, struct ast_stmt_t, 64)
+UTILS_VEC_MAKE_IMPLEMENTATION(ast_routine, struct ast_routine_t, 16)
+UTILS_VEC_MAKE_IMPLEMENTATION(ast_index, uint32_t, 64)
@@ -0,0 +1,36 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// expr_list - Vecs of the nodes of expressions, statements and routines
+
+#ifndef _I_AST_EXPR_LIST_H_
+#define _I_AST_EXPR_LIST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils/vec.h"
+
+// All of those are stored by value, one after another, and refer to each other by indices
+struct ast_expr_t;
+struct ast_stmt_t;
+struct ast_routine_t;
+UTILS_VEC_MAKE_DECLARATION(ast_expr, struct ast_expr_t)
+UTILS_VEC_MAKE_DECLARATION(ast_stmt, struct ast_stmt_t)
+UTILS_VEC_MAKE_DECLARATION(ast_routine, struct ast_routine_t)
+UTILS_VEC_MAKE_DECLARATION(ast_index, uint32_t)
+
+#endif
@@ -22,21 +22,94 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <getopt.h>
 
 void _print_usage_and_exit() {
     puts("dcrtc - Decrout compiler");
-    printf("Usage: dcrtc [-hvso] <input filename>\n");
+    printf("Usage: dcrtc [-hvsojf] <input filenames>\n");
+    puts("\tinput filename '-' reads the source from standard input, '@<filename>' reads input filenames from the file");
+    puts("\tmany inputs are compiled at once (see -j), their outputs are written one after another in the same order");
+    puts("\tinput may also be a binary output of a stage, compilation then starts from it");
     puts("\t-h\t\t- print this help and exit");
     puts("\t-v\t\t- print version information");
-    puts("\t-s(0-1)\t\t- stage to output (default: last stage)");
-    puts("\tstages in order: 0 - lexing, 1 - parsing");
+    puts("\t-s(0-2)\t\t- stage to output (default: last stage)");
+    puts("\tstages in order: 0 - lexing, 1 - parsing, 2 - name resolution");
     puts("\t-o <filename>\t- output filename to write to (default: stdout)");
+    puts("\t-j <number>\t- number of threads to use, for many inputs or for a single one (default: 1)");
+    puts("\t-f <format>\t- format of the output: text or binary (default: text)");
+    puts("\t-ftime-report\t- report time and memory spent in every stage, as a table along with the diagnostics");
+    puts("\t-ftime-report=json:<filename>\t- same, as JSON written to the file at the end");
+    puts("\t--cache-dir <dir>\t- reuse results of the stage saved in the directory for unchanged inputs");
+    puts("\t--server <socket>\t- keep running and compile the inputs sent to the socket, no inputs are given then");
+    puts("\t--client <socket>\t- send the inputs to the server listening on the socket instead of compiling them");
+    puts("\t--memory-limit <MiB>\t- memory the server keeps for results and sources of requests (default: 256)");
     exit(0);
 }
 
+// Long options which have no short version get values outside of the range of chars
+#define OPTION_CACHE_DIR 256
+#define OPTION_SERVER 257
+#define OPTION_CLIENT 258
+#define OPTION_MEMORY_LIMIT 259
+
+static const struct option _long_options[] = {
+    { "cache-dir", required_argument, NULL, OPTION_CACHE_DIR },
+    { "server", required_argument, NULL, OPTION_SERVER },
+    { "client", required_argument, NULL, OPTION_CLIENT },
+    { "memory-limit", required_argument, NULL, OPTION_MEMORY_LIMIT },
+    { NULL, 0, NULL, 0 },
+};
+
+UTILS_VEC_MAKE_IMPLEMENTATION(context_input, char*, 16)
+
+// Longest line of a response file
+#define RESPONSE_FILE_MAX_LINE 4096
+
+// Adds a copy of the path to the inputs, always succeeds
+int _add_input(context_args_t* args, const char* path) {
+    size_t length = strlen(path);
+    char* copy = malloc(length + 1);
+    memcpy(copy, path, length + 1);
+
+    context_input_vec_push(&(args->inputs), copy);
+    return 0;
+}
+
+// Adds the inputs listed in the file, one per line (empty lines are skipped)
+// Return value: 0 if ok, 1 if error
+int _read_response_file(context_args_t* args, const char* path) {
+    FILE* file = fopen(path, "r");
+    if(file == NULL) {
+        fprintf(stderr, "[context] Error parsing arguments: cannot open response file %s for reading.\n", path);
+        return 1;
+    }
+
+    char line[RESPONSE_FILE_MAX_LINE];
+    while(fgets(line, sizeof(line), file) != NULL) {
+        size_t length = strlen(line);
+
+        if(length == sizeof(line) - 1 && line[length - 1] != '\n' && !feof(file)) {
+            fprintf(stderr, "[context] Error parsing arguments: line too long in response file %s\n", path);
+            fclose(file);
+            return 1;
+        }
+
+        // Trailing whitespace (including the newline) is not a part of the path
+        while(length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r' || line[length - 1] == ' ' || line[length - 1] == '\t')) {
+            length--;
+        }
+        line[length] = '\0';
+
+        if(length != 0) _add_input(args, line);
+    }
+
+    fclose(file);
+    return 0;
+}
+
 void _print_version_and_exit() {
     puts("dcrtc - Decrout compiler");
     puts("Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>");
@@ -51,16 +124,29 @@ context_args_t* context_args_parse(int argc, char** argv) {
 
     int output_stage_provided = 0;
     int output_file_provided = 0;
+    int num_jobs_provided = 0;
+    int output_format_provided = 0;
+    int cache_dir_provided = 0;
+    int memory_limit_provided = 0;
 
     // default values
-    args->output_stage = STAGE_PARSER;
+    args->output_stage = STAGE_LAST;
     args->output_file = stdout;
-    args->input_file = NULL;
+    args->num_jobs = 1;
+    args->output_format = FORMAT_TEXT;
+    args->cache_dir = NULL;
+    args->memory_cache = NULL;
+    args->server_socket = NULL;
+    args->client_socket = NULL;
+    args->memory_limit = (size_t) CONTEXT_DEFAULT_MEMORY_LIMIT * 1024 * 1024;
+    args->time_report = TIME_REPORT_NONE;
+    args->time_report_file = NULL;
+    args->report_log = NULL;
 
     // https://www.gnu.org/software/libc/manual/html_node/Using-Getopt.html
     // https://www.gnu.org/software/libc/manual/html_node/Example-of-Getopt.html
     int c = 0;
-    while((c = getopt(argc, argv, "vho:s:")) && end_of_options != 1) {
+    while((c = getopt_long(argc, argv, "vho:s:j:f:", _long_options, NULL)) && end_of_options != 1) {
         switch(c) {
             // h - print help and exit
             case 'h': {
@@ -123,6 +209,123 @@ context_args_t* context_args_parse(int argc, char** argv) {
                 break;
             }
 
+            // j - number of threads
+            case 'j': {
+                if(num_jobs_provided != 0) {
+                    free(args);
+                    fprintf(stderr, "[context] Error parsing arguments: duplicate '-j' option.\n");
+                    return NULL;
+                }
+
+                char* end = NULL;
+                unsigned long num_jobs = strtoul(optarg, &end, 10);
+
+                if(*optarg < '0' || *optarg > '9' || *end != '\0' || num_jobs < 1 || num_jobs > CONTEXT_MAX_JOBS) {
+                    free(args);
+                    fprintf(stderr, "[context] Error parsing arguments: number of threads invalid or out of range: %s\n", optarg);
+                    return NULL;
+                }
+
+                args->num_jobs = (size_t) num_jobs;
+                num_jobs_provided = 1;
+                break;
+            }
+
+            // f - output format, or -ftime-report
+            case 'f': {
+                if(strncmp(optarg, "time-report", 11) == 0) {
+                    if(args->time_report != TIME_REPORT_NONE) {
+                        free(args);
+                        fprintf(stderr, "[context] Error parsing arguments: duplicate '-ftime-report' option.\n");
+                        return NULL;
+                    }
+
+                    if(optarg[11] == '\0') {
+                        args->time_report = TIME_REPORT_TABLE;
+                    } else if(strncmp(optarg + 11, "=json:", 6) == 0 && optarg[17] != '\0') {
+                        args->time_report = TIME_REPORT_JSON;
+                        args->time_report_file = optarg + 17;
+                    } else {
+                        free(args);
+                        fprintf(stderr, "[context] Error parsing arguments: invalid time report option: -f%s\n", optarg);
+                        return NULL;
+                    }
+                    break;
+                }
+
+                if(output_format_provided != 0) {
+                    free(args);
+                    fprintf(stderr, "[context] Error parsing arguments: duplicate '-f' option.\n");
+                    return NULL;
+                }
+
+                if(strcmp(optarg, "text") == 0) {
+                    args->output_format = FORMAT_TEXT;
+                } else if(strcmp(optarg, "binary") == 0) {
+                    args->output_format = FORMAT_BINARY;
+                } else {
+                    free(args);
+                    fprintf(stderr, "[context] Error parsing arguments: unknown output format: %s\n", optarg);
+                    return NULL;
+                }
+
+                output_format_provided = 1;
+                break;
+            }
+
+            // --cache-dir - directory of saved results
+            case OPTION_CACHE_DIR: {
+                if(cache_dir_provided != 0) {
+                    free(args);
+                    fprintf(stderr, "[context] Error parsing arguments: duplicate '--cache-dir' option.\n");
+                    return NULL;
+                }
+
+                // Points into argv, which lives until the end of the program
+                args->cache_dir = optarg;
+                cache_dir_provided = 1;
+                break;
+            }
+
+            // --server, --client - sockets to serve on or to send to
+            case OPTION_SERVER:
+            case OPTION_CLIENT: {
+                if(args->server_socket != NULL || args->client_socket != NULL) {
+                    free(args);
+                    fprintf(stderr, "[context] Error parsing arguments: only one '--server' or '--client' option can be used.\n");
+                    return NULL;
+                }
+
+                if(c == OPTION_SERVER) {
+                    args->server_socket = optarg;
+                } else {
+                    args->client_socket = optarg;
+                }
+                break;
+            }
+
+            // --memory-limit - memory of the server in MiB
+            case OPTION_MEMORY_LIMIT: {
+                if(memory_limit_provided != 0) {
+                    free(args);
+                    fprintf(stderr, "[context] Error parsing arguments: duplicate '--memory-limit' option.\n");
+                    return NULL;
+                }
+
+                char* end = NULL;
+                unsigned long long limit = strtoull(optarg, &end, 10);
+
+                if(*optarg < '0' || *optarg > '9' || *end != '\0' || limit < 1 || limit > SIZE_MAX / (1024 * 1024)) {
+                    free(args);
+                    fprintf(stderr, "[context] Error parsing arguments: memory limit invalid or out of range: %s\n", optarg);
+                    return NULL;
+                }
+
+                args->memory_limit = (size_t) limit * 1024 * 1024;
+                memory_limit_provided = 1;
+                break;
+            }
+
             default:
             case '?': {
                 end_of_options = 1;
@@ -131,19 +334,59 @@ context_args_t* context_args_parse(int argc, char** argv) {
         }
     }
 
-    // If there is a remaining non-option arg, its an input file
-    if(optind < argc) {
-        args->input_file = fopen(argv[optind], "r+");
-        if(args->input_file == NULL) {
-            free(args);
-            fprintf(stderr, "[context] Error parsing arguments: cannot open file %s for reading.\n", argv[optind]);
+    // All the remaining non-option args are inputs ("-" being stdin), "@file" reads more of them from the file
+    context_input_vec_init(&(args->inputs));
+
+    int stdin_provided = 0;
+    for(int i = optind; i < argc; i++) {
+        int result = argv[i][0] == '@' ? _read_response_file(args, argv[i] + 1) : _add_input(args, argv[i]);
+
+        if(result != 0) {
+            context_args_destroy(args);
             return NULL;
         }
-    } else {
-        free(args);
+    }
+
+    for(size_t i = 0; i < UTILS_VEC_LENGTH(&(args->inputs)); i++) {
+        stdin_provided += strcmp(UTILS_VEC_AT(&(args->inputs), i), "-") == 0;
+    }
+
+    // The server gets its inputs from the clients
+    if(args->server_socket != NULL && UTILS_VEC_LENGTH(&(args->inputs)) != 0) {
+        context_args_destroy(args);
+        fprintf(stderr, "[context] Error parsing arguments: server does not take input file names\n");
+        return NULL;
+    }
+
+    if(args->server_socket == NULL && UTILS_VEC_LENGTH(&(args->inputs)) == 0) {
+        context_args_destroy(args);
         fprintf(stderr, "[context] Error parsing arguments: input file name was not provided\n");
         return NULL;
     }
 
+    if(stdin_provided > 1) {
+        context_args_destroy(args);
+        fprintf(stderr, "[context] Error parsing arguments: standard input can be used only once\n");
+        return NULL;
+    }
+
+    // Binary outputs of many inputs would be written one after another, with no way to tell them apart
+    if(UTILS_VEC_LENGTH(&(args->inputs)) > 1 && args->output_format == FORMAT_BINARY) {
+        context_args_destroy(args);
+        fprintf(stderr, "[context] Error parsing arguments: binary output needs a single input\n");
+        return NULL;
+    }
+
     return args;
 }
+
+void context_args_destroy(context_args_t* args) {
+    if(args == NULL) return;
+
+    for(size_t i = 0; i < UTILS_VEC_LENGTH(&(args->inputs)); i++) {
+        free(UTILS_VEC_AT(&(args->inputs), i));
+    }
+
+    context_input_vec_deinit(&(args->inputs));
+    free(args);
+}
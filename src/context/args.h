@@ -20,25 +20,64 @@
 #define _I_CONTEXT_ARGS_H_
 
 #include <stdio.h>
+#include <stddef.h>
+
+#include "utils/vec.h"
+
+// Upper bound for the number of threads
+#define CONTEXT_MAX_JOBS 256
+
+// Default memory limit of the server, in MiB
+#define CONTEXT_DEFAULT_MEMORY_LIMIT 256
 
 // Enumeration for constants defining compiler passes
 enum context_stage_t {
 #define STAGE_FIRST STAGE_LEXER
     STAGE_LEXER = 0,
     STAGE_PARSER,
-#define STAGE_LAST STAGE_PARSER
+    STAGE_RESOLVER,
+#define STAGE_LAST STAGE_RESOLVER
 };
 typedef enum context_stage_t context_stage_t;
 
+// Format of the output of a stage
+enum context_format_t {
+    FORMAT_TEXT = 0,    // Human readable
+    FORMAT_BINARY,      // Can be loaded back, see io/binfile.h
+};
+typedef enum context_format_t context_format_t;
+
+// Where the time and memory report of every input goes (see context/report.h)
+enum context_time_report_t {
+    TIME_REPORT_NONE = 0,
+    TIME_REPORT_TABLE,      // Table for people, written with the diagnostics
+    TIME_REPORT_JSON,       // One JSON document with the reports of all the inputs, written to a file at the end
+};
+typedef enum context_time_report_t context_time_report_t;
+
+// Paths of the inputs, "-" for stdin
+UTILS_VEC_MAKE_DECLARATION(context_input, char*)
+
 // Structure which contains CLI flags which modify compiler behavior
 struct context_args_t {
     context_stage_t output_stage;   // After which stage should compiler output
     FILE* output_file;              // FILE* to write output to
-    FILE* input_file;               // FILE* to read input from
+    context_input_vec_t inputs;     // Paths of the files to compile, in order (owned by the structure)
+    size_t num_jobs;                // Number of threads to use (for inputs, or for a single input if there is one)
+    context_format_t output_format; // Format of the output of the stage
+    const char* cache_dir;          // Directory of saved stage results (NULL - no caching)
+    struct io_memcache_t* memory_cache; // Stage results kept in memory by the server (NULL otherwise)
+    const char* server_socket;      // Socket to serve compile requests on (NULL - compile the inputs)
+    const char* client_socket;      // Socket of the server to send the inputs to (NULL - compile them here)
+    size_t memory_limit;            // Most bytes the server keeps in memory for results and request sources
+    context_time_report_t time_report;  // Whether and how to report time and memory spent in every stage
+    const char* time_report_file;   // File to write the JSON report to
+    struct context_report_log_t* report_log;    // Reports collected for the JSON file (NULL otherwise)
 };
 typedef struct context_args_t context_args_t;
 
-// The args structure is malloc'ed - requires freeing
+// The args structure is malloc'ed - requires freeing with context_args_destroy()
 context_args_t* context_args_parse(int argc, char** argv);
+void context_args_destroy(context_args_t* args);
 
 #endif
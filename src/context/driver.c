@@ -0,0 +1,176 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// driver - Compilation of many inputs at once, on a pool of threads
+
+// open_memstream() is not a part of C99
+#define _DEFAULT_SOURCE
+
+#include "driver.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "utils/vec.h"
+#include "utils/diag.h"
+
+// Everything about the compilation of one input, the output and diagnostics are kept in memory until their turn
+struct _driver_job_t {
+    const char* path;
+    char* output;
+    size_t output_length;
+    char* diagnostics;
+    size_t diagnostics_length;
+    int result;
+    int done;
+};
+
+// State shared by the workers and the thread writing the results
+struct _driver_pool_t {
+    const context_args_t* args;
+    context_compile_fn_t compile;
+
+    struct _driver_job_t* jobs;
+    size_t num_jobs;
+    size_t next_job;        // First job not taken by any worker yet
+
+    pthread_mutex_t lock;
+    pthread_cond_t job_done;
+};
+
+// Runs a single job, with its output and diagnostics going into memory
+void _driver_run_job(struct _driver_pool_t* pool, struct _driver_job_t* job) {
+    FILE* output = open_memstream(&(job->output), &(job->output_length));
+    FILE* diagnostics = open_memstream(&(job->diagnostics), &(job->diagnostics_length));
+
+    if(output == NULL || diagnostics == NULL) {
+        // Nothing was written anywhere yet, report it the same way as any other error of the input
+        if(output != NULL) fclose(output);
+        if(diagnostics != NULL) fclose(diagnostics);
+
+        job->output = NULL;
+        job->output_length = 0;
+        job->diagnostics = NULL;
+        job->diagnostics_length = 0;
+        job->result = 1;
+        return;
+    }
+
+    utils_diag_set_stream(diagnostics);
+
+    // The inputs themselves are the unit of work, so every one of them gets a single thread
+    job->result = pool->compile(pool->args, job->path, output, 1);
+
+    utils_diag_set_stream(NULL);
+
+    fclose(output);
+    fclose(diagnostics);
+}
+
+// Worker takes the next job until there are none left
+void* _driver_worker(void* arg) {
+    struct _driver_pool_t* pool = arg;
+
+    while(1) {
+        pthread_mutex_lock(&(pool->lock));
+        size_t index = pool->next_job;
+        if(index < pool->num_jobs) pool->next_job += 1;
+        pthread_mutex_unlock(&(pool->lock));
+
+        if(index >= pool->num_jobs) break;
+
+        struct _driver_job_t* job = pool->jobs + index;
+        _driver_run_job(pool, job);
+
+        pthread_mutex_lock(&(pool->lock));
+        job->done = 1;
+        pthread_cond_broadcast(&(pool->job_done));
+        pthread_mutex_unlock(&(pool->lock));
+    }
+
+    return NULL;
+}
+
+size_t context_compile_all(const context_args_t* args, context_compile_fn_t compile) {
+    size_t num_inputs = UTILS_VEC_LENGTH(&(args->inputs));
+
+    if(num_inputs == 1) {
+        return (size_t) compile(args, UTILS_VEC_AT(&(args->inputs), 0), args->output_file, args->num_jobs);
+    }
+
+    struct _driver_pool_t pool;
+    pool.args = args;
+    pool.compile = compile;
+    pool.jobs = calloc(num_inputs, sizeof(struct _driver_job_t));
+    pool.num_jobs = num_inputs;
+    pool.next_job = 0;
+    pthread_mutex_init(&(pool.lock), NULL);
+    pthread_cond_init(&(pool.job_done), NULL);
+
+    for(size_t i = 0; i < num_inputs; i++) {
+        pool.jobs[i].path = UTILS_VEC_AT(&(args->inputs), i);
+    }
+
+    size_t num_workers = args->num_jobs < num_inputs ? args->num_jobs : num_inputs;
+    pthread_t* workers = malloc(num_workers * sizeof(pthread_t));
+
+    size_t num_started = 0;
+    for(; num_started < num_workers; num_started++) {
+        if(pthread_create(workers + num_started, NULL, _driver_worker, &pool) != 0) break;
+    }
+
+    // If no thread could be started, everything is compiled right here
+    if(num_started == 0) {
+        _driver_worker(&pool);
+    }
+
+    // Results are written in the order of the inputs, as soon as the next one is ready
+    size_t num_failed = 0;
+    for(size_t i = 0; i < num_inputs; i++) {
+        struct _driver_job_t* job = pool.jobs + i;
+
+        pthread_mutex_lock(&(pool.lock));
+        while(!job->done) {
+            pthread_cond_wait(&(pool.job_done), &(pool.lock));
+        }
+        pthread_mutex_unlock(&(pool.lock));
+
+        if(job->output_length != 0) fwrite(job->output, 1, job->output_length, args->output_file);
+        if(job->diagnostics_length != 0) fwrite(job->diagnostics, 1, job->diagnostics_length, stderr);
+
+        // Diagnostics of an input go out together with its output
+        fflush(args->output_file);
+        fflush(stderr);
+
+        free(job->output);
+        free(job->diagnostics);
+
+        num_failed += job->result != 0;
+    }
+
+    for(size_t i = 0; i < num_started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    free(workers);
+    pthread_cond_destroy(&(pool.job_done));
+    pthread_mutex_destroy(&(pool.lock));
+    free(pool.jobs);
+
+    return num_failed;
+}
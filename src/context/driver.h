@@ -0,0 +1,38 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// driver - Compilation of many inputs at once, on a pool of threads
+
+#ifndef _I_CONTEXT_DRIVER_H_
+#define _I_CONTEXT_DRIVER_H_
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "args.h"
+
+// Compiles a single input, writing the output into outfile and using up to num_threads threads for it
+// Diagnostics go to UTILS_DIAG (see utils/diag.h). Returns 0 if ok, 1 if error
+typedef int (*context_compile_fn_t)(const context_args_t* args, const char* path, FILE* outfile, size_t num_threads);
+
+// Compiles all the inputs from args with compile, up to args->num_jobs of them at once
+// Output and diagnostics of every input are collected separately and written out whole, in the order of the inputs,
+// so they never interleave. A single input is compiled straight into the output file, with all the threads for itself
+//
+// Return value: number of inputs which failed to compile
+size_t context_compile_all(const context_args_t* args, context_compile_fn_t compile);
+
+#endif
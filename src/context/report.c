@@ -0,0 +1,342 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// report - Time and memory spent in every stage of the compilation of an input (-ftime-report)
+
+// clock_gettime() and getrusage() are not a part of C99
+#define _DEFAULT_SOURCE
+
+#include "report.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "utils/diag.h"
+
+// Names of the stages, in the table and in the JSON document
+static const char* _report_stage_names[REPORT_STAGES_NUM] = {
+    [REPORT_STAGE_READ] = "read",
+    [REPORT_STAGE_CACHE] = "cache",
+    [REPORT_STAGE_LEXER] = "lexer",
+    [REPORT_STAGE_PARSER] = "parser",
+    [REPORT_STAGE_RESOLVER] = "resolver",
+    [REPORT_STAGE_OUTPUT] = "output",
+};
+
+void context_report_init(context_report_t* report, const char* input) {
+    memset(report, 0, sizeof(context_report_t));
+    report->input = input;
+}
+
+void context_report_set_threads(context_report_t* report, size_t num_threads, int is_concurrent) {
+    if(report == NULL) return;
+
+    report->thread_cpu_time = num_threads <= 1;
+    report->shared_heap = is_concurrent;
+}
+
+void context_report_track_arena(context_report_t* report, const utils_arena_t* arena) {
+    if(report == NULL || arena == NULL || report->num_arenas == CONTEXT_REPORT_MAX_ARENAS) return;
+
+    report->arenas[report->num_arenas] = arena;
+    report->num_arenas += 1;
+}
+
+void context_report_untrack_arenas(context_report_t* report) {
+    if(report == NULL) return;
+
+    report->num_arenas = 0;
+}
+
+double _report_clock(clockid_t clock) {
+    struct timespec now;
+    clock_gettime(clock, &now);
+
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+// Bytes of the heap in use, 0 if there is no way to tell
+size_t _report_heap_size() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+void _report_take_sample(const context_report_t* report, context_report_sample_t* sample) {
+    sample->wall_time = _report_clock(CLOCK_MONOTONIC);
+    sample->cpu_time = _report_clock(report->thread_cpu_time ? CLOCK_THREAD_CPUTIME_ID : CLOCK_PROCESS_CPUTIME_ID);
+    sample->heap_size = report->shared_heap ? 0 : _report_heap_size();
+
+    sample->num_allocs = 0;
+    sample->allocated_size = 0;
+    for(size_t i = 0; i < report->num_arenas; i++) {
+        sample->num_allocs += report->arenas[i]->num_allocs;
+        sample->allocated_size += report->arenas[i]->allocated_size;
+    }
+}
+
+void context_report_begin(context_report_t* report, context_report_stage_t stage) {
+    if(report == NULL) return;
+
+    _report_take_sample(report, &(report->stages[stage].start));
+}
+
+void context_report_end(context_report_t* report, context_report_stage_t stage) {
+    if(report == NULL) return;
+
+    context_report_sample_t end;
+    _report_take_sample(report, &end);
+
+    context_report_stage_info_t* info = &(report->stages[stage]);
+    const context_report_sample_t* start = &(info->start);
+
+    info->was_run = 1;
+    info->wall_time += end.wall_time - start->wall_time;
+    info->cpu_time += end.cpu_time - start->cpu_time;
+    info->heap_growth += (long long) end.heap_size - (long long) start->heap_size;
+
+    // Arenas may be tracked in the middle of the stage, they were empty before that
+    if(end.num_allocs >= start->num_allocs) {
+        info->num_allocs += end.num_allocs - start->num_allocs;
+        info->allocated_size += end.allocated_size - start->allocated_size;
+    } else {
+        info->num_allocs += end.num_allocs;
+        info->allocated_size += end.allocated_size;
+    }
+
+    // Linux reports the peak in KiB
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) == 0) {
+        info->peak_rss = (size_t) usage.ru_maxrss;
+    }
+}
+
+// Sum of the wall time of all the stages, in seconds
+double _report_total_wall_time(const context_report_t* report) {
+    double total = 0.0;
+    for(size_t i = 0; i < REPORT_STAGES_NUM; i++) {
+        total += report->stages[i].wall_time;
+    }
+
+    return total;
+}
+
+double _report_total_cpu_time(const context_report_t* report) {
+    double total = 0.0;
+    for(size_t i = 0; i < REPORT_STAGES_NUM; i++) {
+        total += report->stages[i].cpu_time;
+    }
+
+    return total;
+}
+
+// Growth of the heap in KiB for the table, "-" if it is not measured
+void _report_format_heap(char* buffer, size_t size, const context_report_t* report, long long heap_growth) {
+    if(report->shared_heap) {
+        snprintf(buffer, size, "%s", "-");
+    } else {
+        snprintf(buffer, size, "%.1f", (double) heap_growth / 1024.0);
+    }
+}
+
+void context_report_write_table(FILE* out, const context_report_t* report) {
+    fprintf(out, "Time report for %s%s:\n", report->input, report->from_cache ? " (from cache)" : "");
+    fprintf(out, "  %-8s %10s %10s %10s %12s %12s %12s\n", "stage", "wall ms", "cpu ms", "allocs", "alloc KiB", "heap KiB", "peak RSS KiB");
+
+    size_t total_allocs = 0;
+    size_t total_allocated = 0;
+    long long total_heap = 0;
+    size_t peak_rss = 0;
+
+    // The growth of the shared heap is left blank
+    char heap[32];
+
+    for(size_t i = 0; i < REPORT_STAGES_NUM; i++) {
+        const context_report_stage_info_t* info = &(report->stages[i]);
+        if(!info->was_run) continue;
+
+        _report_format_heap(heap, sizeof(heap), report, info->heap_growth);
+        fprintf(out, "  %-8s %10.3f %10.3f %10zu %12.1f %12s %12zu\n", _report_stage_names[i],
+            info->wall_time * 1e3, info->cpu_time * 1e3, info->num_allocs,
+            (double) info->allocated_size / 1024.0, heap, info->peak_rss
+        );
+
+        total_allocs += info->num_allocs;
+        total_allocated += info->allocated_size;
+        total_heap += info->heap_growth;
+        if(info->peak_rss > peak_rss) peak_rss = info->peak_rss;
+    }
+
+    double wall_time = _report_total_wall_time(report);
+    _report_format_heap(heap, sizeof(heap), report, total_heap);
+    fprintf(out, "  %-8s %10.3f %10.3f %10zu %12.1f %12s %12zu\n", "total",
+        wall_time * 1e3, _report_total_cpu_time(report) * 1e3, total_allocs,
+        (double) total_allocated / 1024.0, heap, peak_rss
+    );
+
+    fprintf(out, "  %zu bytes, %zu tokens, %zu declarations, %zu types, %zu names\n",
+        report->source_bytes, report->num_tokens, report->num_decls, report->num_types, report->num_names
+    );
+
+    if(wall_time > 0.0) {
+        fprintf(out, "  %.1f MiB/s, %.0f tokens/s\n",
+            (double) report->source_bytes / (1024.0 * 1024.0) / wall_time, (double) report->num_tokens / wall_time
+        );
+    }
+}
+
+void context_report_finish(const context_args_t* args, const context_report_t* report) {
+    if(report == NULL) return;
+
+    if(args->time_report == TIME_REPORT_TABLE) {
+        context_report_write_table(UTILS_DIAG, report);
+    } else if(args->time_report == TIME_REPORT_JSON && args->report_log != NULL) {
+        context_report_log_add(args->report_log, report);
+    }
+}
+
+context_report_log_t* context_report_log_make() {
+    context_report_log_t* log = malloc(sizeof(context_report_log_t));
+
+    pthread_mutex_init(&(log->lock), NULL);
+    log->num_reports = 0;
+    log->alloc_reports = 0;
+    log->reports = NULL;
+
+    return log;
+}
+
+void context_report_log_destroy(context_report_log_t* log) {
+    if(log == NULL) return;
+
+    pthread_mutex_destroy(&(log->lock));
+    free(log->reports);
+    free(log);
+}
+
+void context_report_log_add(context_report_log_t* log, const context_report_t* report) {
+    pthread_mutex_lock(&(log->lock));
+
+    if(log->num_reports == log->alloc_reports) {
+        log->alloc_reports = log->alloc_reports != 0 ? log->alloc_reports * 2 : 16;
+        log->reports = realloc(log->reports, log->alloc_reports * sizeof(context_report_t));
+    }
+
+    log->reports[log->num_reports] = *report;
+    log->num_reports += 1;
+
+    pthread_mutex_unlock(&(log->lock));
+}
+
+// Writes the string as a JSON string literal
+void _report_write_json_string(FILE* out, const char* str) {
+    fputc('"', out);
+
+    for(const char* c = str; *c != '\0'; c++) {
+        if(*c == '"' || *c == '\\') {
+            fprintf(out, "\\%c", *c);
+        } else if((unsigned char) *c < 0x20) {
+            fprintf(out, "\\u%04x", (unsigned int) (unsigned char) *c);
+        } else {
+            fputc(*c, out);
+        }
+    }
+
+    fputc('"', out);
+}
+
+void _report_write_json_report(FILE* out, const context_report_t* report) {
+    fputs("    {\n      \"input\": ", out);
+    _report_write_json_string(out, report->input);
+    fprintf(out, ",\n      \"status\": %d,\n      \"from_cache\": %s,\n", report->status, report->from_cache ? "true" : "false");
+
+    fprintf(out, "      \"counters\": { \"source_bytes\": %zu, \"tokens\": %zu, \"declarations\": %zu, \"types\": %zu, \"names\": %zu },\n",
+        report->source_bytes, report->num_tokens, report->num_decls, report->num_types, report->num_names
+    );
+
+    fprintf(out, "      \"total\": { \"wall_ms\": %.3f, \"cpu_ms\": %.3f },\n",
+        _report_total_wall_time(report) * 1e3, _report_total_cpu_time(report) * 1e3
+    );
+
+    fputs("      \"stages\": [", out);
+
+    int first = 1;
+    for(size_t i = 0; i < REPORT_STAGES_NUM; i++) {
+        const context_report_stage_info_t* info = &(report->stages[i]);
+        if(!info->was_run) continue;
+
+        fprintf(out, "%s\n        { \"name\": \"%s\", \"wall_ms\": %.3f, \"cpu_ms\": %.3f, \"allocations\": %zu, "
+            "\"allocated_bytes\": %zu, \"heap_growth_bytes\": ",
+            first ? "" : ",", _report_stage_names[i], info->wall_time * 1e3, info->cpu_time * 1e3,
+            info->num_allocs, info->allocated_size
+        );
+
+        // The growth of the shared heap is null
+        if(report->shared_heap) {
+            fputs("null", out);
+        } else {
+            fprintf(out, "%lld", info->heap_growth);
+        }
+
+        fprintf(out, ", \"peak_rss_kib\": %zu }", info->peak_rss);
+
+        first = 0;
+    }
+
+    fputs("\n      ]\n    }", out);
+}
+
+int context_report_log_write_json(FILE* out, context_report_log_t* log, const context_input_vec_t* inputs) {
+    pthread_mutex_lock(&(log->lock));
+
+    // Reports are added as the inputs finish, they are put back in order here
+    char* written = calloc(log->num_reports != 0 ? log->num_reports : 1, 1);
+    size_t num_written = 0;
+
+    fputs("{\n  \"version\": 1,\n  \"inputs\": [", out);
+
+    for(size_t i = 0; i <= UTILS_VEC_LENGTH(inputs); i++) {
+        for(size_t j = 0; j < log->num_reports; j++) {
+            const context_report_t* report = &(log->reports[j]);
+
+            // After all the inputs, whatever is left
+            int matches = i < UTILS_VEC_LENGTH(inputs) ? report->input == UTILS_VEC_AT(inputs, i) : 1;
+            if(written[j] || !matches) continue;
+
+            fputs(num_written != 0 ? ",\n" : "\n", out);
+            _report_write_json_report(out, report);
+
+            written[j] = 1;
+            num_written += 1;
+        }
+    }
+
+    fputs("\n  ]\n}\n", out);
+
+    free(written);
+    pthread_mutex_unlock(&(log->lock));
+
+    return ferror(out) != 0;
+}
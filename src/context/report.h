@@ -0,0 +1,139 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// report - Time and memory spent in every stage of the compilation of an input (-ftime-report)
+
+// Every stage of the pipeline is wrapped in context_report_begin() and context_report_end(), which take
+// the time and the memory use at both ends. A stage may run more than once (cache lookup and store), then
+// it adds up. All the functions accept a NULL report and do nothing then, so the pipeline does not need
+// to check whether the report was asked for.
+//
+// Times are wall time and CPU time. The CPU time is of the thread compiling the input when it is compiled
+// on a single thread, so inputs compiled at once on many threads do not count the work of each other,
+// and of the whole process when the input itself is split among many threads. Memory is measured three ways:
+//  - allocations from the arenas given to context_report_track_arena() (names, types),
+//  - growth of the heap in use (all of malloc, only known with glibc), not measured when other inputs
+//    are compiled at the same time, since the heap is shared by the whole process,
+//  - peak resident set size of the process at the end of the stage.
+
+#ifndef _I_CONTEXT_REPORT_H_
+#define _I_CONTEXT_REPORT_H_
+
+#include <stdio.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "args.h"
+#include "utils/arena.h"
+
+enum context_report_stage_t {
+    REPORT_STAGE_READ = 0,  // Reading the source (io_read_source_file())
+    REPORT_STAGE_CACHE,     // Looking up and storing the results of the stage in the caches
+    REPORT_STAGE_LEXER,     // Lexing, or loading the saved tokens
+    REPORT_STAGE_PARSER,    // Parsing, or loading the saved AST (with a single thread, lexing happens as a part of it)
+    REPORT_STAGE_RESOLVER,  // Resolving the symbols of the AST
+    REPORT_STAGE_OUTPUT,    // Writing out the result of the last stage
+    REPORT_STAGES_NUM,
+};
+typedef enum context_report_stage_t context_report_stage_t;
+
+// Time and memory use at a point in time
+struct context_report_sample_t {
+    double wall_time;       // Seconds
+    double cpu_time;
+    size_t num_allocs;      // Sums over the tracked arenas
+    size_t allocated_size;
+    size_t heap_size;       // Bytes of the heap in use
+};
+typedef struct context_report_sample_t context_report_sample_t;
+
+struct context_report_stage_info_t {
+    int was_run;
+    double wall_time;       // Seconds
+    double cpu_time;
+    size_t num_allocs;      // Allocations from the tracked arenas
+    size_t allocated_size;
+    long long heap_growth;  // Bytes, negative if memory was freed
+    size_t peak_rss;        // KiB, at the end of the stage
+
+    context_report_sample_t start;
+};
+typedef struct context_report_stage_info_t context_report_stage_info_t;
+
+// Most arenas tracked by a report
+#define CONTEXT_REPORT_MAX_ARENAS 4
+
+struct context_report_t {
+    const char* input;      // Path of the input (not owned)
+    int status;             // Result of the compilation, 0 if ok
+    int from_cache;         // 1 if the result of the stage was found in a cache
+    int thread_cpu_time;    // 1 if the CPU time is of the thread compiling the input, not of the process
+    int shared_heap;        // 1 if other inputs are compiled at the same time, the growth of the heap is not measured
+
+    context_report_stage_info_t stages[REPORT_STAGES_NUM];
+
+    size_t num_arenas;
+    const utils_arena_t* arenas[CONTEXT_REPORT_MAX_ARENAS];
+
+    // Throughput counters, 0 if the stage which knows them did not run
+    size_t source_bytes;
+    size_t num_tokens;
+    size_t num_decls;
+    size_t num_types;
+    size_t num_names;
+};
+typedef struct context_report_t context_report_t;
+
+void context_report_init(context_report_t* report, const char* input);
+
+// Tells how the input is compiled, before any stage begins: with num_threads threads, and whether
+// other inputs are compiled at the same time (see the top of the file)
+void context_report_set_threads(context_report_t* report, size_t num_threads, int is_concurrent);
+
+// Counts the allocations from the arena in the following stages, the arena has to outlive the report
+// or be untracked with context_report_untrack_arenas() before it is destroyed
+void context_report_track_arena(context_report_t* report, const utils_arena_t* arena);
+void context_report_untrack_arenas(context_report_t* report);
+
+void context_report_begin(context_report_t* report, context_report_stage_t stage);
+void context_report_end(context_report_t* report, context_report_stage_t stage);
+
+// Writes the report as a table for people
+void context_report_write_table(FILE* out, const context_report_t* report);
+
+// Writes the report where args want it: the table into UTILS_DIAG, or into args->report_log for the JSON file
+void context_report_finish(const context_args_t* args, const context_report_t* report);
+
+// Reports of all the inputs, collected from many threads for a single JSON document
+struct context_report_log_t {
+    pthread_mutex_t lock;
+    size_t num_reports;
+    size_t alloc_reports;
+    context_report_t* reports;
+};
+typedef struct context_report_log_t context_report_log_t;
+
+context_report_log_t* context_report_log_make();
+void context_report_log_destroy(context_report_log_t* log);
+
+// Copies the report into the log
+void context_report_log_add(context_report_log_t* log, const context_report_t* report);
+
+// Writes all the reports as JSON, in the order of the inputs (reports of other inputs, like requests
+// to the server, come last). Return value: 0 if ok, 1 if error
+int context_report_log_write_json(FILE* out, context_report_log_t* log, const context_input_vec_t* inputs);
+
+#endif
@@ -0,0 +1,590 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// server - Compile server, which keeps running and compiles inputs sent over a Unix socket
+
+// Sockets, signals, clock_gettime(), realpath() and open_memstream() are not a part of C99
+#define _DEFAULT_SOURCE
+
+#include "server.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "io/fileread.h"
+#include "io/memcache.h"
+#include "utils/diag.h"
+
+// Signal handlers write a byte into the pipe, which wakes up the thread waiting for connections
+// (the signal may be delivered to any thread, or arrive right before accept(), so a flag would not do)
+static int _server_stop_pipe[2] = { -1, -1 };
+
+// State shared by all the threads handling requests
+struct _server_t {
+    context_args_t args;        // Copy of the args, with the memory cache of the server
+    context_compile_source_fn_t compile;
+
+    size_t max_active;          // Most requests handled at once
+    size_t num_active;
+    pthread_mutex_t lock;
+    pthread_cond_t request_done;
+};
+
+struct _server_request_t {
+    struct _server_t* server;
+    int fd;
+};
+
+void _server_handle_signal(int signal) {
+    (void) signal;
+
+    // Nothing to do if the pipe is full, the server is stopping already
+    int saved_errno = errno;
+    ssize_t written = write(_server_stop_pipe[1], "", 1);
+    (void) written;
+    errno = saved_errno;
+}
+
+// Writes all of the data, returns 0 if ok or 1 if the other side went away
+int _server_write_all(int fd, const char* data, size_t length) {
+    while(length != 0) {
+        ssize_t written = send(fd, data, length, 0);
+        if(written < 0 && errno == EINTR) continue;
+        if(written <= 0) return 1;
+
+        data += written;
+        length -= (size_t) written;
+    }
+
+    return 0;
+}
+
+// Reads exactly length bytes, returns 0 if ok or 1 if the other side went away before that
+int _server_read_all(int fd, char* data, size_t length) {
+    while(length != 0) {
+        ssize_t num_read = recv(fd, data, length, 0);
+        if(num_read < 0 && errno == EINTR) continue;
+        if(num_read <= 0) return 1;
+
+        data += num_read;
+        length -= (size_t) num_read;
+    }
+
+    return 0;
+}
+
+// Milliseconds of the monotonic clock
+long long _server_now_ms() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (long long) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// Waits until there is something to read on the connection
+// Returns 0 if ok, or 1 if the deadline passed or the server is stopping first
+int _server_wait_readable(int fd, long long deadline_ms) {
+    while(1) {
+        long long timeout = deadline_ms - _server_now_ms();
+        if(timeout <= 0) return 1;
+
+        // The byte in the stop pipe is never read, so every thread waiting here sees it
+        struct pollfd fds[2] = {
+            { .fd = fd, .events = POLLIN, .revents = 0 },
+            { .fd = _server_stop_pipe[0], .events = POLLIN, .revents = 0 },
+        };
+
+        int num_ready = poll(fds, 2, (int) timeout);
+        if(num_ready < 0 && errno == EINTR) continue;
+        if(num_ready < 0 || fds[1].revents != 0) return 1;
+        if(fds[0].revents != 0) return 0;
+    }
+}
+
+// Reads the header up to (and without) the empty line into buffer as a null-terminated string
+// It's read a byte at a time, so that nothing after it is consumed. Returns 0 if ok or 1 if error
+// A client which is too slow with it, or still sending it when the server stops, is an error too
+int _server_read_header(int fd, char* buffer, size_t max_length) {
+    size_t length = 0;
+    long long deadline_ms = _server_now_ms() + CONTEXT_SERVER_HEADER_TIMEOUT_MS;
+
+    while(length + 1 < max_length) {
+        // Waits only when there is nothing to read yet, not for every byte
+        ssize_t num_read = recv(fd, buffer + length, 1, MSG_DONTWAIT);
+        if(num_read < 0 && errno == EINTR) continue;
+
+        if(num_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if(_server_wait_readable(fd, deadline_ms) != 0) return 1;
+            continue;
+        }
+
+        if(num_read <= 0) return 1;
+        length += 1;
+
+        if(length >= 2 && buffer[length - 1] == '\n' && buffer[length - 2] == '\n') {
+            buffer[length - 1] = '\0';
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// Returns the value of the key in the header, or NULL if it is not there
+// Values end with a newline, not a null byte, see _server_value_length()
+const char* _server_find_value(const char* header, const char* key) {
+    size_t key_length = strlen(key);
+
+    const char* line = header;
+    while(*line != '\0') {
+        if(strncmp(line, key, key_length) == 0 && line[key_length] == ' ') {
+            return line + key_length + 1;
+        }
+
+        const char* newline = strchr(line, '\n');
+        if(newline == NULL) break;
+        line = newline + 1;
+    }
+
+    return NULL;
+}
+
+size_t _server_value_length(const char* value) {
+    return strcspn(value, "\n");
+}
+
+// Parses a number value of the key, returns 0 if ok or 1 if it's missing or not a number
+int _server_find_number(const char* header, const char* key, size_t* number) {
+    const char* value = _server_find_value(header, key);
+    if(value == NULL || *value < '0' || *value > '9') return 1;
+
+    char* end = NULL;
+    unsigned long long parsed = strtoull(value, &end, 10);
+    if(*end != '\n' && *end != '\0') return 1;
+
+    *number = (size_t) parsed;
+    return 0;
+}
+
+// Returns a new null-terminated copy of the value of the key, or NULL if it is not there
+char* _server_copy_value(const char* header, const char* key) {
+    const char* value = _server_find_value(header, key);
+    if(value == NULL) return NULL;
+
+    size_t length = _server_value_length(value);
+    char* copy = malloc(length + 1);
+    memcpy(copy, value, length);
+    copy[length] = '\0';
+
+    return copy;
+}
+
+// Returns 1 if the client closed the connection (and does not wait for the response anymore), 0 otherwise
+int _server_is_cancelled(int fd) {
+    struct pollfd pfd = { .fd = fd, .events = POLLIN, .revents = 0 };
+
+    if(poll(&pfd, 1, 0) <= 0) return 0;
+    if(pfd.revents & (POLLHUP | POLLERR)) return 1;
+
+    // Readable with nothing to read means the other side is gone, clients send nothing after the request
+    char byte;
+    return recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) == 0;
+}
+
+// Sends the response header and the contents
+int _server_send_response(int fd, int status, const char* output, size_t output_length, const char* diagnostics, size_t diagnostics_length) {
+    char header[256];
+    int header_length = snprintf(header, sizeof(header), "%s\nstatus %d\noutput %zu\ndiagnostics %zu\n\n",
+        CONTEXT_SERVER_PROTOCOL, status, output_length, diagnostics_length
+    );
+
+    if(_server_write_all(fd, header, (size_t) header_length) != 0) return 1;
+    if(_server_write_all(fd, output, output_length) != 0) return 1;
+    return _server_write_all(fd, diagnostics, diagnostics_length);
+}
+
+// Reads the source of the request, either from the path in the header or from the connection
+// Returns NULL if error (reported into UTILS_DIAG)
+io_source_t* _server_read_source(const struct _server_t* server, int fd, const char* header) {
+    size_t source_length = 0;
+
+    if(_server_find_number(header, "source", &source_length) == 0) {
+        // Memory for a request is limited the same way as the memory for the results
+        if(source_length > server->args.memory_cache->limit) {
+            fprintf(UTILS_DIAG, "[server] Error: source of %zu bytes is over the memory limit\n", source_length);
+            return NULL;
+        }
+
+        char* buffer = malloc(source_length + 1);
+        if(_server_read_all(fd, buffer, source_length) != 0) {
+            fprintf(UTILS_DIAG, "%s", "[server] Error: source is shorter than announced\n");
+            free(buffer);
+            return NULL;
+        }
+
+        buffer[source_length] = '\0';
+        return io_source_from_buffer(buffer, source_length);
+    }
+
+    char* path = _server_copy_value(header, "path");
+    if(path == NULL) {
+        fprintf(UTILS_DIAG, "%s", "[server] Error: request has neither a path nor a source\n");
+        return NULL;
+    }
+
+    FILE* infile = fopen(path, "r");
+    if(infile == NULL) {
+        fprintf(UTILS_DIAG, "[server] Error: cannot open file %s for reading.\n", path);
+        free(path);
+        return NULL;
+    }
+
+    io_source_t* source = io_read_source_file(infile);
+    fclose(infile);
+    free(path);
+
+    return source;
+}
+
+// Handles the request on the connection and sends the response
+void _server_handle_request(struct _server_t* server, int fd) {
+    char* header = malloc(CONTEXT_SERVER_MAX_HEADER);
+
+    char* output = NULL;
+    size_t output_length = 0;
+    char* diagnostics = NULL;
+    size_t diagnostics_length = 0;
+
+    FILE* output_stream = open_memstream(&output, &output_length);
+    FILE* diag_stream = open_memstream(&diagnostics, &diagnostics_length);
+
+    if(output_stream == NULL || diag_stream == NULL || _server_read_header(fd, header, CONTEXT_SERVER_MAX_HEADER) != 0
+        || strncmp(header, CONTEXT_SERVER_PROTOCOL "\n", strlen(CONTEXT_SERVER_PROTOCOL) + 1) != 0) {
+        // Not a request at all, there is nobody to answer
+        if(output_stream != NULL) fclose(output_stream);
+        if(diag_stream != NULL) fclose(diag_stream);
+        free(output);
+        free(diagnostics);
+        free(header);
+        return;
+    }
+
+    utils_diag_set_stream(diag_stream);
+
+    // Every request gets its own copy of the args, only the stage and the format can be chosen
+    context_args_t args = server->args;
+    int status = 1;
+
+    size_t stage = 0;
+    const char* format = _server_find_value(header, "format");
+    char* output_path = _server_copy_value(header, "output");
+
+    if(_server_find_number(header, "stage", &stage) != 0 || stage > (size_t) STAGE_LAST) {
+        fprintf(UTILS_DIAG, "%s", "[server] Error: invalid stage in the request\n");
+    } else if(format != NULL && strncmp(format, "text\n", 5) != 0 && strncmp(format, "binary\n", 7) != 0) {
+        fprintf(UTILS_DIAG, "%s", "[server] Error: invalid format in the request\n");
+    } else {
+        args.output_stage = (context_stage_t) stage;
+        args.output_format = format != NULL && strncmp(format, "binary\n", 7) == 0 ? FORMAT_BINARY : FORMAT_TEXT;
+        args.output_file = output_stream;
+
+        if(output_path != NULL && (args.output_file = fopen(output_path, "w")) == NULL) {
+            fprintf(UTILS_DIAG, "[server] Error: cannot open file %s for writing.\n", output_path);
+        }
+
+        io_source_t* source = args.output_file != NULL ? _server_read_source(server, fd, header) : NULL;
+
+        if(source != NULL && _server_is_cancelled(fd)) {
+            io_source_destroy(source);
+        } else if(source != NULL) {
+            status = server->compile(&args, source, args.output_file, 1);
+        }
+
+        if(args.output_file != NULL && args.output_file != output_stream) fclose(args.output_file);
+    }
+
+    utils_diag_set_stream(NULL);
+    fclose(output_stream);
+    fclose(diag_stream);
+
+    // Nobody to send it to if the client went away in the meantime
+    if(!_server_is_cancelled(fd)) {
+        _server_send_response(fd, status, output, output_length, diagnostics, diagnostics_length);
+    }
+
+    free(output_path);
+    free(output);
+    free(diagnostics);
+    free(header);
+}
+
+void* _server_request_thread(void* arg) {
+    struct _server_request_t* request = arg;
+    struct _server_t* server = request->server;
+
+    _server_handle_request(server, request->fd);
+    close(request->fd);
+    free(request);
+
+    pthread_mutex_lock(&(server->lock));
+    server->num_active -= 1;
+    pthread_cond_broadcast(&(server->request_done));
+    pthread_mutex_unlock(&(server->lock));
+
+    return NULL;
+}
+
+// Fills the address of the socket at path, returns 0 if ok or 1 if the path is too long
+int _server_make_address(const char* path, struct sockaddr_un* address) {
+    memset(address, 0, sizeof(struct sockaddr_un));
+    address->sun_family = AF_UNIX;
+
+    if(strlen(path) >= sizeof(address->sun_path)) {
+        fprintf(stderr, "[server] Error: socket path %s is too long\n", path);
+        return 1;
+    }
+
+    strcpy(address->sun_path, path);
+    return 0;
+}
+
+// Opens the listening socket, a stale socket file left by a server which is not running anymore is replaced
+int _server_listen(const char* path) {
+    struct sockaddr_un address;
+    if(_server_make_address(path, &address) != 0) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0) {
+        fprintf(stderr, "[server] Error: cannot create socket: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if(connect(fd, (struct sockaddr*) &address, sizeof(address)) == 0) {
+        fprintf(stderr, "[server] Error: another server is listening on %s\n", path);
+        close(fd);
+        return -1;
+    }
+
+    close(fd);
+    unlink(path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0 || bind(fd, (struct sockaddr*) &address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        fprintf(stderr, "[server] Error: cannot listen on %s: %s\n", path, strerror(errno));
+        if(fd >= 0) close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+int context_server_run(const context_args_t* args, context_compile_source_fn_t compile) {
+    int listen_fd = _server_listen(args->server_socket);
+    if(listen_fd < 0) return 1;
+
+    if(pipe(_server_stop_pipe) != 0) {
+        fprintf(stderr, "[server] Error: cannot create pipe: %s\n", strerror(errno));
+        close(listen_fd);
+        return 1;
+    }
+
+    struct sigaction stop_action;
+    memset(&stop_action, 0, sizeof(stop_action));
+    stop_action.sa_handler = _server_handle_signal;
+    sigemptyset(&(stop_action.sa_mask));
+    sigaction(SIGINT, &stop_action, NULL);
+    sigaction(SIGTERM, &stop_action, NULL);
+
+    // Clients which go away are noticed by the failing writes instead
+    signal(SIGPIPE, SIG_IGN);
+
+    struct _server_t server;
+    server.args = *args;
+    server.args.memory_cache = io_memcache_make(args->memory_limit);
+    server.compile = compile;
+    server.max_active = args->num_jobs;
+    server.num_active = 0;
+    pthread_mutex_init(&(server.lock), NULL);
+    pthread_cond_init(&(server.request_done), NULL);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    while(1) {
+        // Wait for a free thread first, so that waiting clients stay in the backlog of the socket
+        pthread_mutex_lock(&(server.lock));
+        while(server.num_active >= server.max_active) {
+            pthread_cond_wait(&(server.request_done), &(server.lock));
+        }
+        pthread_mutex_unlock(&(server.lock));
+
+        struct pollfd fds[2] = {
+            { .fd = listen_fd, .events = POLLIN, .revents = 0 },
+            { .fd = _server_stop_pipe[0], .events = POLLIN, .revents = 0 },
+        };
+
+        if(poll(fds, 2, -1) < 0) continue;
+        if(fds[1].revents != 0) break;
+
+        int fd = accept(listen_fd, NULL, NULL);
+        if(fd < 0) {
+            if(errno != EINTR && errno != ECONNABORTED) {
+                fprintf(stderr, "[server] Error: cannot accept connection: %s\n", strerror(errno));
+            }
+            continue;
+        }
+
+        struct _server_request_t* request = malloc(sizeof(struct _server_request_t));
+        request->server = &server;
+        request->fd = fd;
+
+        pthread_mutex_lock(&(server.lock));
+        server.num_active += 1;
+        pthread_mutex_unlock(&(server.lock));
+
+        pthread_t thread;
+        if(pthread_create(&thread, &attr, _server_request_thread, request) != 0) {
+            // Handled right here then, it only takes longer
+            _server_request_thread(request);
+        }
+    }
+
+    // Requests which were accepted are still answered
+    pthread_mutex_lock(&(server.lock));
+    while(server.num_active != 0) {
+        pthread_cond_wait(&(server.request_done), &(server.lock));
+    }
+    pthread_mutex_unlock(&(server.lock));
+
+    close(listen_fd);
+    unlink(args->server_socket);
+
+    close(_server_stop_pipe[0]);
+    close(_server_stop_pipe[1]);
+
+    pthread_attr_destroy(&attr);
+    pthread_cond_destroy(&(server.request_done));
+    pthread_mutex_destroy(&(server.lock));
+    io_memcache_destroy(server.args.memory_cache);
+
+    return 0;
+}
+
+// Sends a single input to the server, writes out the response and returns its status (1 if it could not be sent)
+int _client_compile(const context_args_t* args, const char* path) {
+    struct sockaddr_un address;
+    if(_server_make_address(args->client_socket, &address) != 0) return 1;
+
+    io_source_t* source = NULL;
+    char resolved[PATH_MAX];
+
+    // Server may run in a different directory, so paths are sent absolute and stdin is sent whole
+    if(strcmp(path, "-") == 0) {
+        source = io_read_source_file(stdin);
+        if(source == NULL) return 1;
+    } else if(realpath(path, resolved) == NULL) {
+        fprintf(stderr, "[context] Error: cannot open file %s for reading.\n", path);
+        return 1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0 || connect(fd, (struct sockaddr*) &address, sizeof(address)) != 0) {
+        fprintf(stderr, "[client] Error: cannot connect to the server at %s: %s\n", args->client_socket, strerror(errno));
+        if(fd >= 0) close(fd);
+        io_source_destroy(source);
+        return 1;
+    }
+
+    char* header = malloc(CONTEXT_SERVER_MAX_HEADER);
+    int header_length = 0;
+
+    if(source != NULL) {
+        header_length = snprintf(header, CONTEXT_SERVER_MAX_HEADER, "%s\nstage %d\nformat %s\nsource %zu\n\n", CONTEXT_SERVER_PROTOCOL,
+            (int) args->output_stage, args->output_format == FORMAT_BINARY ? "binary" : "text", source->length
+        );
+    } else {
+        header_length = snprintf(header, CONTEXT_SERVER_MAX_HEADER, "%s\nstage %d\nformat %s\npath %s\n\n", CONTEXT_SERVER_PROTOCOL,
+            (int) args->output_stage, args->output_format == FORMAT_BINARY ? "binary" : "text", resolved
+        );
+    }
+
+    // Server may refuse the request before reading all of it, the response still tells why
+    if(_server_write_all(fd, header, (size_t) header_length) == 0 && source != NULL) {
+        _server_write_all(fd, source->contents, source->length);
+    }
+
+    io_source_destroy(source);
+
+    size_t status = 1;
+    size_t output_length = 0;
+    size_t diagnostics_length = 0;
+
+    int failed = _server_read_header(fd, header, CONTEXT_SERVER_MAX_HEADER) != 0
+        || strncmp(header, CONTEXT_SERVER_PROTOCOL "\n", strlen(CONTEXT_SERVER_PROTOCOL) + 1) != 0
+        || _server_find_number(header, "status", &status) != 0
+        || _server_find_number(header, "output", &output_length) != 0
+        || _server_find_number(header, "diagnostics", &diagnostics_length) != 0;
+
+    // Contents are passed through in blocks, so that big outputs do not have to fit in memory
+    char block[64 * 1024];
+    for(int stream = 0; stream < 2 && !failed; stream++) {
+        size_t remaining = stream == 0 ? output_length : diagnostics_length;
+        FILE* destination = stream == 0 ? args->output_file : stderr;
+
+        while(remaining != 0 && !failed) {
+            size_t length = remaining < sizeof(block) ? remaining : sizeof(block);
+
+            failed = _server_read_all(fd, block, length);
+            if(!failed) fwrite(block, 1, length, destination);
+
+            remaining -= length;
+        }
+
+        // Keeps the diagnostics after the output they follow, like the outputs of the driver
+        fflush(destination);
+    }
+
+    if(failed) {
+        fprintf(stderr, "[client] Error: no valid response from the server for %s\n", path);
+    }
+
+    close(fd);
+    free(header);
+
+    return failed || status != 0;
+}
+
+size_t context_client_run(const context_args_t* args) {
+    signal(SIGPIPE, SIG_IGN);
+
+    size_t num_failed = 0;
+    for(size_t i = 0; i < UTILS_VEC_LENGTH(&(args->inputs)); i++) {
+        num_failed += _client_compile(args, UTILS_VEC_AT(&(args->inputs), i)) != 0;
+    }
+
+    return num_failed;
+}
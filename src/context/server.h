@@ -0,0 +1,66 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// server - Compile server, which keeps running and compiles inputs sent over a Unix socket
+
+// The server keeps its state between the requests: results of inputs it has already seen are kept in memory
+// (up to a limit, see io/memcache.h), next to the optional cache directory, and there is no process to start.
+// Every connection carries a single request, requests are handled at the same time by up to -j threads.
+// If the client goes away before the response is ready, the request is cancelled. A connection which does not
+// send the whole header within CONTEXT_SERVER_HEADER_TIMEOUT_MS, or before the server is stopped, is dropped.
+//
+// Request and response begin with a header of "key value" lines, ended with an empty line:
+//
+//  request:    DCRTC 1                 response:   DCRTC 1
+//              stage <number>                      status <0 - ok, 1 - error>
+//              format <text|binary>                output <length>
+//              path <absolute path>                diagnostics <length>
+//           or source <length>
+//              output <absolute path>  (optional, the output is written there instead of being sent back)
+//
+// Then the request carries length bytes of the source (if the source was sent instead of a path),
+// and the response carries the output and the diagnostics, one after another.
+
+#ifndef _I_CONTEXT_SERVER_H_
+#define _I_CONTEXT_SERVER_H_
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "args.h"
+#include "io/fileread.h"
+
+#define CONTEXT_SERVER_PROTOCOL "DCRTC 1"
+
+// Longest header of a request or a response
+#define CONTEXT_SERVER_MAX_HEADER ((size_t) 64 * 1024)
+
+// Time for the client to send the header of the request after connecting
+#define CONTEXT_SERVER_HEADER_TIMEOUT_MS 10000
+
+// Compiles the source (and destroys it), writing the output into outfile with up to num_threads threads
+// Diagnostics go to UTILS_DIAG (see utils/diag.h). Returns 0 if ok, 1 if error
+typedef int (*context_compile_source_fn_t)(const context_args_t* args, io_source_t* source, FILE* outfile, size_t num_threads);
+
+// Listens on args->server_socket and compiles the requests with compile, until SIGINT or SIGTERM
+// Return value: 0 if ok, 1 if error
+int context_server_run(const context_args_t* args, context_compile_source_fn_t compile);
+
+// Sends every input of args to the server at args->client_socket and writes out what comes back
+// Return value: number of inputs which failed to compile (or could not be sent)
+size_t context_client_run(const context_args_t* args);
+
+#endif
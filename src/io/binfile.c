@@ -0,0 +1,146 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// binfile - Binary files with the output of a stage, which the compiler can also start from
+
+#include "binfile.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include "utils/diag.h"
+
+// Offset rounded up to the alignment of the sections
+#define ALIGN_UP(offset) (((offset) + IO_BINFILE_ALIGNMENT - 1) / IO_BINFILE_ALIGNMENT * IO_BINFILE_ALIGNMENT)
+
+void io_binfile_writer_init(io_binfile_writer_t* w, uint32_t stage) {
+    w->stage = stage;
+    w->num_sections = 0;
+}
+
+void io_binfile_writer_add(io_binfile_writer_t* w, io_binfile_section_kind_t kind, const void* contents, size_t element_size, size_t num_elements) {
+    io_binfile_section_t* section = w->sections + w->num_sections;
+
+    section->kind = (uint32_t) kind;
+    section->element_size = (uint32_t) element_size;
+    section->offset = 0;
+    section->num_elements = (uint64_t) num_elements;
+
+    w->contents[w->num_sections] = contents;
+    w->num_sections += 1;
+}
+
+int io_binfile_write(io_binfile_writer_t* w, FILE* outfile) {
+    static const char padding[IO_BINFILE_ALIGNMENT] = { 0 };
+
+    io_binfile_header_t header = { 0 };
+    memcpy(header.magic, IO_BINFILE_MAGIC, IO_BINFILE_MAGIC_LENGTH);
+    header.version = IO_BINFILE_VERSION;
+    header.stage = w->stage;
+    header.num_sections = w->num_sections;
+
+    // Lay the sections out one after another, after the table
+    uint64_t offset = ALIGN_UP(sizeof(io_binfile_header_t) + w->num_sections * sizeof(io_binfile_section_t));
+    for(uint32_t i = 0; i < w->num_sections; i++) {
+        w->sections[i].offset = offset;
+        offset = ALIGN_UP(offset + w->sections[i].element_size * w->sections[i].num_elements);
+    }
+
+    size_t written = sizeof(io_binfile_header_t) + w->num_sections * sizeof(io_binfile_section_t);
+    fwrite(&header, sizeof(io_binfile_header_t), 1, outfile);
+    fwrite(w->sections, sizeof(io_binfile_section_t), w->num_sections, outfile);
+
+    for(uint32_t i = 0; i < w->num_sections; i++) {
+        fwrite(padding, 1, w->sections[i].offset - written, outfile);
+
+        size_t size = w->sections[i].element_size * w->sections[i].num_elements;
+        if(size != 0) fwrite(w->contents[i], 1, size, outfile);
+
+        written = w->sections[i].offset + size;
+    }
+
+    if(fflush(outfile) != 0 || ferror(outfile)) {
+        fprintf(UTILS_DIAG, "[io] Error writing binary output: %s\n", strerror(errno));
+        return 1;
+    }
+
+    return 0;
+}
+
+int io_binfile_is_binary(const char* data, size_t length) {
+    return length >= IO_BINFILE_MAGIC_LENGTH && memcmp(data, IO_BINFILE_MAGIC, IO_BINFILE_MAGIC_LENGTH) == 0;
+}
+
+int io_binfile_open(io_binfile_t* binfile, const char* data, size_t length) {
+    if(length < sizeof(io_binfile_header_t) || !io_binfile_is_binary(data, length)) {
+        fprintf(UTILS_DIAG, "[io] Error reading binary input: not a binary file\n");
+        return 1;
+    }
+
+    const io_binfile_header_t* header = (const io_binfile_header_t*) data;
+
+    if(header->version != IO_BINFILE_VERSION) {
+        fprintf(UTILS_DIAG, "[io] Error reading binary input: unsupported version %u (expected %u)\n", header->version, IO_BINFILE_VERSION);
+        return 1;
+    }
+
+    if(header->num_sections > IO_BINFILE_SECTIONS_NUM || sizeof(io_binfile_header_t) + header->num_sections * sizeof(io_binfile_section_t) > length) {
+        fprintf(UTILS_DIAG, "[io] Error reading binary input: invalid table of sections\n");
+        return 1;
+    }
+
+    const io_binfile_section_t* sections = (const io_binfile_section_t*) (data + sizeof(io_binfile_header_t));
+
+    // Every section has to be within the file, so that the contents can be used without further checks
+    for(uint32_t i = 0; i < header->num_sections; i++) {
+        const io_binfile_section_t* section = sections + i;
+
+        if(section->offset % IO_BINFILE_ALIGNMENT != 0 || section->offset > length || section->element_size == 0
+            || section->num_elements > (length - section->offset) / section->element_size) {
+            fprintf(UTILS_DIAG, "[io] Error reading binary input: section %u is out of bounds\n", i);
+            return 1;
+        }
+    }
+
+    binfile->stage = header->stage;
+    binfile->data = data;
+    binfile->length = length;
+    binfile->sections = sections;
+    binfile->num_sections = header->num_sections;
+
+    return 0;
+}
+
+const void* io_binfile_get(const io_binfile_t* binfile, io_binfile_section_kind_t kind, size_t element_size, size_t* num_elements) {
+    for(uint32_t i = 0; i < binfile->num_sections; i++) {
+        const io_binfile_section_t* section = binfile->sections + i;
+
+        if(section->kind != (uint32_t) kind) continue;
+
+        if(section->element_size != element_size) {
+            fprintf(UTILS_DIAG, "[io] Error reading binary input: section %u has elements of an unexpected size\n", i);
+            return NULL;
+        }
+
+        *num_elements = (size_t) section->num_elements;
+        return binfile->data + section->offset;
+    }
+
+    fprintf(UTILS_DIAG, "[io] Error reading binary input: missing section %u\n", (unsigned) kind);
+    return NULL;
+}
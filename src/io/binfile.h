@@ -0,0 +1,155 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// binfile - Binary files with the output of a stage, which the compiler can also start from
+
+// A binary file is a header, followed by a table of sections and the contents of the sections.
+// Every section is an array of fixed size elements (or of chars), stored exactly the way it is
+// used in memory, so no element has to be parsed. The token arrays of the lexing stage are used
+// in place, straight from the mapped file. The arrays of the AST of the parsing stage are copied
+// into its vecs (one block per section, checked afterwards), since the AST owns and grows them.
+// Names (in both stages) and types are put back into their tables, since those are hash tables.
+// Everything is in the byte order of the machine which wrote the file, offsets of the sections
+// are relative to the beginning of the file and the contents of every section are 8-byte aligned.
+// Elements never refer to each other with pointers, only with ids and indices.
+//
+// Which sections are present depends on the stage of the file:
+//  - lexing stage: SOURCE, NAMES, NAME_OFFSETS, TOKEN_TYPES, TOKEN_OFFSETS, TOKEN_LENGTHS,
+//    TOKEN_PAYLOADS, VALUES and LINES, the arrays of lexer_token_list_t (see token_list.h)
+//  - parsing stage: NAMES, NAME_OFFSETS, TYPES, TYPE_ARGS, DECLS, EXPRS, EXPR_ARGS, STMTS, ROUTINES,
+//    LOCALS and LITERALS, the arrays of ast_global_scope_t (see ast.h)
+// NAMES holds all the interned identifiers, null-terminated and one after another, NAME_OFFSETS holds
+// the offset of every one of them, in the order of their ids (those of the builtin types come first).
+// TYPES holds every type of the type table in the order of ids, as io_binfile_type_t, so children
+// always come before the types built from them. In the same way every expression in EXPRS refers only to
+// the ones before it, and is referred to at most once, so the expressions form trees and never cycles.
+//
+// The version has to be increased whenever any of the above changes.
+
+#ifndef _I_IO_BINFILE_H_
+#define _I_IO_BINFILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define IO_BINFILE_MAGIC "DCRTBIN" // 8 bytes with the null byte
+#define IO_BINFILE_MAGIC_LENGTH 8
+#define IO_BINFILE_VERSION 2
+
+// Contents of every section start at a multiple of this
+#define IO_BINFILE_ALIGNMENT 8
+
+// Stage of the file, same numbers as context_stage_t
+#define IO_BINFILE_STAGE_LEXER 0
+#define IO_BINFILE_STAGE_PARSER 1
+
+enum io_binfile_section_kind_t {
+    IO_BINFILE_SECTION_SOURCE = 0,      // char, the source code with a null byte
+    IO_BINFILE_SECTION_NAMES,           // char
+    IO_BINFILE_SECTION_NAME_OFFSETS,    // uint32_t
+    IO_BINFILE_SECTION_TOKEN_TYPES,     // uint8_t
+    IO_BINFILE_SECTION_TOKEN_OFFSETS,   // uint32_t
+    IO_BINFILE_SECTION_TOKEN_LENGTHS,   // uint32_t
+    IO_BINFILE_SECTION_TOKEN_PAYLOADS,  // uint32_t
+    IO_BINFILE_SECTION_VALUES,          // uint64_t
+    IO_BINFILE_SECTION_LINES,           // uint32_t
+    IO_BINFILE_SECTION_TYPES,           // io_binfile_type_t
+    IO_BINFILE_SECTION_TYPE_ARGS,       // uint32_t, ids of the arg types of routines
+    IO_BINFILE_SECTION_DECLS,           // ast_decl_t, written as it is
+    IO_BINFILE_SECTION_EXPRS,           // ast_expr_t, written as it is
+    IO_BINFILE_SECTION_EXPR_ARGS,       // uint32_t, args of calls
+    IO_BINFILE_SECTION_STMTS,           // ast_stmt_t, written as it is
+    IO_BINFILE_SECTION_ROUTINES,        // ast_routine_t, written as it is
+    IO_BINFILE_SECTION_LOCALS,          // ast_decl_t, params and declarations inside of routines
+    IO_BINFILE_SECTION_LITERALS,        // char, text of string and char literals
+#define IO_BINFILE_SECTIONS_NUM 18
+};
+typedef enum io_binfile_section_kind_t io_binfile_section_kind_t;
+
+struct io_binfile_header_t {
+    char magic[IO_BINFILE_MAGIC_LENGTH];
+    uint32_t version;
+    uint32_t stage;
+    uint32_t num_sections;
+    uint32_t reserved;
+};
+typedef struct io_binfile_header_t io_binfile_header_t;
+
+// Entry of the table of sections, which directly follows the header
+struct io_binfile_section_t {
+    uint32_t kind;
+    uint32_t element_size;
+    uint64_t offset;        // From the beginning of the file
+    uint64_t num_elements;
+};
+typedef struct io_binfile_section_t io_binfile_section_t;
+
+// Element of the TYPES section
+// Builtin: payload is the builtin id, pointer: payload is the id of the type pointed to,
+// routine: payload is the id of the return type and the args are num_args ids in TYPE_ARGS from first_arg
+// (num_args is IO_BINFILE_NO_ARGS if the routine has no argument list at all)
+struct io_binfile_type_t {
+    uint32_t family;
+    uint32_t payload;
+    uint32_t first_arg;
+    uint32_t num_args;
+};
+typedef struct io_binfile_type_t io_binfile_type_t;
+
+#define IO_BINFILE_NO_ARGS UINT32_MAX
+
+// Sections collected to be written, the contents are only referenced and have to stay alive until then
+struct io_binfile_writer_t {
+    uint32_t stage;
+    uint32_t num_sections;
+    io_binfile_section_t sections[IO_BINFILE_SECTIONS_NUM];
+    const void* contents[IO_BINFILE_SECTIONS_NUM];
+};
+typedef struct io_binfile_writer_t io_binfile_writer_t;
+
+void io_binfile_writer_init(io_binfile_writer_t* w, uint32_t stage);
+
+// Adds the section, every kind can be added once
+void io_binfile_writer_add(io_binfile_writer_t* w, io_binfile_section_kind_t kind, const void* contents, size_t element_size, size_t num_elements);
+
+// Writes the header, the table and all the added sections
+// Return value: 0 if ok, 1 if error (reported on stderr)
+int io_binfile_write(io_binfile_writer_t* w, FILE* outfile);
+
+// Binary file loaded into memory, the sections point straight into it
+struct io_binfile_t {
+    uint32_t stage;
+    const char* data;
+    size_t length;
+    const io_binfile_section_t* sections;
+    uint32_t num_sections;
+};
+typedef struct io_binfile_t io_binfile_t;
+
+// Returns 1 if the data begins like a binary file, 0 otherwise
+int io_binfile_is_binary(const char* data, size_t length);
+
+// Checks the header and the table of sections of the data (which has to be 8-byte aligned)
+// Only the binfile structure is filled in, data has to stay alive as long as it is used
+// Return value: 0 if ok, 1 if error (reported on stderr)
+int io_binfile_open(io_binfile_t* binfile, const char* data, size_t length);
+
+// Returns the contents of the section and stores the number of its elements in num_elements,
+// or returns NULL if it is missing or its elements are not element_size bytes long (reported on stderr)
+const void* io_binfile_get(const io_binfile_t* binfile, io_binfile_section_kind_t kind, size_t element_size, size_t* num_elements);
+
+#endif
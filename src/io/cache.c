@@ -0,0 +1,152 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// cache - Directory of saved stage results, looked up by the contents of the input
+
+// mkstemps(), fchmod() and fdopen() are not a part of C99
+#define _DEFAULT_SOURCE
+
+#include "cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "version.h"
+#include "binfile.h"
+#include "utils/diag.h"
+
+// Two differently seeded hashes make up the key, so that collisions are not a concern
+#define CACHE_SEED_LOW ((uint64_t) 0x9E3779B97F4A7C15u)
+#define CACHE_SEED_HIGH ((uint64_t) 0xC2B2AE3D27D4EB4Fu)
+#define CACHE_HASH_MULTIPLIER ((uint64_t) 0xFF51AFD7ED558CCDu)
+
+// Mixes the bits of the whole word, so that every input bit affects every output bit
+uint64_t _cache_mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= CACHE_HASH_MULTIPLIER;
+    h ^= h >> 33;
+    return h;
+}
+
+// Hashes the data 8 bytes at a time, inputs are large so it has to be fast rather than cryptographic
+uint64_t _cache_hash(const char* data, size_t length, uint64_t seed) {
+    uint64_t h = seed ^ (uint64_t) length;
+
+    size_t i = 0;
+    for(; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        h = (h ^ _cache_mix(word)) * CACHE_HASH_MULTIPLIER + seed;
+    }
+
+    uint64_t tail = 0;
+    memcpy(&tail, data + i, length - i);
+    h = (h ^ _cache_mix(tail)) * CACHE_HASH_MULTIPLIER;
+
+    return _cache_mix(h);
+}
+
+void io_cache_make_key(const char* data, size_t length, uint32_t stage, char key[IO_CACHE_KEY_LENGTH + 1]) {
+    // Everything which changes the result, except for the input itself
+    char version[256];
+    snprintf(version, sizeof(version), "%s|%s|%u|%u", DCRTC_COMMIT_ID, DCRTC_BUILD_DATE, (unsigned) IO_BINFILE_VERSION, (unsigned) stage);
+
+    uint64_t low = _cache_hash(data, length, CACHE_SEED_LOW) ^ _cache_hash(version, strlen(version), CACHE_SEED_HIGH);
+    uint64_t high = _cache_hash(data, length, CACHE_SEED_HIGH) ^ _cache_hash(version, strlen(version), CACHE_SEED_LOW);
+
+    snprintf(key, IO_CACHE_KEY_LENGTH + 1, "%016llx%016llx", (unsigned long long) high, (unsigned long long) low);
+}
+
+// Returns a new string with the path of a file in the directory
+char* _cache_path(const char* dir, const char* name, const char* suffix) {
+    size_t length = strlen(dir) + 1 + strlen(name) + strlen(suffix) + 1;
+    char* path = malloc(length);
+
+    snprintf(path, length, "%s/%s%s", dir, name, suffix);
+    return path;
+}
+
+io_source_t* io_cache_load(const char* dir, const char* key) {
+    char* path = _cache_path(dir, key, ".bin");
+
+    FILE* file = fopen(path, "r");
+    free(path);
+
+    if(file == NULL) return NULL;
+
+    // The file stays mapped after it is closed
+    io_source_t* entry = io_read_source_file(file);
+    fclose(file);
+
+    return entry;
+}
+
+int io_cache_begin_store(const char* dir, const char* key, io_cache_entry_t* entry) {
+    // Temporary name is made unique by mkstemps(), so concurrent writers of the same entry do not clash,
+    // whether they are other processes or other threads of this one, and a file left behind by a crashed
+    // writer does not block the entry
+    entry->path = _cache_path(dir, key, ".bin");
+    entry->temp_path = _cache_path(dir, key, ".XXXXXX.tmp");
+    entry->file = NULL;
+
+    int fd = mkstemps(entry->temp_path, strlen(".tmp"));
+
+    // mkstemps() makes the file readable only by its owner, but the entries are meant to be shared
+    if(fd >= 0 && fchmod(fd, 0644) == 0) {
+        entry->file = fdopen(fd, "w");
+    }
+
+    if(entry->file == NULL) {
+        fprintf(UTILS_DIAG, "[cache] Error: cannot create %s: %s\n", entry->temp_path, strerror(errno));
+        if(fd >= 0) {
+            close(fd);
+            unlink(entry->temp_path);
+        }
+        free(entry->path);
+        free(entry->temp_path);
+        return 1;
+    }
+
+    return 0;
+}
+
+int io_cache_end_store(io_cache_entry_t* entry, int failed) {
+    if(fclose(entry->file) != 0 && !failed) {
+        fprintf(UTILS_DIAG, "[cache] Error: cannot write %s: %s\n", entry->temp_path, strerror(errno));
+        failed = 1;
+    }
+
+    // Replacing an existing entry is fine, it has the same contents
+    if(!failed && rename(entry->temp_path, entry->path) != 0) {
+        fprintf(UTILS_DIAG, "[cache] Error: cannot rename %s: %s\n", entry->temp_path, strerror(errno));
+        failed = 1;
+    }
+
+    if(failed) {
+        unlink(entry->temp_path);
+    }
+
+    free(entry->path);
+    free(entry->temp_path);
+
+    return failed;
+}
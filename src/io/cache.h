@@ -0,0 +1,58 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// cache - Directory of saved stage results, looked up by the contents of the input
+
+// Every entry is the binary output of a stage (see binfile.h), named after a key which is a hash
+// of the input, the stage and the version of the compiler (any change to one of them gives a
+// different key, so entries never have to be invalidated, only removed when they are not needed).
+// Entries are written to a temporary file first and then renamed, so many compilers can share
+// one directory at the same time - the others see either the whole entry or nothing.
+
+#ifndef _I_IO_CACHE_H_
+#define _I_IO_CACHE_H_
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fileread.h"
+
+// Length of the key in chars, without the null byte
+#define IO_CACHE_KEY_LENGTH 32
+
+// Entry which is being written
+struct io_cache_entry_t {
+    FILE* file;         // Stage output is written here
+    char* temp_path;
+    char* path;
+};
+typedef struct io_cache_entry_t io_cache_entry_t;
+
+// Computes the key of the result of the stage for the input data
+void io_cache_make_key(const char* data, size_t length, uint32_t stage, char key[IO_CACHE_KEY_LENGTH + 1]);
+
+// Returns the entry with the key loaded into memory, or NULL if there is none (not an error)
+io_source_t* io_cache_load(const char* dir, const char* key);
+
+// Starts writing a new entry, returns 0 if ok or 1 if error (reported on stderr)
+int io_cache_begin_store(const char* dir, const char* key, io_cache_entry_t* entry);
+
+// Finishes the entry, so that it becomes visible. If failed is not 0, the entry is thrown away instead
+// Return value: 0 if ok, 1 if error (reported on stderr)
+int io_cache_end_store(io_cache_entry_t* entry, int failed);
+
+#endif
@@ -16,28 +16,150 @@
 
 // fileread - Wrappers for system file IO
 
+// mmap(), madvise() and MAP_ANONYMOUS are not a part of C99
+#define _DEFAULT_SOURCE
+
 #include "fileread.h"
 
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "utils/diag.h"
+
+// Streams are read in chunks, doubling the buffer whenever it fills up
+#define STREAM_INITIAL_BUFFER_SIZE (64 * 1024)
+
+// Empty files cannot be mapped, they get a static empty string instead
+static const char _empty_source[] = "";
+
+// Maps a regular file of a known size into memory
+// The mapping is followed by at least one whole page of zeros, which both terminates the string
+// and keeps aligned reads past the end within mapped memory:
+// first a large enough anonymous mapping is reserved, then the file is mapped over its beginning
+io_source_t* _map_regular_file(int fd, size_t filesize, io_source_t* source) {
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    size_t mapping_length = ((filesize + page_size - 1) / page_size) * page_size + page_size;
+
+    void* mapping = mmap(NULL, mapping_length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(mapping == MAP_FAILED) {
+        fprintf(UTILS_DIAG, "[io] Error reading source: cannot reserve memory: %s\n", strerror(errno));
+        free(source);
+        return NULL;
+    }
+
+    if(mmap(mapping, filesize, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        fprintf(UTILS_DIAG, "[io] Error reading source: cannot map file: %s\n", strerror(errno));
+        munmap(mapping, mapping_length);
+        free(source);
+        return NULL;
+    }
+
+    // Lexer goes through the source once from the beginning to the end
+    madvise(mapping, filesize, MADV_SEQUENTIAL);
+
+    source->contents = mapping;
+    source->length = filesize;
+    source->mapping = mapping;
+    source->mapping_length = mapping_length;
+
+    return source;
+}
+
+// Reads a stream of unknown length (pipe, terminal, stdin) until EOF
+io_source_t* _read_stream(FILE* infile, io_source_t* source) {
+    size_t alloc_length = STREAM_INITIAL_BUFFER_SIZE;
+    size_t length = 0;
+    char* buffer = malloc(alloc_length);
+
+    while(1) {
+        // Always keep one byte for the terminator
+        if(length + 1 >= alloc_length) {
+            alloc_length *= 2;
+            buffer = realloc(buffer, alloc_length);
+        }
+
+        size_t read_length = fread(buffer + length, 1, alloc_length - length - 1, infile);
+        length += read_length;
+
+        if(read_length == 0) {
+            if(ferror(infile)) {
+                fprintf(UTILS_DIAG, "[io] Error reading source: %s\n", strerror(errno));
+                free(buffer);
+                free(source);
+                return NULL;
+            }
+
+            break;
+        }
+    }
+
+    buffer[length] = '\0';
+
+    source->contents = buffer;
+    source->length = length;
+    source->mapping = NULL;
+    source->mapping_length = 0;
+
+    return source;
+}
 
-char* io_read_source_file(FILE* infile) {
+io_source_t* io_read_source_file(FILE* infile) {
     if(infile == NULL) {
-        fprintf(stderr, "[io] Error reading source: file was not provided\n");
+        fprintf(UTILS_DIAG, "[io] Error reading source: file was not provided\n");
+        return NULL;
+    }
+
+    io_source_t* source = malloc(sizeof(io_source_t));
+
+    int fd = fileno(infile);
+
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) != 0) {
+        fprintf(UTILS_DIAG, "[io] Error reading source: %s\n", strerror(errno));
+        free(source);
         return NULL;
     }
 
-    // https://stackoverflow.com/a/14002993/5457426
-    fseek(infile, 0, SEEK_END);
-    long filesize = ftell(infile);
-    fseek(infile, 0, SEEK_SET);
+    // Only regular files have a meaningful size and can be mapped
+    if(!S_ISREG(file_stat.st_mode)) {
+        return _read_stream(infile, source);
+    }
+
+    if(file_stat.st_size == 0) {
+        source->contents = _empty_source;
+        source->length = 0;
+        source->mapping = NULL;
+        source->mapping_length = 0;
+        return source;
+    }
+
+    return _map_regular_file(fd, (size_t) file_stat.st_size, source);
+}
 
-    char* filecontents = malloc(filesize + 1);
+io_source_t* io_source_from_buffer(char* buffer, size_t length) {
+    io_source_t* source = malloc(sizeof(io_source_t));
 
-    fread(filecontents, 1, filesize, infile);
-    filecontents[filesize] = '\0';
+    source->contents = buffer;
+    source->length = length;
+    source->mapping = NULL;
+    source->mapping_length = 0;
+
+    return source;
+}
+
+void io_source_destroy(io_source_t* source) {
+    if(source == NULL) return;
+
+    if(source->mapping != NULL) {
+        munmap(source->mapping, source->mapping_length);
+    } else if(source->contents != _empty_source) {
+        free((char*) source->contents);
+    }
 
-    return filecontents;
+    free(source);
 }
@@ -20,7 +20,27 @@
 #define _I_IO_FILEREAD_H_
 
 #include <stdio.h>
+#include <stddef.h>
 
-char* io_read_source_file(FILE* infile);
+// Source code loaded into memory as a null-terminated, read-only string
+// Regular files are mapped into memory, so nothing is copied. Pipes, terminals etc. are read into a malloc'ed buffer.
+// In both cases the memory past the terminator is readable up to the end of its page (scans in lexer/scan.h rely on it).
+struct io_source_t {
+    const char* contents;   // Null-terminated source code
+    size_t length;          // Length in bytes, without the terminator
+    void* mapping;          // Start of the mapping if the file was mapped, NULL otherwise
+    size_t mapping_length;  // Length of the mapping in bytes
+};
+typedef struct io_source_t io_source_t;
+
+// Reads the whole file into memory, returns NULL on error
+// The returned structure is malloc'ed and has to be released with io_source_destroy()
+io_source_t* io_read_source_file(FILE* infile);
+
+// Wraps a malloc'ed buffer of length bytes followed by a null byte, which the source then owns
+io_source_t* io_source_from_buffer(char* buffer, size_t length);
+
+// Releases the memory holding the source, contents cannot be used afterwards
+void io_source_destroy(io_source_t* source);
 
 #endif
@@ -0,0 +1,163 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// memcache - Stage results kept in memory, for a process which compiles many inputs over time
+
+#include "memcache.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "utils/intern.h"
+
+#define DEFAULT_BUCKETS_NUM 1024
+
+struct io_memcache_entry_t {
+    char key[IO_CACHE_KEY_LENGTH + 1];
+    char* data;
+    size_t length;
+
+    struct io_memcache_entry_t* next_in_bucket;
+    struct io_memcache_entry_t* newer;
+};
+
+io_memcache_t* io_memcache_make(size_t limit) {
+    io_memcache_t* cache = malloc(sizeof(io_memcache_t));
+
+    cache->limit = limit;
+    cache->size = 0;
+
+    cache->num_buckets = DEFAULT_BUCKETS_NUM;
+    cache->buckets = calloc(cache->num_buckets, sizeof(struct io_memcache_entry_t*));
+
+    cache->oldest = NULL;
+    cache->newest = NULL;
+
+    pthread_mutex_init(&(cache->lock), NULL);
+
+    return cache;
+}
+
+void io_memcache_destroy(io_memcache_t* cache) {
+    if(cache == NULL) return;
+
+    struct io_memcache_entry_t* entry = cache->oldest;
+    while(entry != NULL) {
+        struct io_memcache_entry_t* newer = entry->newer;
+        free(entry->data);
+        free(entry);
+        entry = newer;
+    }
+
+    pthread_mutex_destroy(&(cache->lock));
+    free(cache->buckets);
+    free(cache);
+}
+
+size_t _io_memcache_bucket(const io_memcache_t* cache, const char* key) {
+    return utils_intern_hash(key, IO_CACHE_KEY_LENGTH) & (cache->num_buckets - 1);
+}
+
+// Returns the pointer which points to the entry with the key (or to NULL, at the end of the chain)
+struct io_memcache_entry_t** _io_memcache_find(io_memcache_t* cache, const char* key) {
+    struct io_memcache_entry_t** link = cache->buckets + _io_memcache_bucket(cache, key);
+
+    while(*link != NULL && strcmp((*link)->key, key) != 0) {
+        link = &((*link)->next_in_bucket);
+    }
+
+    return link;
+}
+
+// Throws away the oldest entry
+void _io_memcache_evict(io_memcache_t* cache) {
+    struct io_memcache_entry_t* entry = cache->oldest;
+
+    struct io_memcache_entry_t** link = _io_memcache_find(cache, entry->key);
+    *link = entry->next_in_bucket;
+
+    cache->oldest = entry->newer;
+    if(cache->oldest == NULL) cache->newest = NULL;
+
+    cache->size -= entry->length;
+    free(entry->data);
+    free(entry);
+}
+
+io_source_t* io_memcache_load(io_memcache_t* cache, const char* key) {
+    pthread_mutex_lock(&(cache->lock));
+
+    struct io_memcache_entry_t* entry = *_io_memcache_find(cache, key);
+
+    io_source_t* source = NULL;
+    if(entry != NULL) {
+        // The copy is followed by a null byte, same as any other source
+        char* copy = malloc(entry->length + 1);
+        memcpy(copy, entry->data, entry->length);
+        copy[entry->length] = '\0';
+
+        source = io_source_from_buffer(copy, entry->length);
+    }
+
+    pthread_mutex_unlock(&(cache->lock));
+
+    return source;
+}
+
+void io_memcache_store(io_memcache_t* cache, const char* key, const char* data, size_t length) {
+    if(length > cache->limit) return;
+
+    // Copied before taking the lock, so that other threads do not wait for it
+    struct io_memcache_entry_t* new_entry = malloc(sizeof(struct io_memcache_entry_t));
+    memcpy(new_entry->key, key, IO_CACHE_KEY_LENGTH + 1);
+    new_entry->data = malloc(length != 0 ? length : 1);
+    memcpy(new_entry->data, data, length);
+    new_entry->length = length;
+    new_entry->next_in_bucket = NULL;
+    new_entry->newer = NULL;
+
+    pthread_mutex_lock(&(cache->lock));
+
+    struct io_memcache_entry_t** link = _io_memcache_find(cache, key);
+
+    // Another thread may have compiled the same input at the same time
+    if(*link != NULL) {
+        pthread_mutex_unlock(&(cache->lock));
+        free(new_entry->data);
+        free(new_entry);
+        return;
+    }
+
+    while(cache->size + length > cache->limit) {
+        _io_memcache_evict(cache);
+    }
+
+    // Eviction may have changed the chain, so the end of it is looked up again
+    link = _io_memcache_find(cache, key);
+    *link = new_entry;
+
+    if(cache->newest != NULL) {
+        cache->newest->newer = new_entry;
+    } else {
+        cache->oldest = new_entry;
+    }
+    cache->newest = new_entry;
+    cache->size += length;
+
+    pthread_mutex_unlock(&(cache->lock));
+}
@@ -0,0 +1,57 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// memcache - Stage results kept in memory, for a process which compiles many inputs over time
+
+// Same as the cache directory (see cache.h), but the entries are kept in memory, up to a limit of bytes.
+// When the limit is reached, the oldest entries are thrown away first. All the functions can be called
+// from many threads at once.
+
+#ifndef _I_IO_MEMCACHE_H_
+#define _I_IO_MEMCACHE_H_
+
+#include <stddef.h>
+#include <pthread.h>
+
+#include "cache.h"
+#include "fileread.h"
+
+struct io_memcache_entry_t;
+
+struct io_memcache_t {
+    size_t limit;       // Most bytes all the entries may take
+    size_t size;        // Bytes taken by all the entries
+
+    size_t num_buckets; // Always a power of 2
+    struct io_memcache_entry_t** buckets;   // Entries chained by the hash of their keys
+
+    struct io_memcache_entry_t* oldest;     // Entries in the order they were added, for throwing them away
+    struct io_memcache_entry_t* newest;
+
+    pthread_mutex_t lock;
+};
+typedef struct io_memcache_t io_memcache_t;
+
+io_memcache_t* io_memcache_make(size_t limit);
+void io_memcache_destroy(io_memcache_t* cache);
+
+// Returns a copy of the entry with the key, or NULL if there is none
+io_source_t* io_memcache_load(io_memcache_t* cache, const char* key);
+
+// Adds a copy of the data under the key, unless it's there already or the data alone is over the limit
+void io_memcache_store(io_memcache_t* cache, const char* key, const char* data, size_t length);
+
+#endif
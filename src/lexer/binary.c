@@ -0,0 +1,151 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// binary - Binary output of the lexing stage, and loading it back
+
+#include "lexer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "token_list.h"
+#include "token_types.h"
+#include "io/binfile.h"
+#include "utils/intern.h"
+#include "utils/strbuf.h"
+#include "utils/diag.h"
+
+int lexer_write_binary(FILE* outfile, lexer_token_list_t* list, utils_intern_table_t* names) {
+    // Positions of tokens are saved too, so that loading does not need to look for newlines
+    lexer_token_list_index_lines(list);
+
+    utils_strbuf_t blob;
+    utils_strbuf_init(&blob);
+
+    uint32_t* name_offsets = malloc((names->num_strings + 1) * sizeof(uint32_t));
+    utils_intern_table_pack(names, &blob, name_offsets);
+
+    io_binfile_writer_t w;
+    io_binfile_writer_init(&w, IO_BINFILE_STAGE_LEXER);
+
+    io_binfile_writer_add(&w, IO_BINFILE_SECTION_SOURCE, list->source, sizeof(char), strlen(list->source) + 1);
+    io_binfile_writer_add(&w, IO_BINFILE_SECTION_NAMES, UTILS_STRBUF_DATA(&blob), sizeof(char), UTILS_STRBUF_LENGTH(&blob));
+    io_binfile_writer_add(&w, IO_BINFILE_SECTION_NAME_OFFSETS, name_offsets, sizeof(uint32_t), names->num_strings);
+    io_binfile_writer_add(&w, IO_BINFILE_SECTION_TOKEN_TYPES, list->types, sizeof(uint8_t), list->num_tokens);
+    io_binfile_writer_add(&w, IO_BINFILE_SECTION_TOKEN_OFFSETS, list->offsets, sizeof(uint32_t), list->num_tokens);
+    io_binfile_writer_add(&w, IO_BINFILE_SECTION_TOKEN_LENGTHS, list->lengths, sizeof(uint32_t), list->num_tokens);
+    io_binfile_writer_add(&w, IO_BINFILE_SECTION_TOKEN_PAYLOADS, list->payloads, sizeof(uint32_t), list->num_tokens);
+    io_binfile_writer_add(&w, IO_BINFILE_SECTION_VALUES, list->values, sizeof(uint64_t), list->num_values);
+    io_binfile_writer_add(&w, IO_BINFILE_SECTION_LINES, list->line_starts, sizeof(uint32_t), list->num_lines);
+
+    int result = io_binfile_write(&w, outfile);
+
+    free(name_offsets);
+    utils_strbuf_deinit(&blob);
+
+    return result;
+}
+
+// Returns an array of the token list from the section, which has to have an element for every token
+const void* _lexer_binary_get_tokens_array(const io_binfile_t* binfile, io_binfile_section_kind_t kind, size_t element_size, size_t num_tokens) {
+    size_t num = 0;
+
+    const void* arr = io_binfile_get(binfile, kind, element_size, &num);
+    if(arr == NULL) return NULL;
+
+    if(num != num_tokens) {
+        fprintf(UTILS_DIAG, "%s", "[lexer] Error loading binary input: arrays of tokens differ in length\n");
+        return NULL;
+    }
+
+    return arr;
+}
+
+int lexer_load_binary(const io_binfile_t* binfile, utils_intern_table_t* names, lexer_token_list_t* list) {
+    if(binfile->stage != IO_BINFILE_STAGE_LEXER) {
+        fprintf(UTILS_DIAG, "%s", "[lexer] Error loading binary input: not an output of the lexing stage\n");
+        return 1;
+    }
+
+    size_t source_length = 0;
+    size_t blob_length = 0;
+    size_t num_names = 0;
+
+    const char* source = io_binfile_get(binfile, IO_BINFILE_SECTION_SOURCE, sizeof(char), &source_length);
+    const char* blob = io_binfile_get(binfile, IO_BINFILE_SECTION_NAMES, sizeof(char), &blob_length);
+    const uint32_t* name_offsets = io_binfile_get(binfile, IO_BINFILE_SECTION_NAME_OFFSETS, sizeof(uint32_t), &num_names);
+    if(source == NULL || blob == NULL || name_offsets == NULL) return 1;
+
+    if(source_length == 0 || source[source_length - 1] != '\0') {
+        fprintf(UTILS_DIAG, "%s", "[lexer] Error loading binary input: source is not null-terminated\n");
+        return 1;
+    }
+
+    if(names != NULL && utils_intern_table_unpack(names, blob, blob_length, name_offsets, num_names) != 0) {
+        fprintf(UTILS_DIAG, "%s", "[lexer] Error loading binary input: invalid table of names\n");
+        return 1;
+    }
+
+    // The arrays are used in place, the list only points at them
+    list->source = source;
+
+    list->types = (uint8_t*) io_binfile_get(binfile, IO_BINFILE_SECTION_TOKEN_TYPES, sizeof(uint8_t), &(list->num_tokens));
+    if(list->types == NULL) return 1;
+
+    list->offsets = (uint32_t*) _lexer_binary_get_tokens_array(binfile, IO_BINFILE_SECTION_TOKEN_OFFSETS, sizeof(uint32_t), list->num_tokens);
+    list->lengths = (uint32_t*) _lexer_binary_get_tokens_array(binfile, IO_BINFILE_SECTION_TOKEN_LENGTHS, sizeof(uint32_t), list->num_tokens);
+    list->payloads = (uint32_t*) _lexer_binary_get_tokens_array(binfile, IO_BINFILE_SECTION_TOKEN_PAYLOADS, sizeof(uint32_t), list->num_tokens);
+    if(list->offsets == NULL || list->lengths == NULL || list->payloads == NULL) return 1;
+
+    list->values = (uint64_t*) io_binfile_get(binfile, IO_BINFILE_SECTION_VALUES, sizeof(uint64_t), &(list->num_values));
+    list->line_starts = (uint32_t*) io_binfile_get(binfile, IO_BINFILE_SECTION_LINES, sizeof(uint32_t), &(list->num_lines));
+    if(list->values == NULL || list->line_starts == NULL) return 1;
+
+    list->alloc_tokens = list->num_tokens;
+    list->alloc_values = list->num_values;
+    list->alloc_lines = list->num_lines;
+
+    // Nothing is parsed, but everything the tokens refer to has to be within the file
+    if(list->num_lines == 0 || list->line_starts[0] != 0) {
+        fprintf(UTILS_DIAG, "%s", "[lexer] Error loading binary input: invalid index of lines\n");
+        return 1;
+    }
+
+    for(size_t i = 1; i < list->num_lines; i++) {
+        if(list->line_starts[i] < list->line_starts[i - 1] || list->line_starts[i] >= source_length) {
+            fprintf(UTILS_DIAG, "%s", "[lexer] Error loading binary input: invalid index of lines\n");
+            return 1;
+        }
+    }
+
+    for(size_t i = 0; i < list->num_tokens; i++) {
+        lexer_token_type_t type = (lexer_token_type_t) list->types[i];
+        uint32_t payload = list->payloads[i];
+
+        int out_of_bounds = (size_t) list->offsets[i] + list->lengths[i] >= source_length;
+        if(type == TOKEN_IDENTIFIER && names != NULL) out_of_bounds |= payload >= num_names;
+        if(TOKEN_TYPE_IS_NUMERIC(type)) out_of_bounds |= payload >= list->num_values;
+
+        if(out_of_bounds) {
+            fprintf(UTILS_DIAG, "[lexer] Error loading binary input: token %zu is out of bounds\n", i);
+            return 1;
+        }
+    }
+
+    return 0;
+}
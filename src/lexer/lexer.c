@@ -17,12 +17,16 @@
 // lexer - Lexing functionality, recognition of tokens
 
 #include "lexer.h"
+#include "scan.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
-#include <ctype.h>
+#include <stdint.h>
 #include <sys/types.h> // ssize_t
+#include <pthread.h>
+
+#include "utils/diag.h"
 
 // TODO: Handle CRLF newlines? Like, in the entire file
 
@@ -70,202 +74,380 @@ static char* _static_tokens[] = {
 #define NON_KEYWORDS_LAST TOKEN_COMMA
 };
 
-#define STARTING_TOKEN_ALLOC_LENGTH 8
-#define WHITESPACE_CHARS "\t\r\n "
+// The tokenizer is a small state machine driven by the classes of characters below.
+// The class of the first byte of a token decides which kind of token it is, and the
+// remaining bytes are consumed by looking at each one exactly once.
+enum _char_class_t {
+    CC_INVALID = 0, // Cannot appear outside of string/char literals and comments
+    CC_END,         // The null byte terminating the source
+    CC_WHITESPACE,  // "\t\r\n "
+    CC_IDENTIFIER,  // Letters and underscore, may start an identifier or a keyword
+    CC_DIGIT,       // Decimal digits, start a numeric literal (valid inside identifiers too)
+    CC_QUOTE,       // ' and ", start a char or string literal
+    CC_OPERATOR,    // First char of any non-keyword static token
+    CC_COMMENT      // '#', comment until the end of the line
+};
+
+#define XX CC_INVALID
+#define EN CC_END
+#define WS CC_WHITESPACE
+#define ID CC_IDENTIFIER
+#define DG CC_DIGIT
+#define QT CC_QUOTE
+#define OP CC_OPERATOR
+#define CM CC_COMMENT
+static const uint8_t _char_classes[256] = {
+    //        _0  _1  _2  _3  _4  _5  _6  _7  _8  _9  _A  _B  _C  _D  _E  _F
+    /* 0_ */ EN, XX, XX, XX, XX, XX, XX, XX, XX, WS, WS, XX, XX, WS, XX, XX,
+    /* 1_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* 2_ */ WS, OP, QT, CM, OP, XX, OP, QT, OP, OP, OP, OP, OP, OP, OP, OP,
+    /* 3_ */ DG, DG, DG, DG, DG, DG, DG, DG, DG, DG, OP, OP, OP, OP, OP, XX,
+    /* 4_ */ OP, ID, ID, ID, ID, ID, ID, ID, ID, ID, ID, ID, ID, ID, ID, ID,
+    /* 5_ */ ID, ID, ID, ID, ID, ID, ID, ID, ID, ID, ID, OP, XX, OP, OP, ID,
+    /* 6_ */ XX, ID, ID, ID, ID, ID, ID, ID, ID, ID, ID, ID, ID, ID, ID, ID,
+    /* 7_ */ ID, ID, ID, ID, ID, ID, ID, ID, ID, ID, ID, OP, OP, OP, OP, XX,
+    /* 8_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* 9_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* A_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* B_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* C_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* D_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* E_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* F_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+};
+#undef XX
+#undef EN
+#undef WS
+#undef ID
+#undef DG
+#undef QT
+#undef OP
+#undef CM
+
+// Value of a char as a digit of a numeric literal, or 0xFF if its not a digit at all
+// Whether its a valid digit for a given base is checked by comparing with the base
+#define XX 0xFF
+static const uint8_t _digit_values[256] = {
+    //        _0  _1  _2  _3  _4  _5  _6  _7  _8  _9  _A  _B  _C  _D  _E  _F
+    /* 0_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* 1_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* 2_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* 3_ */  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, XX, XX, XX, XX, XX, XX,
+    /* 4_ */ XX, 10, 11, 12, 13, 14, 15, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* 5_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* 6_ */ XX, 10, 11, 12, 13, 14, 15, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* 7_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* 8_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* 9_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* A_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* B_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* C_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* D_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* E_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* F_ */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+};
+#undef XX
+
+// Single-char static tokens, indexed by the char (only valid for CC_OPERATOR chars)
+static const lexer_token_type_t _operator_tokens[256] = {
+    ['@'] = TOKEN_AT,
+    ['$'] = TOKEN_DOLLAR,
+    ['*'] = TOKEN_ASTERISK,
+    ['/'] = TOKEN_SLASH,
+    ['+'] = TOKEN_PLUS,
+    ['-'] = TOKEN_MINUS,
+    ['='] = TOKEN_EQUAL,
+    ['~'] = TOKEN_TILDE,
+    ['&'] = TOKEN_AMPERSAND,
+    ['|'] = TOKEN_PIPE,
+    ['^'] = TOKEN_UP_ARROW,
+    ['!'] = TOKEN_EXCLAMATION,
+    ['<'] = TOKEN_TRIANGLE_LEFT,
+    ['>'] = TOKEN_TRIANGLE_RIGHT,
+    ['.'] = TOKEN_DOT,
+    ['{'] = TOKEN_BRACKET,
+    ['}'] = TOKEN_END_BRACKET,
+    ['['] = TOKEN_SQUARE,
+    [']'] = TOKEN_END_SQUARE,
+    ['('] = TOKEN_PAREN,
+    [')'] = TOKEN_END_PAREN,
+    [':'] = TOKEN_COLON,
+    [';'] = TOKEN_SEMICOLON,
+    [','] = TOKEN_COMMA
+};
 
-// Digit sets for various numeric literals types
-#define DIGITS "0123456789abcdefABCDEF"
+#define CHAR_CLASS(c) (_char_classes[(unsigned char) (c)])
 
 // Check whether char is valid in identifiers
-// 1 for true, 0 for false
 // ATM the rules are: ascii alphanumeric characters + underscore (might change)
-int _is_valid_in_identifiers(char c) {
-    if(c >= 'a' && c <= 'z') return 1;
-
-    if(c >= 'A' && c <= 'Z') return 1;
-
-    if(c >= '0' && c <= '9') return 1;
-
-    if(c == '_') return 1;
-
-    return 0;
-}
+#define IS_VALID_IN_IDENTIFIERS(c) (CHAR_CLASS(c) == CC_IDENTIFIER || CHAR_CLASS(c) == CC_DIGIT)
 
 // First byte after a dynamic or keyword token should either be
 // - whitespace
 // - eof
 // - beginning of a non-keyword token
 //
-// this function checks if the char at src_str meets that criteria
-// Non-keyword static tokens do not have that requirement and do not necessitate the use of that function
-int _is_proper_termination(char* src_str) {
-    // Determine if the token was properly closed: either by whitespace, end of file...
-    if(strchr(WHITESPACE_CHARS, *src_str) != NULL || *src_str == '\0') {
-        return 1;
+// Every multi-char non-keyword token starts with a char which is a valid single-char token
+// on its own, so it's enough to look at the class of the first byte
+// Non-keyword static tokens do not have that requirement and do not necessitate the use of that macro
+#define IS_PROPER_TERMINATION(c) (CHAR_CLASS(c) == CC_WHITESPACE || CHAR_CLASS(c) == CC_END || CHAR_CLASS(c) == CC_OPERATOR)
+
+// Second state of the operator machine - some single-char tokens may be extended by one more char
+// Returns the type of the two-char token, or the single-char type if there is no transition
+lexer_token_type_t _operator_transition(lexer_token_type_t first, char next) {
+    switch(first) {
+        case TOKEN_AMPERSAND:
+            return next == '&' ? TOKEN_DOUBLE_AMPERSAND : first;
+
+        case TOKEN_PIPE:
+            return next == '|' ? TOKEN_DOUBLE_PIPE : first;
+
+        case TOKEN_EQUAL:
+            return next == '=' ? TOKEN_DOUBLE_EQUAL : first;
+
+        case TOKEN_TRIANGLE_LEFT: {
+            if(next == '>') return TOKEN_TWO_TRIANGLES;
+            if(next == '=') return TOKEN_TRIANGLE_EQUAL_LEFT;
+            return first;
+        }
+
+        case TOKEN_TRIANGLE_RIGHT:
+            return next == '=' ? TOKEN_TRIANGLE_EQUAL_RIGHT : first;
+
+        default:
+            return first;
     }
+}
 
-    // ...or a non-keyword token (these are all valid options)
-    for(size_t idx = NON_KEYWORDS_FIRST; idx <= NON_KEYWORDS_LAST; idx++) {
-        char* static_token = _static_tokens[idx];
+// Keywords are recognized after the whole word has been consumed as an identifier,
+// so only a single comparison against the keyword of the same length is needed
+lexer_token_type_t _keyword_or_identifier(const char* src_str, size_t length) {
+    lexer_token_type_t candidate;
+
+    switch(length) {
+        case 2: candidate = TOKEN_RT; break;
+        case 4: candidate = TOKEN_DECL; break;
+        case 5: candidate = TOKEN_CONST; break;
+        case 6: candidate = TOKEN_RETURN; break;
+        default: return TOKEN_IDENTIFIER;
+    }
 
-        if(strncmp(static_token, src_str, strlen(static_token)) == 0) {
-            return 1;
-        }
+    if(memcmp(_static_tokens[candidate], src_str, length) == 0) {
+        return candidate;
     }
 
-    return 0;
+    return TOKEN_IDENTIFIER;
 }
 
 // Determine how long is the token at src_str, and also it's type
 // Return -1 instead, if weird stuff happens (for example, string literal without terminating " before newline/eof)
-ssize_t _determine_token_length_and_type(char* src_str, lexer_token_type_t* token_type) {
+// For identifiers, their hash for the table of names is computed on the way
+ssize_t _determine_token_length_and_type(const char* src_str, lexer_token_type_t* token_type, uint32_t* hash) {
     size_t length = 0;
 
-    // First case: string/char literal
-    if(src_str[length] == '"' || src_str[length] == '\'') {
-        char literal_type = src_str[length]; // Literal type is either ' or "
+    switch(CHAR_CLASS(src_str[0])) {
+        // First case: string/char literal
+        case CC_QUOTE: {
+            char literal_type = src_str[length]; // Literal type is either ' or "
+
+            length++;
+
+            // Consume another char if its not the end of the literal, or if the literal is preceded by '\\' escaping it
+            // The body is skipped in bulk, stopping only at quotes, backslashes and forbidden chars
+            while(1) {
+                length = (size_t) (lexer_scan_literal(src_str + length, literal_type) - src_str);
+
+                char c = src_str[length];
+                if(c == literal_type) break;
 
-        length++;
+                // Check to make sure its not end of file, newline, tab
+                // If there are other characters which have no right to be in a string literal
+                // they should go to lexer_scan_literal()
+                if(c != '\\') return -1;
 
-        // Consume another char if its not the end of the literal, or if the literal is preceded by '\' escaping it
-        while(src_str[length] != literal_type) {
-            // Check to make sure its not end of file, newline, tab
-            // If there are other characters which have no right to be in a string literal
-            // they should go here
-            if(strchr("\0\n\t", src_str[length]) != NULL) return -1;
+                length++;
 
+                // In order to not break the loop we must consume two chars at once in case of \" and \'
+                // Also, in order to handle cases such as "\\"
+                if(src_str[length] == '\\' || src_str[length] == literal_type) length++;
+            }
+
+            // Gotta also include the ending quote/apostrophe
             length++;
-            
-            // In order to not break the loop we must consume two chars at once in case of \" and \'
-            // Also, in order to handle cases such as "\\"
-            if(src_str[length - 1] == '\\' && (src_str[length] == '\\' || src_str[length] == literal_type)) length++;
+
+            if(literal_type == '"') {
+                *token_type = TOKEN_LITERAL_STRING;
+            } else {
+                *token_type = TOKEN_LITERAL_CHAR;
+            }
+
+            break;
         }
 
-        // Gotta also include the ending quote/apostrophe
-        length++;
+        // Second case: numeric literal
+        case CC_DIGIT: {
+            // Determine the base of the literal: 2, 8, 10 or 16
+            unsigned int base = 0;
 
-        // Check if the dynamic token was properly terminated
-        if(_is_proper_termination(src_str + length) == 0) return -1;
+            // If it starts with 0 it may be octal (0) bin (0b) or hex (0x)
+            if(src_str[length] != '0') {
+                base = 10;
+                *token_type = TOKEN_LITERAL_NUMERIC_DEC;
 
-        if(literal_type == '"') {
-            *token_type = TOKEN_LITERAL_STRING;
-        } else {
-            *token_type = TOKEN_LITERAL_CHAR;
-        }
+            } else if(src_str[length + 1] == 'x' || src_str[length + 1] == 'X') {
+                base = 16;
+                *token_type = TOKEN_LITERAL_NUMERIC_HEX;
+                length += 2;
 
-        return (ssize_t) length;
-    }
+            } else if(src_str[length + 1] == 'b' || src_str[length + 1] == 'B') {
+                base = 2;
+                *token_type = TOKEN_LITERAL_NUMERIC_BIN;
+                length += 2;
 
-    // Second case: numeric literal
-    // It has to start with one of the decimal digits, so first 10 characters of the DIGITS string
-    if(memchr(DIGITS, *src_str, 10) != NULL) {
-        // Determine the number of digits to look for (aka the base of hte literal: 2, 8, 10 or 16)
-        size_t digits_len = 0;
-
-        // If it starts with 0 it may be octal (0) bin (0b) or hex (0x)
-        if(src_str[length] != '0') {
-            digits_len = 10; // Decimal
-            *token_type = TOKEN_LITERAL_NUMERIC_DEC;
-
-        } else if(src_str[length + 1] == 'x' || src_str[length + 1] == 'X') {
-            digits_len = sizeof(DIGITS) - 1; // Hex includes all digits
-            *token_type = TOKEN_LITERAL_NUMERIC_HEX;
-            length += 2;
-
-        } else if(src_str[length + 1] == 'b' || src_str[length + 1] == 'B') {
-            digits_len = 2; // Binary
-            *token_type = TOKEN_LITERAL_NUMERIC_BIN;
-            length += 2;
-
-        } else {
-            digits_len = 8; // Octal
-            *token_type = TOKEN_LITERAL_NUMERIC_OCT;
-            length++;
+            } else {
+                base = 8;
+                *token_type = TOKEN_LITERAL_NUMERIC_OCT;
+                length++;
+            }
+
+            // Now just consume chars as long as they are in the digit range
+            while(_digit_values[(unsigned char) src_str[length]] < base) {
+                length++;
+            }
+
+            break;
         }
 
-        // Now just consume chars as long as they are in the digit range
-        while(memchr(DIGITS, src_str[length], digits_len) != NULL) {
-            length++;
+        // Third case: static non-keyword token, at most two chars long
+        // Not necessary to check proper termination for these
+        case CC_OPERATOR: {
+            lexer_token_type_t first = _operator_tokens[(unsigned char) src_str[0]];
+
+            *token_type = _operator_transition(first, src_str[1]);
+            return *token_type == first ? 1 : 2;
         }
 
-        // Check if the dynamic token was properly terminated
-        if(_is_proper_termination(src_str + length) == 0) return -1;
+        // Last case: Identifier or keyword
+        // Consume chars as they go, as long as they meet vague criteria for identifiers which at this point are:
+        // alphanumeric characters + underscore
+        case CC_IDENTIFIER: {
+            uint32_t h = UTILS_INTERN_HASH_INIT;
+
+            while(IS_VALID_IN_IDENTIFIERS(src_str[length])) {
+                h = UTILS_INTERN_HASH_STEP(h, src_str[length]);
+                length++;
+            }
+
+            *hash = h;
 
-        return length;
+            *token_type = _keyword_or_identifier(src_str, length);
+            break;
+        }
+
+        // Anything else cannot start a token
+        default:
+            return -1;
     }
 
-    // Third case: Static token
-    // Just check string equality, also not necessary to check proper termination for static non-keyword tokens
-    size_t longest_match_idx = 0xFFFFFFFF;
-    size_t longest_match_length = 0;
-    for(size_t idx = KEYWORDS_FIRST; idx <= NON_KEYWORDS_LAST; idx++) {
-        char* static_token = _static_tokens[idx];
-        size_t tk_len = strlen(static_token);
-
-        if(strncmp(static_token, src_str, tk_len) == 0) {
-            // Keywords require proper termination
-            if(idx <= KEYWORDS_LAST) {
-                if(_is_proper_termination(src_str + tk_len) == 0) continue;
+    // Check if the dynamic or keyword token was properly terminated
+    if(!IS_PROPER_TERMINATION(src_str[length])) return -1;
+
+    return (ssize_t) length;
+}
+
+// Decimal digits are converted 8 at a time where the byte order allows loading them as one integer
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define DECIMAL_SWAR 1
+#endif
+
+#ifdef DECIMAL_SWAR
+// Value of exactly 8 decimal digits at src (which are known to be digits)
+// Neighbouring digits are combined in pairs, then pairs of pairs and so on, all within one register
+uint64_t _decimal_swar_8(const char* src) {
+    uint64_t chunk;
+    memcpy(&chunk, src, sizeof(chunk));
+
+    chunk -= 0x3030303030303030ULL; // '0' from every byte
+    chunk = (chunk * 10) + (chunk >> 8); // 2-digit numbers in every other byte
+    chunk = (((chunk & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+            (((chunk >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+
+    return chunk;
+}
+#endif
+
+// Converts the numeric literal of given type and length at src_str into its value
+// The digits were already checked while determining the length, only the overflow can go wrong
+//
+// Return value: 0 if ok, -1 if the value does not fit in 64 bits
+int _decode_numeric_literal(const char* src_str, size_t length, lexer_token_type_t type, uint64_t* value_ptr) {
+    uint64_t value = 0;
+    size_t i = 0;
+
+    switch(type) {
+        case TOKEN_LITERAL_NUMERIC_DEC: {
+#ifdef DECIMAL_SWAR
+            for(; i + 8 <= length; i += 8) {
+                uint64_t chunk = _decimal_swar_8(src_str + i);
+                if(value > (UINT64_MAX - chunk) / 100000000ULL) return -1;
+
+                value = value * 100000000ULL + chunk;
             }
+#endif
+
+            for(; i < length; i++) {
+                uint64_t digit = (uint64_t) _digit_values[(unsigned char) src_str[i]];
+                if(value > (UINT64_MAX - digit) / 10) return -1;
 
-            if(tk_len > longest_match_length) {
-                longest_match_idx = idx;
-                longest_match_length = tk_len;
+                value = value * 10 + digit;
             }
+
+            break;
         }
-    }
 
-    if(longest_match_idx != 0xFFFFFFFF && longest_match_length > 0) {
-        *token_type = longest_match_idx;
-        return longest_match_length;
-    }
+        // Other bases are powers of two, digits are shifted in
+        case TOKEN_LITERAL_NUMERIC_HEX:
+        case TOKEN_LITERAL_NUMERIC_OCT:
+        case TOKEN_LITERAL_NUMERIC_BIN: {
+            unsigned int bits = type == TOKEN_LITERAL_NUMERIC_HEX ? 4 : (type == TOKEN_LITERAL_NUMERIC_OCT ? 3 : 1);
 
-    // Last resort: Identifier
-    // Consume chars as they go, as long as they meet vague criteria for identifiers which at this point are:
-    // alphanumeric characters + underscore
+            // Skip the prefix (0x, 0b or just 0)
+            i = type == TOKEN_LITERAL_NUMERIC_OCT ? 1 : 2;
 
-    // If not valid, return -1
-    if(_is_valid_in_identifiers(src_str[length]) == 0) {
-        return -1;
-    }
+            for(; i < length; i++) {
+                if((value >> (64 - bits)) != 0) return -1;
 
-    *token_type = TOKEN_IDENTIFIER;
-    while(_is_valid_in_identifiers(src_str[length])) {
-        length++;
-    }
+                value = (value << bits) | (uint64_t) _digit_values[(unsigned char) src_str[i]];
+            }
 
-    // Check if the dynamic token was properly terminated
-    if(_is_proper_termination(src_str + length) == 0) return -1;
+            break;
+        }
+
+        default:
+            break;
+    }
 
-    return length;
+    *value_ptr = value;
+    return 0;
 }
 
-char* _read_next_token(char* src_str, size_t* line_counter_ptr, size_t* char_counter_ptr, lexer_token_t* next_token) {
-    ssize_t token_length_try = _determine_token_length_and_type(src_str, &(next_token->type));
+// Returns NULL if the token can't be read, the counter is left untouched then
+// Tokens never span lines, so only the char counter changes
+const char* _read_next_token(const char* src_str, size_t* char_counter_ptr, lexer_token_type_t* token_type, uint32_t* hash) {
+    ssize_t token_length_try = _determine_token_length_and_type(src_str, token_type, hash);
     if(token_length_try < 0) {
-        fprintf(stderr, "[lexer] Error in line %zu char %zu: Can't determine token length and/or type\n", *line_counter_ptr, *char_counter_ptr);
         return NULL;
     }
 
     size_t token_length = (size_t) token_length_try;
 
-    next_token->line_ref = *line_counter_ptr;
-    next_token->char_ref = *char_counter_ptr;
-
+    // Position of the token is not stored, the token list derives it from the offset
     *char_counter_ptr += token_length;
 
-    if(TOKEN_TYPE_IS_DYNAMIC(next_token->type)) {
-        next_token->contents = malloc(token_length + 1);
-        memcpy(next_token->contents, src_str, token_length);
-        next_token->contents[token_length] = '\0';
-    } else {
-        next_token->contents = NULL;
-    }
-
     return src_str + token_length;
 }
 
-char* _skip_to_next_token(char* src_str, size_t* line_counter_ptr, size_t* char_counter_ptr) {
+const char* _skip_to_next_token(const char* src_str, size_t* line_counter_ptr, size_t* char_counter_ptr) {
     while(1) {
         char c = *src_str;
 
@@ -275,28 +457,34 @@ char* _skip_to_next_token(char* src_str, size_t* line_counter_ptr, size_t* char_
         }
 
         // If current char is start of the comment, we skip the comment
-        if(c == '#') {
+        if(CHAR_CLASS(c) == CC_COMMENT) {
             // Eat all the chars until we encounter a newline
             // Or end of file
-            while(*src_str != '\n' && *src_str != '\0') src_str++;
+            src_str = lexer_scan_line_end(src_str);
 
             // The src_str now points at either \n or eof, let the next iteration
             // of the loop process it
             continue;
         }
 
-
         // If current char is one of the whitespace characters, we skip it too
-        if(strchr(WHITESPACE_CHARS, c) != NULL) {
-            // And set counters properly
-            if(c == '\n') {
-                (*line_counter_ptr)++;
-                (*char_counter_ptr) = 1;
-            } else {
-                (*char_counter_ptr)++;
+        if(CHAR_CLASS(c) == CC_WHITESPACE) {
+            // Most runs are a single space between tokens, those are not worth a vector scan
+            if(CHAR_CLASS(src_str[1]) != CC_WHITESPACE) {
+                // Set counters properly
+                if(c == '\n') {
+                    (*line_counter_ptr)++;
+                    (*char_counter_ptr) = 1;
+                } else {
+                    (*char_counter_ptr)++;
+                }
+
+                src_str++;
+                continue;
             }
 
-            src_str++;
+            // Longer runs (indentation, empty lines) are skipped in bulk, the scan sets counters
+            src_str = lexer_scan_whitespace(src_str, line_counter_ptr, char_counter_ptr);
             continue;
         }
 
@@ -305,35 +493,294 @@ char* _skip_to_next_token(char* src_str, size_t* line_counter_ptr, size_t* char_
     }
 }
 
-int lexer_process_source_code(char* src_str, lexer_token_list_t* list) {
-    size_t line_counter = 1;
-    size_t char_counter = 1;
+void lexer_state_init(lexer_state_t* lexer, const char* src_str, utils_intern_table_t* names) {
+    lexer->source = src_str;
+    lexer->cursor = src_str;
+    lexer->line_counter = 1;
+    lexer->char_counter = 1;
+    lexer->error = 0;
+    lexer->names = names;
+    lexer->limit = NULL;
+    lexer->silent = 0;
+    lexer->num_tokens = 0;
+
+    // Pick the fastest scanning routines for this CPU
+    lexer_scan_init();
+}
 
-    while(1) {
-        // Skip all the whitespace, comments etc
-        // Return the address of first byte of the next token
-        src_str = _skip_to_next_token(src_str, &line_counter, &char_counter);
+// Reads the next token from the cursor, advancing it past the token
+// Returns 1 and fills the out parameters if a token was read, 0 at the end of source and -1 on error
+int _lexer_read(lexer_state_t* lexer, lexer_token_type_t* token_type, const char** token_start, size_t* line_ref, size_t* char_ref, utils_intern_id_t* id, uint64_t* value) {
+    if(lexer->error != 0) return -1;
+    if(lexer->cursor == NULL) return 0;
+
+    // Skip all the whitespace, comments etc
+    // Return the address of first byte of the next token
+    const char* src_str = _skip_to_next_token(lexer->cursor, &(lexer->line_counter), &(lexer->char_counter));
+
+    // If NULL is returned it means there is no more tokens
+    // Tokens never cross the limit, since it is always at the beginning of a line
+    if(src_str != NULL && lexer->limit != NULL && src_str >= lexer->limit) src_str = NULL;
+
+    lexer->cursor = src_str;
+    if(src_str == NULL) return 0;
+
+    *token_start = src_str;
+    *line_ref = lexer->line_counter;
+    *char_ref = lexer->char_counter;
+
+    // Otherwise return the next token - read the chars, detemrine type
+    // Return the address of first byte after the last char of the processed token
+    uint32_t hash = 0;
+    src_str = _read_next_token(src_str, &(lexer->char_counter), token_type, &hash);
+
+    // If NULL is returned it means there was a problem reading a token
+    // (Possibly string without an ending " or something similar)
+    if(src_str == NULL) {
+        if(!lexer->silent) {
+            fprintf(UTILS_DIAG, "[lexer] Error in line %zu char %zu: Can't determine token length and/or type\n", lexer->line_counter, lexer->char_counter);
+            fprintf(UTILS_DIAG, "[lexer] Error in line %zu char %zu: Can't read token\n", lexer->line_counter, lexer->char_counter);
+        }
+        lexer->error = 1;
+        return -1;
+    }
 
-        // If NULL is returned it means there is no more tokens, return
-        if(src_str == NULL) break;
+    lexer->cursor = src_str;
 
-        // Temporary buffer for token data, in the end the list will own the data
-        lexer_token_t* next_token = malloc(sizeof(lexer_token_t));
+    *id = UTILS_INTERN_NONE;
+    *value = 0;
 
-        // Otherwise return the next token - read the chars, detemrine type and fill struct
-        // Return the address of first byte after the last char of the processed token
-        src_str = _read_next_token(src_str, &line_counter, &char_counter, next_token);
+    // Each distinct identifier is stored only once, the parser refers to it by id
+    if(*token_type == TOKEN_IDENTIFIER && lexer->names != NULL) {
+        *id = utils_intern_string(lexer->names, *token_start, (size_t) (src_str - *token_start), hash);
+    }
+
+    // Numbers are decoded right away, so that nothing has to parse the text again
+    if(TOKEN_TYPE_IS_NUMERIC(*token_type) && _decode_numeric_literal(*token_start, (size_t) (src_str - *token_start), *token_type, value) != 0) {
+        if(!lexer->silent) {
+            fprintf(UTILS_DIAG, "[lexer] Error in line %zu char %zu: Numeric literal is too big\n", *line_ref, *char_ref);
+        }
+        lexer->error = 1;
+        return -1;
+    }
+
+    return 1;
+}
+
+int lexer_next_token(lexer_state_t* lexer, lexer_token_t* tk) {
+    const char* token_start = NULL;
+
+    int result = _lexer_read(lexer, &(tk->type), &token_start, &(tk->line_ref), &(tk->char_ref), &(tk->id), &(tk->value));
+    if(result != 1) return result;
+
+    tk->contents = TOKEN_TYPE_IS_DYNAMIC(tk->type) ? token_start : NULL;
+    tk->length = (size_t) (lexer->cursor - token_start);
+    lexer->num_tokens += 1;
 
-        // If NULL is returned it means there was a problem reading a token
-        // (Possibly string without an ending " or something similar)
-        if(src_str == NULL) {
-            fprintf(stderr, "[lexer] Error in line %zu char %zu: Can't read token\n", line_counter, char_counter);
-            free(next_token);
+    return 1;
+}
+
+// Reads tokens until the end of source (or the limit) and appends them to the list
+// Return value: 0 if ok, 1 if error
+int _lexer_fill_list(lexer_state_t* lexer, lexer_token_list_t* list) {
+    const char* src_str = lexer->source;
+
+    lexer_token_type_t token_type;
+    const char* token_start = NULL;
+    size_t line_ref = 0;
+    size_t char_ref = 0;
+    utils_intern_id_t id = UTILS_INTERN_NONE;
+    uint64_t value = 0;
+
+    int result = 0;
+    while((result = _lexer_read(lexer, &token_type, &token_start, &line_ref, &char_ref, &id, &value)) == 1) {
+        // Offsets are 32 bit, anything past that cannot be referenced
+        if((size_t) (lexer->cursor - src_str) > LEXER_MAX_SOURCE_LENGTH) {
+            if(!lexer->silent) {
+                fprintf(UTILS_DIAG, "[lexer] Error in line %zu char %zu: Source code is too long\n", line_ref, char_ref);
+            }
+            lexer->error = 1;
             return 1;
         }
 
+        // Only the numbers need the side array of values
+        uint32_t payload = id;
+        if(TOKEN_TYPE_IS_NUMERIC(token_type)) {
+            payload = lexer_token_list_add_value(list, value);
+        }
+
         // If all is good, append the new token to the list
-        lexer_token_list_append(list, next_token);
+        lexer_token_list_append(list, token_type, (uint32_t) (token_start - src_str), (uint32_t) (lexer->cursor - token_start), payload);
+    }
+
+    return result == 0 ? 0 : 1;
+}
+
+int lexer_process_source_code(const char* src_str, utils_intern_table_t* names, lexer_token_list_t* list) {
+    lexer_state_t lexer;
+    lexer_state_init(&lexer, src_str, names);
+
+    // Tokens are stored as offsets into the source, positions are derived from them later
+    list->source = src_str;
+
+    return _lexer_fill_list(&lexer, list);
+}
+
+// Part of the source lexed by one thread in lexer_process_source_code_parallel()
+struct _lexer_chunk_t {
+    lexer_state_t lexer;
+    lexer_token_list_t* list;       // Tokens of the chunk, identifiers are interned into the chunk's own table
+    size_t start;                   // Offsets of the chunk in the source, both at beginnings of lines
+    size_t end;
+    int result;
+};
+
+void* _lexer_chunk_worker(void* arg) {
+    struct _lexer_chunk_t* chunk = arg;
+
+    chunk->lexer.cursor = chunk->lexer.source + chunk->start;
+    chunk->result = _lexer_fill_list(&(chunk->lexer), chunk->list);
+
+    // Lines of the chunk go to the index as well, so it does not have to be built afterwards
+    if(chunk->result == 0) {
+        lexer_token_list_add_lines(chunk->list, chunk->start, chunk->end);
+    }
+
+    return NULL;
+}
+
+// Appends the tokens and lines of the chunk to the list, moving identifiers to the table of names
+void _lexer_merge_chunk(struct _lexer_chunk_t* chunk, utils_intern_table_t* names, lexer_token_list_t* list) {
+    lexer_token_list_t* part = chunk->list;
+    utils_intern_table_t* part_names = chunk->lexer.names;
+
+    // Every distinct name of the chunk is interned once, the hashes are already known
+    utils_intern_id_t* ids = NULL;
+    if(part_names != NULL) {
+        ids = malloc((part_names->num_strings + 1) * sizeof(utils_intern_id_t));
+
+        for(utils_intern_id_t id = 0; id < part_names->num_strings; id++) {
+            ids[id] = utils_intern_string(names, UTILS_INTERN_GET(part_names, id), UTILS_INTERN_LENGTH(part_names, id), part_names->hashes[id]);
+        }
+    }
+
+    // Offsets are already relative to the whole source, so the arrays are copied as they are
+    size_t base = list->num_tokens;
+    lexer_token_list_reserve(list, base + part->num_tokens);
+
+    memcpy(list->types + base, part->types, part->num_tokens * sizeof(uint8_t));
+    memcpy(list->offsets + base, part->offsets, part->num_tokens * sizeof(uint32_t));
+    memcpy(list->lengths + base, part->lengths, part->num_tokens * sizeof(uint32_t));
+    list->num_tokens += part->num_tokens;
+
+    // Only the payloads refer to things local to the chunk
+    uint32_t values_base = (uint32_t) list->num_values;
+    for(size_t i = 0; i < part->num_values; i++) {
+        lexer_token_list_add_value(list, part->values[i]);
+    }
+
+    for(size_t i = 0; i < part->num_tokens; i++) {
+        lexer_token_type_t type = (lexer_token_type_t) part->types[i];
+        uint32_t payload = part->payloads[i];
+
+        if(TOKEN_TYPE_IS_NUMERIC(type)) {
+            payload += values_base;
+        } else if(type == TOKEN_IDENTIFIER && ids != NULL) {
+            payload = ids[payload];
+        }
+
+        list->payloads[base + i] = payload;
+    }
+
+    // First line of the chunk is either the first line of the source, or was added by the previous chunk
+    for(size_t i = 1; i < part->num_lines; i++) {
+        lexer_token_list_append_line(list, part->line_starts[i]);
+    }
+
+    free(ids);
+}
+
+int lexer_process_source_code_parallel(const char* src_str, utils_intern_table_t* names, lexer_token_list_t* list, size_t num_threads) {
+    size_t length = strlen(src_str);
+
+    // Small sources are not worth the threads, and sources too long for the list are reported by the serial lexer
+    size_t num_chunks = length / LEXER_MIN_CHUNK_LENGTH;
+    if(num_chunks > num_threads) num_chunks = num_threads;
+
+    if(num_chunks <= 1 || length > LEXER_MAX_SOURCE_LENGTH) {
+        return lexer_process_source_code(src_str, names, list);
+    }
+
+    // Chunks are split right after newlines - neither string literals nor comments can contain one,
+    // so every chunk starts outside of them, just like the lexer does at the beginning of the source
+    struct _lexer_chunk_t* chunks = malloc(num_chunks * sizeof(struct _lexer_chunk_t));
+
+    size_t start = 0;
+    for(size_t i = 0; i < num_chunks; i++) {
+        size_t end = length;
+
+        if(i != num_chunks - 1) {
+            end = length / num_chunks * (i + 1);
+            if(end < start) end = start;
+
+            const char* newline = memchr(src_str + end, '\n', length - end);
+            end = newline != NULL ? (size_t) (newline - src_str) + 1 : length;
+        }
+
+        struct _lexer_chunk_t* chunk = chunks + i;
+        lexer_state_init(&(chunk->lexer), src_str, names != NULL ? utils_intern_table_make() : NULL);
+        chunk->lexer.limit = src_str + end;
+        chunk->lexer.silent = 1;
+
+        chunk->list = lexer_token_list_make();
+        chunk->list->source = src_str;
+        chunk->start = start;
+        chunk->end = end;
+        chunk->result = 0;
+
+        start = end;
+    }
+
+    // The first chunk is done by this thread
+    pthread_t* threads = malloc(num_chunks * sizeof(pthread_t));
+    int* started = calloc(num_chunks, sizeof(int));
+
+    for(size_t i = 1; i < num_chunks; i++) {
+        started[i] = pthread_create(threads + i, NULL, _lexer_chunk_worker, chunks + i) == 0;
+
+        // If the thread can't be created, the chunk is done by this thread later
+        if(!started[i]) _lexer_chunk_worker(chunks + i);
+    }
+
+    _lexer_chunk_worker(chunks);
+
+    int result = 0;
+    for(size_t i = 0; i < num_chunks; i++) {
+        if(i != 0 && started[i]) pthread_join(threads[i], NULL);
+        if(chunks[i].result != 0) result = 1;
+    }
+
+    // Concatenate the chunks in order, unless one failed
+    list->source = src_str;
+    if(result == 0) {
+        for(size_t i = 0; i < num_chunks; i++) {
+            _lexer_merge_chunk(chunks + i, names, list);
+        }
+    }
+
+    for(size_t i = 0; i < num_chunks; i++) {
+        utils_intern_table_destroy(chunks[i].lexer.names);
+        lexer_token_list_destroy(chunks[i].list);
+    }
+
+    free(started);
+    free(threads);
+    free(chunks);
+
+    // Errors are rare, so the source is simply lexed again by the serial lexer, which reports the first
+    // one exactly like it would without the threads
+    if(result != 0) {
+        return lexer_process_source_code(src_str, names, list);
     }
 
     return 0;
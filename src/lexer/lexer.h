@@ -24,14 +24,64 @@
 #include <stdio.h>
 
 #include "token_list.h"
+#include "utils/intern.h"
+#include "io/binfile.h"
+
+// State of a lexer which produces tokens one at a time, on demand
+// The source is read only as far as the last token requested
+struct lexer_state_t {
+    const char* source;     // Null-terminated source code
+    const char* cursor;     // First char after the last token read, NULL at the end of source
+    size_t line_counter;    // Position of the cursor in the file
+    size_t char_counter;
+    int error;              // Set to 1 once a token could not be read, no more tokens are produced then
+    utils_intern_table_t* names; // Identifiers are interned into this table (unless NULL)
+    const char* limit;      // No tokens are read at or after this char (NULL - until the end of source)
+    int silent;             // Errors only set the error flag, without being reported
+    size_t num_tokens;      // Tokens read with lexer_next_token() so far
+};
+typedef struct lexer_state_t lexer_state_t;
+
+// Initializes the lexer state to read tokens from the beginning of src_str
+// Tokens reference the source code string, it cannot be freed before the tokens are used
+// If names is not NULL, every identifier is interned into it and tokens carry the id
+void lexer_state_init(lexer_state_t* lexer, const char* src_str, utils_intern_table_t* names);
+
+// Reads the next token into tk and advances the lexer past it
+//
+// Return value: 1 if a token was read, 0 at the end of source, -1 if error (reported on stderr)
+int lexer_next_token(lexer_state_t* lexer, lexer_token_t* tk);
 
 // Walks through a null-terminated source code string pointed to by
 // src_str and returns a token list (structure pointed to by list is modified)
+// Tokens reference the source code string, it cannot be freed before the list
+// Identifiers are interned into names, unless it's NULL
+//
+// Return value: 0 if ok, 1 if error
+int lexer_process_source_code(const char* src_str, utils_intern_table_t* names, lexer_token_list_t* list);
+
+// Sources shorter than this per thread are not split between threads
+#define LEXER_MIN_CHUNK_LENGTH ((size_t) 256 * 1024)
+
+// Same as lexer_process_source_code(), but splits the source into chunks which are lexed
+// by up to num_threads threads at once. The resulting list is exactly the same as the one
+// made by lexer_process_source_code(), errors are reported the same way as well
 //
 // Return value: 0 if ok, 1 if error
-int lexer_process_source_code(char* src_str, lexer_token_list_t* list);
+int lexer_process_source_code_parallel(const char* src_str, utils_intern_table_t* names, lexer_token_list_t* list, size_t num_threads);
 
 // Output from the lexing stage
 void lexer_write_output(FILE* outfile, lexer_token_list_t* list);
 
+// Binary output from the lexing stage (see io/binfile.h), names are the ones the identifiers were interned into
+//
+// Return value: 0 if ok, 1 if error
+int lexer_write_binary(FILE* outfile, lexer_token_list_t* list, utils_intern_table_t* names);
+
+// Points the list (made with lexer_token_list_make_view()) at the tokens of the binary file, which has to
+// outlive it, and interns the saved identifiers into names (unless NULL), which then have the same ids as before
+//
+// Return value: 0 if ok, 1 if error
+int lexer_load_binary(const io_binfile_t* binfile, utils_intern_table_t* names, lexer_token_list_t* list);
+
 #endif
@@ -17,6 +17,7 @@
 // output - Printing output of the lexing stage
 
 #include <stdio.h>
+#include <string.h>
 
 #include "token_list.h"
 
@@ -26,8 +27,12 @@ void lexer_write_output(FILE* outfile, lexer_token_list_t* list) {
 
     lexer_token_t* tk = NULL;
     while((tk = lexer_token_iter_next(&iter)) != NULL) {
-        fprintf(outfile, "Token {\n\ttype - %u\n\tcontents - %s\n\tline - %zu\n\tchar - %zu\n}\n",
-            tk->type, tk->contents != NULL ? tk->contents : "(empty)", tk->line_ref, tk->char_ref
+        // Contents are not null-terminated, print only the length of the token
+        const char* contents = tk->contents != NULL ? tk->contents : "(empty)";
+        int contents_length = tk->contents != NULL ? (int) tk->length : (int) strlen(contents);
+
+        fprintf(outfile, "Token {\n\ttype - %u\n\tcontents - %.*s\n\tline - %zu\n\tchar - %zu\n}\n",
+            tk->type, contents_length, contents, tk->line_ref, tk->char_ref
         );
     }
 }
@@ -0,0 +1,316 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// scan - Fast scanning of long runs of bytes in the source (whitespace, comments, literal bodies)
+
+#include "scan.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+// Vector paths are only built for x86_64, where SSE2 is always available
+#if defined(__GNUC__) && defined(__x86_64__)
+#define LEXER_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+// After a run of whitespace is skipped, the counters are updated in one go
+// If there were newlines, the char counter restarts from the byte after the last one
+void _update_counters(const char* start, const char* end, size_t lines, const char* last_newline, size_t* line_counter_ptr, size_t* char_counter_ptr) {
+    if(lines > 0) {
+        *line_counter_ptr += lines;
+        *char_counter_ptr = 1 + (size_t) (end - (last_newline + 1));
+    } else {
+        *char_counter_ptr += (size_t) (end - start);
+    }
+}
+
+// Scalar implementations, used when no vector extensions are available
+const char* _scan_whitespace_scalar(const char* src, size_t* line_counter_ptr, size_t* char_counter_ptr) {
+    while(*src == ' ' || *src == '\t' || *src == '\r' || *src == '\n') {
+        if(*src == '\n') {
+            (*line_counter_ptr)++;
+            (*char_counter_ptr) = 1;
+        } else {
+            (*char_counter_ptr)++;
+        }
+
+        src++;
+    }
+
+    return src;
+}
+
+const char* _scan_line_end_scalar(const char* src) {
+    while(*src != '\n' && *src != '\0') src++;
+    return src;
+}
+
+const char* _scan_literal_scalar(const char* src, char quote) {
+    while(*src != quote && *src != '\\' && *src != '\n' && *src != '\t' && *src != '\0') src++;
+    return src;
+}
+
+#ifdef LEXER_SCAN_X86
+
+// Each vector scan loads aligned blocks starting with the one containing src
+// The bits for bytes before src in the first block are masked out with valid_mask
+
+// Position of the highest set bit, mask cannot be 0
+#define LAST_BIT_POS(mask) (31 - __builtin_clz(mask))
+
+// The aligned loads may read past the end of the buffer (never past its last page),
+// which is fine for the hardware but not for AddressSanitizer
+#define SCAN_NO_ASAN __attribute__((no_sanitize_address))
+
+SCAN_NO_ASAN
+const char* _scan_whitespace_sse2(const char* src, size_t* line_counter_ptr, size_t* char_counter_ptr) {
+    const char* block = (const char*) ((uintptr_t) src & ~(uintptr_t) 15);
+    unsigned int valid_mask = (0xFFFFu << ((uintptr_t) src & 15)) & 0xFFFFu;
+
+    size_t lines = 0;
+    const char* last_newline = NULL;
+
+    const __m128i spaces = _mm_set1_epi8(' ');
+    const __m128i tabs = _mm_set1_epi8('\t');
+    const __m128i crs = _mm_set1_epi8('\r');
+    const __m128i newlines = _mm_set1_epi8('\n');
+
+    while(1) {
+        __m128i v = _mm_load_si128((const __m128i*) block);
+
+        __m128i nl = _mm_cmpeq_epi8(v, newlines);
+        __m128i ws = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, spaces), _mm_cmpeq_epi8(v, tabs)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, crs), nl)
+        );
+
+        unsigned int nl_mask = (unsigned int) _mm_movemask_epi8(nl) & valid_mask;
+        unsigned int stop_mask = ~(unsigned int) _mm_movemask_epi8(ws) & valid_mask;
+
+        if(stop_mask != 0) {
+            unsigned int pos = __builtin_ctz(stop_mask);
+            nl_mask &= (1u << pos) - 1;
+
+            if(nl_mask != 0) {
+                lines += __builtin_popcount(nl_mask);
+                last_newline = block + LAST_BIT_POS(nl_mask);
+            }
+
+            _update_counters(src, block + pos, lines, last_newline, line_counter_ptr, char_counter_ptr);
+            return block + pos;
+        }
+
+        if(nl_mask != 0) {
+            lines += __builtin_popcount(nl_mask);
+            last_newline = block + LAST_BIT_POS(nl_mask);
+        }
+
+        block += 16;
+        valid_mask = 0xFFFFu;
+    }
+}
+
+SCAN_NO_ASAN
+const char* _scan_line_end_sse2(const char* src) {
+    const char* block = (const char*) ((uintptr_t) src & ~(uintptr_t) 15);
+    unsigned int valid_mask = (0xFFFFu << ((uintptr_t) src & 15)) & 0xFFFFu;
+
+    const __m128i zeros = _mm_setzero_si128();
+    const __m128i newlines = _mm_set1_epi8('\n');
+
+    while(1) {
+        __m128i v = _mm_load_si128((const __m128i*) block);
+        __m128i stop = _mm_or_si128(_mm_cmpeq_epi8(v, zeros), _mm_cmpeq_epi8(v, newlines));
+
+        unsigned int stop_mask = (unsigned int) _mm_movemask_epi8(stop) & valid_mask;
+        if(stop_mask != 0) {
+            return block + __builtin_ctz(stop_mask);
+        }
+
+        block += 16;
+        valid_mask = 0xFFFFu;
+    }
+}
+
+SCAN_NO_ASAN
+const char* _scan_literal_sse2(const char* src, char quote) {
+    const char* block = (const char*) ((uintptr_t) src & ~(uintptr_t) 15);
+    unsigned int valid_mask = (0xFFFFu << ((uintptr_t) src & 15)) & 0xFFFFu;
+
+    const __m128i zeros = _mm_setzero_si128();
+    const __m128i quotes = _mm_set1_epi8(quote);
+    const __m128i backslashes = _mm_set1_epi8('\\');
+    const __m128i newlines = _mm_set1_epi8('\n');
+    const __m128i tabs = _mm_set1_epi8('\t');
+
+    while(1) {
+        __m128i v = _mm_load_si128((const __m128i*) block);
+        __m128i stop = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, quotes), _mm_cmpeq_epi8(v, backslashes)),
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, newlines), _mm_cmpeq_epi8(v, tabs)), _mm_cmpeq_epi8(v, zeros))
+        );
+
+        unsigned int stop_mask = (unsigned int) _mm_movemask_epi8(stop) & valid_mask;
+        if(stop_mask != 0) {
+            return block + __builtin_ctz(stop_mask);
+        }
+
+        block += 16;
+        valid_mask = 0xFFFFu;
+    }
+}
+
+__attribute__((target("avx2"))) SCAN_NO_ASAN
+const char* _scan_whitespace_avx2(const char* src, size_t* line_counter_ptr, size_t* char_counter_ptr) {
+    const char* block = (const char*) ((uintptr_t) src & ~(uintptr_t) 31);
+    unsigned int valid_mask = 0xFFFFFFFFu << ((uintptr_t) src & 31);
+
+    size_t lines = 0;
+    const char* last_newline = NULL;
+
+    const __m256i spaces = _mm256_set1_epi8(' ');
+    const __m256i tabs = _mm256_set1_epi8('\t');
+    const __m256i crs = _mm256_set1_epi8('\r');
+    const __m256i newlines = _mm256_set1_epi8('\n');
+
+    while(1) {
+        __m256i v = _mm256_load_si256((const __m256i*) block);
+
+        __m256i nl = _mm256_cmpeq_epi8(v, newlines);
+        __m256i ws = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, spaces), _mm256_cmpeq_epi8(v, tabs)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, crs), nl)
+        );
+
+        unsigned int nl_mask = (unsigned int) _mm256_movemask_epi8(nl) & valid_mask;
+        unsigned int stop_mask = ~(unsigned int) _mm256_movemask_epi8(ws) & valid_mask;
+
+        if(stop_mask != 0) {
+            unsigned int pos = __builtin_ctz(stop_mask);
+            nl_mask &= (1u << pos) - 1;
+
+            if(nl_mask != 0) {
+                lines += __builtin_popcount(nl_mask);
+                last_newline = block + LAST_BIT_POS(nl_mask);
+            }
+
+            _update_counters(src, block + pos, lines, last_newline, line_counter_ptr, char_counter_ptr);
+            return block + pos;
+        }
+
+        if(nl_mask != 0) {
+            lines += __builtin_popcount(nl_mask);
+            last_newline = block + LAST_BIT_POS(nl_mask);
+        }
+
+        block += 32;
+        valid_mask = 0xFFFFFFFFu;
+    }
+}
+
+__attribute__((target("avx2"))) SCAN_NO_ASAN
+const char* _scan_line_end_avx2(const char* src) {
+    const char* block = (const char*) ((uintptr_t) src & ~(uintptr_t) 31);
+    unsigned int valid_mask = 0xFFFFFFFFu << ((uintptr_t) src & 31);
+
+    const __m256i zeros = _mm256_setzero_si256();
+    const __m256i newlines = _mm256_set1_epi8('\n');
+
+    while(1) {
+        __m256i v = _mm256_load_si256((const __m256i*) block);
+        __m256i stop = _mm256_or_si256(_mm256_cmpeq_epi8(v, zeros), _mm256_cmpeq_epi8(v, newlines));
+
+        unsigned int stop_mask = (unsigned int) _mm256_movemask_epi8(stop) & valid_mask;
+        if(stop_mask != 0) {
+            return block + __builtin_ctz(stop_mask);
+        }
+
+        block += 32;
+        valid_mask = 0xFFFFFFFFu;
+    }
+}
+
+__attribute__((target("avx2"))) SCAN_NO_ASAN
+const char* _scan_literal_avx2(const char* src, char quote) {
+    const char* block = (const char*) ((uintptr_t) src & ~(uintptr_t) 31);
+    unsigned int valid_mask = 0xFFFFFFFFu << ((uintptr_t) src & 31);
+
+    const __m256i zeros = _mm256_setzero_si256();
+    const __m256i quotes = _mm256_set1_epi8(quote);
+    const __m256i backslashes = _mm256_set1_epi8('\\');
+    const __m256i newlines = _mm256_set1_epi8('\n');
+    const __m256i tabs = _mm256_set1_epi8('\t');
+
+    while(1) {
+        __m256i v = _mm256_load_si256((const __m256i*) block);
+        __m256i stop = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, quotes), _mm256_cmpeq_epi8(v, backslashes)),
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, newlines), _mm256_cmpeq_epi8(v, tabs)), _mm256_cmpeq_epi8(v, zeros))
+        );
+
+        unsigned int stop_mask = (unsigned int) _mm256_movemask_epi8(stop) & valid_mask;
+        if(stop_mask != 0) {
+            return block + __builtin_ctz(stop_mask);
+        }
+
+        block += 32;
+        valid_mask = 0xFFFFFFFFu;
+    }
+}
+
+#endif
+
+// Selected implementations, see lexer_scan_init()
+static const char* (*_scan_whitespace_impl)(const char*, size_t*, size_t*) = _scan_whitespace_scalar;
+static const char* (*_scan_line_end_impl)(const char*) = _scan_line_end_scalar;
+static const char* (*_scan_literal_impl)(const char*, char) = _scan_literal_scalar;
+
+// Many inputs may be lexed at once, so the selection is only done by the first of them
+static pthread_once_t _scan_init_once = PTHREAD_ONCE_INIT;
+
+void _lexer_scan_select() {
+#ifdef LEXER_SCAN_X86
+    __builtin_cpu_init();
+
+    if(__builtin_cpu_supports("avx2")) {
+        _scan_whitespace_impl = _scan_whitespace_avx2;
+        _scan_line_end_impl = _scan_line_end_avx2;
+        _scan_literal_impl = _scan_literal_avx2;
+    } else {
+        _scan_whitespace_impl = _scan_whitespace_sse2;
+        _scan_line_end_impl = _scan_line_end_sse2;
+        _scan_literal_impl = _scan_literal_sse2;
+    }
+#endif
+}
+
+void lexer_scan_init() {
+    pthread_once(&_scan_init_once, _lexer_scan_select);
+}
+
+const char* lexer_scan_whitespace(const char* src, size_t* line_counter_ptr, size_t* char_counter_ptr) {
+    return _scan_whitespace_impl(src, line_counter_ptr, char_counter_ptr);
+}
+
+const char* lexer_scan_line_end(const char* src) {
+    return _scan_line_end_impl(src);
+}
+
+const char* lexer_scan_literal(const char* src, char quote) {
+    return _scan_literal_impl(src, quote);
+}
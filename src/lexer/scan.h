@@ -0,0 +1,48 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// scan - Fast scanning of long runs of bytes in the source (whitespace, comments, literal bodies)
+
+// The functions below look at 16 (SSE2) or 32 (AVX2) bytes at a time where the CPU
+// supports it, and fall back to plain loops otherwise. The implementation is picked
+// once, in lexer_scan_init(), which has to be called before any of the scans.
+//
+// All scans stop at the null byte at the latest, so the source must be null-terminated.
+// Vector loads are aligned to their own size, so they never cross a page boundary and
+// never touch memory past the page containing the terminator.
+
+#ifndef _I_LEXER_SCAN_H_
+#define _I_LEXER_SCAN_H_
+
+#include <stddef.h>
+
+// Picks the best implementation for the current CPU, safe to call many times
+// Must not be called concurrently with itself or any of the scans for the first time
+void lexer_scan_init();
+
+// Returns pointer to the first byte at or after src which is not whitespace ("\t\r\n ")
+// Line counter is incremented once for every newline skipped and the char counter is
+// set to the position of the returned byte in its line
+const char* lexer_scan_whitespace(const char* src, size_t* line_counter_ptr, size_t* char_counter_ptr);
+
+// Returns pointer to the first '\n' or '\0' at or after src (end of a comment)
+const char* lexer_scan_line_end(const char* src);
+
+// Returns pointer to the first byte at or after src which is either the quote, a backslash
+// or one of the chars which cannot be a part of a literal ('\n', '\t', '\0')
+const char* lexer_scan_literal(const char* src, char quote);
+
+#endif
@@ -18,35 +18,274 @@
 
 #include "token_list.h"
 #include "token_types.h"
-
-#include "utils/list.h"
+#include "lexer.h"
 
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+
+#define DEFAULT_TOKENS_ALLOC 256
+#define DEFAULT_LINES_ALLOC 64
+#define DEFAULT_VALUES_ALLOC 32
+
+lexer_token_list_t* lexer_token_list_make() {
+    lexer_token_list_t* l = malloc(sizeof(lexer_token_list_t));
+
+    l->num_tokens = 0;
+    l->alloc_tokens = DEFAULT_TOKENS_ALLOC;
+    l->types = malloc(l->alloc_tokens * sizeof(uint8_t));
+    l->offsets = malloc(l->alloc_tokens * sizeof(uint32_t));
+    l->lengths = malloc(l->alloc_tokens * sizeof(uint32_t));
+    l->payloads = malloc(l->alloc_tokens * sizeof(uint32_t));
+
+    l->num_values = 0;
+    l->alloc_values = DEFAULT_VALUES_ALLOC;
+    l->values = malloc(l->alloc_values * sizeof(uint64_t));
+
+    l->source = NULL;
+
+    l->num_lines = 0;
+    l->alloc_lines = 0;
+    l->line_starts = NULL;
+
+    l->is_view = 0;
+
+    return l;
+}
+
+lexer_token_list_t* lexer_token_list_make_view() {
+    lexer_token_list_t* l = calloc(1, sizeof(lexer_token_list_t));
+
+    l->is_view = 1;
+
+    return l;
+}
+
+void lexer_token_list_reserve(lexer_token_list_t* l, size_t num_tokens) {
+    if(num_tokens <= l->alloc_tokens) return;
+
+    while(l->alloc_tokens < num_tokens) {
+        l->alloc_tokens *= 2;
+    }
+
+    l->types = realloc(l->types, l->alloc_tokens * sizeof(uint8_t));
+    l->offsets = realloc(l->offsets, l->alloc_tokens * sizeof(uint32_t));
+    l->lengths = realloc(l->lengths, l->alloc_tokens * sizeof(uint32_t));
+    l->payloads = realloc(l->payloads, l->alloc_tokens * sizeof(uint32_t));
+}
+
+void lexer_token_list_append(lexer_token_list_t* l, lexer_token_type_t type, uint32_t offset, uint32_t length, uint32_t payload) {
+    if(l->num_tokens >= l->alloc_tokens) {
+        lexer_token_list_reserve(l, l->num_tokens + 1);
+    }
+
+    l->types[l->num_tokens] = (uint8_t) type;
+    l->offsets[l->num_tokens] = offset;
+    l->lengths[l->num_tokens] = length;
+    l->payloads[l->num_tokens] = payload;
+    l->num_tokens += 1;
+}
+
+uint32_t lexer_token_list_add_value(lexer_token_list_t* l, uint64_t value) {
+    if(l->num_values >= l->alloc_values) {
+        l->alloc_values *= 2;
+        l->values = realloc(l->values, l->alloc_values * sizeof(uint64_t));
+    }
+
+    l->values[l->num_values] = value;
+    l->num_values += 1;
+
+    return (uint32_t) (l->num_values - 1);
+}
+
+void lexer_token_list_destroy(lexer_token_list_t* l) {
+    if(l == NULL) return;
+
+    if(l->is_view) {
+        free(l);
+        return;
+    }
+
+    free(l->types);
+    free(l->offsets);
+    free(l->lengths);
+    free(l->payloads);
+    free(l->values);
+    free(l->line_starts);
+    free(l);
+}
+
+// Starts the index of line beginnings with the first line, if it was not started yet
+void _lexer_token_list_start_lines(lexer_token_list_t* l) {
+    if(l->line_starts != NULL) return;
+
+    l->alloc_lines = DEFAULT_LINES_ALLOC;
+    l->line_starts = malloc(l->alloc_lines * sizeof(uint32_t));
+    l->line_starts[0] = 0;
+    l->num_lines = 1;
+}
+
+void lexer_token_list_append_line(lexer_token_list_t* l, uint32_t offset) {
+    _lexer_token_list_start_lines(l);
+
+    if(l->num_lines >= l->alloc_lines) {
+        l->alloc_lines *= 2;
+        l->line_starts = realloc(l->line_starts, l->alloc_lines * sizeof(uint32_t));
+    }
+
+    l->line_starts[l->num_lines] = offset;
+    l->num_lines += 1;
+}
+
+void lexer_token_list_add_lines(lexer_token_list_t* l, size_t from, size_t to) {
+    _lexer_token_list_start_lines(l);
+
+    const char* src = l->source + from;
+    const char* end = l->source + to;
+
+    const char* newline = NULL;
+    while((newline = memchr(src, '\n', (size_t) (end - src))) != NULL) {
+        src = newline + 1;
+        lexer_token_list_append_line(l, (uint32_t) (src - l->source));
+    }
+}
+
+// Builds the index of line beginnings, if it was not built yet
+// Every token is contained within a single line, so its line is the last one starting at or before it
+void _lexer_token_list_index_lines(lexer_token_list_t* l) {
+    if(l->line_starts != NULL) return;
+
+    _lexer_token_list_start_lines(l);
 
-// Static tokens do not use tk->contents to store their contents (since theyre predefined anyways)
-void __lexer_token_cleanup(lexer_token_t* tk) {
-    if(TOKEN_TYPE_IS_DYNAMIC(tk->type)) {
-        free(tk->contents);
-    };
-    free(tk);
+    if(l->source == NULL) return;
+
+    lexer_token_list_add_lines(l, 0, strlen(l->source));
 }
 
-UTILS_LIST_MAKE_IMPLEMENTATION(lexer_token, struct lexer_token_t, 32, __lexer_token_cleanup)
+// Fills the view of a token at index, line_index is the line to start looking from
+// and is updated to the line of the token
+void _lexer_token_list_fill(lexer_token_list_t* l, size_t index, size_t* line_index, lexer_token_t* tk) {
+    uint32_t offset = l->offsets[index];
+
+    // Walk forward from the hint, tokens are usually read in order so this is only a step or two
+    // If the hint is past the token, binary search from the start instead
+    size_t line = *line_index;
+    if(l->line_starts[line] > offset) {
+        size_t low = 0;
+        size_t high = line;
+        while(low + 1 < high) {
+            size_t mid = low + (high - low) / 2;
+            if(l->line_starts[mid] <= offset) {
+                low = mid;
+            } else {
+                high = mid;
+            }
+        }
+        line = low;
+    }
+
+    while(line + 1 < l->num_lines && l->line_starts[line + 1] <= offset) {
+        line++;
+    }
+
+    *line_index = line;
+
+    tk->type = (lexer_token_type_t) l->types[index];
+    tk->contents = TOKEN_TYPE_IS_DYNAMIC(tk->type) ? l->source + offset : NULL;
+    tk->length = l->lengths[index];
+    tk->id = UTILS_INTERN_NONE;
+    tk->value = 0;
+
+    if(tk->type == TOKEN_IDENTIFIER) {
+        tk->id = l->payloads[index];
+    } else if(TOKEN_TYPE_IS_NUMERIC(tk->type)) {
+        tk->value = l->values[l->payloads[index]];
+    }
+    tk->line_ref = line + 1;
+    tk->char_ref = offset - l->line_starts[line] + 1;
+}
+
+void lexer_token_list_index_lines(lexer_token_list_t* l) {
+    _lexer_token_list_index_lines(l);
+}
+
+void lexer_token_list_get(lexer_token_list_t* l, size_t index, lexer_token_t* tk) {
+    _lexer_token_list_index_lines(l);
+
+    size_t line_index = l->num_lines - 1;
+    _lexer_token_list_fill(l, index, &line_index, tk);
+}
 
 // Creates a reference-only iterator over the list
 // WARNING the created iterator only references the list, do not destroy it before finishing iteration
 void lexer_token_list_into_iter(lexer_token_list_t* l, lexer_token_iterator_t* iter) {
+    _lexer_token_list_index_lines(l);
+
     iter->list = l;
     iter->next_index = 0;
+    iter->end_index = l->num_tokens;
+    iter->line_index = 0;
+
+    iter->lexer = NULL;
+    iter->lookahead_start = 0;
+    iter->lookahead_count = 0;
+}
+
+void lexer_token_list_range_iter(lexer_token_list_t* l, size_t from, size_t to, lexer_token_iterator_t* iter) {
+    lexer_token_list_into_iter(l, iter);
+
+    iter->next_index = from;
+    iter->end_index = to;
+
+    // The hint is past the first token, so its line is found with a binary search, not a walk from the top
+    iter->line_index = l->num_lines - 1;
+}
+
+void lexer_token_iter_from_lexer(struct lexer_state_t* lexer, lexer_token_iterator_t* iter) {
+    iter->list = NULL;
+    iter->next_index = 0;
+    iter->end_index = 0;
+    iter->line_index = 0;
+
+    iter->lexer = lexer;
+    iter->lookahead_start = 0;
+    iter->lookahead_count = 0;
+}
+
+int lexer_token_iter_failed(lexer_token_iterator_t* iter) {
+    return iter->lexer != NULL && iter->lexer->error != 0;
+}
+
+// Pull mode: makes sure that the ring holds at least count tokens, reading them from the lexer
+// Returns 0 if the lexer ran out of tokens (or failed) before that
+int _lexer_token_iter_fill(lexer_token_iterator_t* iter, size_t count) {
+    while(iter->lookahead_count < count) {
+        size_t slot = (iter->lookahead_start + iter->lookahead_count) % LEXER_LOOKAHEAD;
+
+        if(lexer_next_token(iter->lexer, iter->lookahead + slot) != 1) return 0;
+
+        iter->lookahead_count += 1;
+    }
+
+    return 1;
 }
 
 // Returns pointer to the next token structure, or NULL when out of tokens
 lexer_token_t* lexer_token_iter_next(lexer_token_iterator_t* iter) {
-    if(iter->next_index < UTILS_LIST_GENERIC_LENGTH(iter->list)) {
-        lexer_token_t* tk = UTILS_LIST_GENERIC_GET(iter->list, iter->next_index);
+    if(iter->lexer != NULL) {
+        if(!_lexer_token_iter_fill(iter, 1)) return NULL;
+
+        iter->current = iter->lookahead[iter->lookahead_start];
+        iter->lookahead_start = (iter->lookahead_start + 1) % LEXER_LOOKAHEAD;
+        iter->lookahead_count -= 1;
+        iter->next_index += 1;
+        return &(iter->current);
+    }
+
+    if(iter->next_index < iter->end_index) {
+        _lexer_token_list_fill(iter->list, iter->next_index, &(iter->line_index), &(iter->current));
         iter->next_index += 1;
-        return tk;
+        return &(iter->current);
     } else {
         return NULL;
     }
@@ -54,13 +293,23 @@ lexer_token_t* lexer_token_iter_next(lexer_token_iterator_t* iter) {
 
 // Returns 1 if theres a next element or 0 if iter empty
 int lexer_token_iter_isnt_empty(lexer_token_iterator_t* iter) {
-    return iter->next_index < UTILS_LIST_GENERIC_LENGTH(iter->list);
+    if(iter->lexer != NULL) {
+        return _lexer_token_iter_fill(iter, 1);
+    }
+
+    return iter->next_index < iter->end_index;
 }
 
 lexer_token_t* lexer_token_iter_peek(lexer_token_iterator_t* iter) {
-    if(iter->next_index < UTILS_LIST_GENERIC_LENGTH(iter->list)) {
-        lexer_token_t* tk = UTILS_LIST_GENERIC_GET(iter->list, iter->next_index);
-        return tk;
+    if(iter->lexer != NULL) {
+        if(!_lexer_token_iter_fill(iter, 1)) return NULL;
+
+        return iter->lookahead + iter->lookahead_start;
+    }
+
+    if(iter->next_index < iter->end_index) {
+        _lexer_token_list_fill(iter->list, iter->next_index, &(iter->line_index), &(iter->current));
+        return &(iter->current);
     } else {
         return NULL;
     }
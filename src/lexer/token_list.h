@@ -21,28 +21,108 @@
 
 #include "token_types.h"
 
-#include "utils/list.h"
-
 #include <stddef.h>
+#include <stdint.h>
+
+#include "utils/intern.h"
 
 // Token has a type. Some types might have varying contents (stinrg literals, numeric literals).
-// If that is the case, the contents are saved in a malloc'ed buffer in token_contents.
-// Other times, for a static token, the contents buffer is not used.
-// During cleanup of the token structure, the TOKEN_TYPE_IS_DYNAMIC macro from token_types.h should be used.
+// If that is the case, contents points to the text of the token inside of the source code buffer
+// and length is the number of chars in it. The contents are NOT null-terminated and NOT owned by the token,
+// so the source buffer has to stay alive for as long as the tokens are used.
+// Other times, for a static token, contents is NULL (TOKEN_TYPE_IS_DYNAMIC macro from token_types.h tells which).
+// Identifiers are also interned by the lexer, id is their id in the table of names (UTILS_INTERN_NONE for other tokens).
+// Numeric literals are decoded by the lexer as well, value holds the number (0 for other tokens).
+//
+// Tokens are not stored in this form, the structure is a view filled in by the iterator from the packed list below.
 struct lexer_token_t {
     lexer_token_type_t type;    // Type of a token (token_tyes.h)
-    char* contents;             // If a token has dynamic contents, malloc'ed buffer
+    const char* contents;       // If a token has dynamic contents, slice of the source buffer
+    size_t length;              // Length of the token in chars
+    utils_intern_id_t id;       // Id of the interned identifier
+    uint64_t value;             // Value of the numeric literal
     size_t line_ref;            // Line number in file
     size_t char_ref;            // Character number in line (in file)
 };
 typedef struct lexer_token_t lexer_token_t;
 
-UTILS_LIST_MAKE_DECLARATION(lexer_token, struct lexer_token_t)
+// List of tokens, stored as parallel arrays with one entry per token in each of them.
+// Only the type, offset, length and payload of each token are kept (13 bytes per token),
+// everything else is derived from the source buffer when a token is read.
+// Line and char positions are found through an index of line beginnings,
+// which is built when the first iterator over the list is created.
+struct lexer_token_list_t {
+    size_t num_tokens;
+    size_t alloc_tokens;
+    uint8_t* types;             // lexer_token_type_t of every token
+    uint32_t* offsets;          // Offset of the first char of every token in the source buffer
+    uint32_t* lengths;          // Length of every token in chars
+    uint32_t* payloads;         // Interned id of an identifier, index into values for a numeric literal
+                                // UTILS_INTERN_NONE for other tokens
+
+    size_t num_values;
+    size_t alloc_values;
+    uint64_t* values;           // Values of numeric literals, most tokens are not numbers so they are kept aside
+
+    const char* source;         // Source buffer the offsets point into (set by the lexer)
+
+    size_t num_lines;
+    size_t alloc_lines;
+    uint32_t* line_starts;      // Offsets of first chars of every line, NULL until needed
+
+    int is_view;                // The arrays are borrowed (from a loaded binary file), they are not freed
+                                // and the list cannot grow
+};
+typedef struct lexer_token_list_t lexer_token_list_t;
+
+// The longest source which can be described by the offsets
+#define LEXER_MAX_SOURCE_LENGTH ((size_t) UINT32_MAX)
+
+lexer_token_list_t* lexer_token_list_make();
+
+// Makes a list without any arrays, for the caller to point them at memory it owns (see lexer_load_binary())
+// All the arrays, including line_starts, have to be set before the list is used
+lexer_token_list_t* lexer_token_list_make_view();
+void lexer_token_list_append(lexer_token_list_t* l, lexer_token_type_t type, uint32_t offset, uint32_t length, uint32_t payload);
+
+// Stores the value of a numeric literal, returns the payload to append the literal with
+uint32_t lexer_token_list_add_value(lexer_token_list_t* l, uint64_t value);
+
+// Adds the lines which begin after newlines between offsets from and to in the source to the index of lines
+// Normally the index is built in one go when it's first needed, this allows building it in parts instead
+void lexer_token_list_add_lines(lexer_token_list_t* l, size_t from, size_t to);
+
+// Adds a single line beginning at offset to the index of lines, it has to be after all the lines added before
+void lexer_token_list_append_line(lexer_token_list_t* l, uint32_t offset);
+void lexer_token_list_destroy(lexer_token_list_t* l);
+
+// Makes sure that the list has room for at least num_tokens tokens in total
+void lexer_token_list_reserve(lexer_token_list_t* l, size_t num_tokens);
+
+// Builds the index of line beginnings, if it was not built yet (iterators do it on their own)
+void lexer_token_list_index_lines(lexer_token_list_t* l);
+
+// Fills in the view of the token at index, looking up its position from the start
+// Iterators should be preferred for sequential access, since they remember where they are
+void lexer_token_list_get(lexer_token_list_t* l, size_t index, lexer_token_t* tk);
+
+// Number of tokens which the iterator may read ahead of the parser in pull mode
+#define LEXER_LOOKAHEAD 4
 
 // An iterator over a list of tokens
+// Alternatively, in pull mode, it reads tokens straight from a lexer as they are requested,
+// so the whole list never has to exist at once (only up to LEXER_LOOKAHEAD tokens are buffered)
 struct lexer_token_iterator_t {
-    lexer_token_list_t* list;   // Keeps reference to the list
+    lexer_token_list_t* list;   // Keeps reference to the list (NULL in pull mode)
     size_t next_index;          // Keeps track of the next index to retrieve
+    size_t end_index;           // One past the last index to retrieve
+    size_t line_index;          // Line of the last token read, positions are looked up starting from it
+    lexer_token_t current;      // Storage for the view returned by next/peek
+
+    struct lexer_state_t* lexer;                // Lexer to read from in pull mode (NULL otherwise)
+    lexer_token_t lookahead[LEXER_LOOKAHEAD];   // Ring of tokens which were peeked, but not consumed yet
+    size_t lookahead_start;
+    size_t lookahead_count;
 };
 typedef struct lexer_token_iterator_t lexer_token_iterator_t;
 
@@ -50,13 +130,27 @@ typedef struct lexer_token_iterator_t lexer_token_iterator_t;
 // WARNING the created iterator only references the list, do not destroy it before finishing iteration
 void lexer_token_list_into_iter(lexer_token_list_t* l, lexer_token_iterator_t* iter);
 
+// Same as above, but the iterator only goes over the tokens from index from up to (without) index to
+// The index of lines is built by the first iterator, after that many iterators may be used by many threads at once
+void lexer_token_list_range_iter(lexer_token_list_t* l, size_t from, size_t to, lexer_token_iterator_t* iter);
+
+// Creates an iterator which pulls tokens from the lexer on demand (see lexer.h)
+// WARNING the created iterator only references the lexer, which has to outlive it
+void lexer_token_iter_from_lexer(struct lexer_state_t* lexer, lexer_token_iterator_t* iter);
+
+// Returns 1 if the iterator stopped early because the lexer could not read a token, 0 otherwise
+int lexer_token_iter_failed(lexer_token_iterator_t* iter);
+
 // Returns pointer to the next token structure, or NULL when out of tokens
+// WARNING the token is stored inside of the iterator, it's only valid until the next call to next/peek
+// Copy the fields which are needed for longer
 lexer_token_t* lexer_token_iter_next(lexer_token_iterator_t* iter);
 
 // Returns 1 if theres a next element or 0 if iter empty
 int lexer_token_iter_isnt_empty(lexer_token_iterator_t* iter);
 
 // Return next token without removing it from the iterator (or NULL)
+// Same as with next, the returned token is only valid until the next call to next/peek
 lexer_token_t* lexer_token_iter_peek(lexer_token_iterator_t* iter);
 
 #endif
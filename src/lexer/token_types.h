@@ -75,4 +75,9 @@ typedef enum lexer_token_type_t lexer_token_type_t;
                                     type == TOKEN_LITERAL_CHAR || \
                                     type == TOKEN_IDENTIFIER)
 
+#define TOKEN_TYPE_IS_NUMERIC(type) (type == TOKEN_LITERAL_NUMERIC_BIN || \
+                                    type == TOKEN_LITERAL_NUMERIC_OCT || \
+                                    type == TOKEN_LITERAL_NUMERIC_DEC || \
+                                    type == TOKEN_LITERAL_NUMERIC_HEX)
+
 #endif
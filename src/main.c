@@ -16,76 +16,371 @@
 
 // main - Entry point of the program
 
+// open_memstream() is not a part of C99
+#define _DEFAULT_SOURCE
+
 #include "io/fileread.h"
 #include "lexer/lexer.h"
 #include "parser/parser.h"
+#include "resolver/resolver.h"
 #include "types/types.h"
-#include "utils/list.h"
 #include "context/args.h"
+#include "context/driver.h"
+#include "context/server.h"
+#include "context/report.h"
+#include "io/binfile.h"
+#include "io/cache.h"
+#include "io/memcache.h"
+#include "utils/intern.h"
+#include "utils/diag.h"
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 
+// Returns the saved result of the stage with the key, looking in memory first and in the cache directory then
+io_source_t* _load_cached(const context_args_t* args, const char* key) {
+    io_source_t* cached = NULL;
 
+    if(args->memory_cache != NULL) {
+        cached = io_memcache_load(args->memory_cache, key);
+    }
 
-int main(int argc, char** argv) {
-#if 1
-    context_args_t* args = context_args_parse(argc, argv);
-    if(args == NULL) {
-        return 0;
+    if(cached == NULL && args->cache_dir != NULL) {
+        cached = io_cache_load(args->cache_dir, key);
+
+        // Next time it's found in memory
+        if(cached != NULL && args->memory_cache != NULL) {
+            io_memcache_store(args->memory_cache, key, cached->contents, cached->length);
+        }
     }
 
-    // Retrieve source code from somewhere (in this case, a file)
-    // Store it as a null-terminated string
-    char* filecontents = io_read_source_file(args->input_file);
-    if(filecontents == NULL) {
-        free(args);
-        return 0;
+    return cached;
+}
+
+// Saves the binary result of the stage under the key in the caches which are enabled
+// Failing to save the result is not an error of the compilation, the output is still written
+void _store_cached(const context_args_t* args, const char* key, const char* data, size_t length) {
+    if(args->memory_cache != NULL) {
+        io_memcache_store(args->memory_cache, key, data, length);
+    }
+
+    io_cache_entry_t entry;
+    if(args->cache_dir != NULL && io_cache_begin_store(args->cache_dir, key, &entry) == 0) {
+        int failed = length != 0 && fwrite(data, 1, length, entry.file) != length;
+        io_cache_end_store(&entry, failed);
     }
+}
 
-    // Initialize a list of tokens
-    lexer_token_list_t* list = lexer_token_list_make();
+// Runs the whole compilation of the source (which is destroyed afterwards), up to the stage from args
+// Time and memory of every stage go into the report, unless it's NULL
+// Return value: 0 if ok, 1 if error
+int _compile_source_reported(const context_args_t* args, io_source_t* source, FILE* outfile, size_t num_threads, context_report_t* report) {
+    int result = 0;
 
-    // Process the source code, filling the list of tokens
-    // Token data is copied, where necessary so one may immediately free source code buffer
-    int result = lexer_process_source_code(filecontents, list);
-    free(filecontents);
+    if(report != NULL) report->source_bytes = source->length;
 
-    // Error checking
-    if(result != 0) {
-        free(args);
-        return 0;
+    // With a cache, an unchanged input is replaced with the saved result of the stage,
+    // otherwise the result is saved once it's ready
+    char cache_key[IO_CACHE_KEY_LENGTH + 1];
+    int store_in_cache = 0;
+
+    // The binary result is written here first, so that it can go to both of the caches
+    char* cache_data = NULL;
+    size_t cache_length = 0;
+
+    if((args->cache_dir != NULL || args->memory_cache != NULL) && !io_binfile_is_binary(source->contents, source->length)) {
+        context_report_begin(report, REPORT_STAGE_CACHE);
+        io_cache_make_key(source->contents, source->length, (uint32_t) args->output_stage, cache_key);
+
+        io_source_t* cached = _load_cached(args, cache_key);
+        if(cached != NULL) {
+            io_source_destroy(source);
+            source = cached;
+            if(report != NULL) report->from_cache = 1;
+        } else {
+            store_in_cache = 1;
+        }
+        context_report_end(report, REPORT_STAGE_CACHE);
+    }
+
+    // The input may also be the binary output of a stage, then the compilation starts from it
+    io_binfile_t binfile;
+    int is_binary = io_binfile_is_binary(source->contents, source->length);
+
+    if(is_binary && io_binfile_open(&binfile, source->contents, source->length) != 0) {
+        io_source_destroy(source);
+        return 1;
     }
 
+    // The lexing stage output needs the whole list of tokens
     if(args->output_stage == STAGE_LEXER) {
-        lexer_write_output(args->output_file, list);
-        free(args);
-        return 0;
+        // Nothing refers to identifiers by their ids in the text output, so they are only interned
+        // if the table of names is a part of the input or of the output
+        utils_intern_table_t* names = NULL;
+        if(is_binary || args->output_format == FORMAT_BINARY || store_in_cache) {
+            names = utils_intern_table_make();
+            type_intern_builtins(names);
+            context_report_track_arena(report, names->storage);
+        }
+
+        lexer_token_list_t* list = NULL;
+        context_report_begin(report, REPORT_STAGE_LEXER);
+
+        if(is_binary) {
+            // Tokens of the binary input are used in place
+            list = lexer_token_list_make_view();
+            result = lexer_load_binary(&binfile, names, list);
+        } else {
+            // Initialize a list of tokens
+            list = lexer_token_list_make();
+
+            // Process the source code, filling the list of tokens
+            // Tokens reference the source code buffer instead of copying it, so it has to stay alive
+            // for the whole compilation
+            result = lexer_process_source_code_parallel(source->contents, names, list, num_threads);
+        }
+
+        context_report_end(report, REPORT_STAGE_LEXER);
+        if(report != NULL) {
+            report->num_tokens = list->num_tokens;
+            report->num_names = names != NULL ? names->num_strings : 0;
+        }
+
+        FILE* cache_file = NULL;
+        if(result == 0 && store_in_cache && (cache_file = open_memstream(&cache_data, &cache_length)) != NULL) {
+            context_report_begin(report, REPORT_STAGE_CACHE);
+            int failed = lexer_write_binary(cache_file, list, names);
+            fclose(cache_file);
+
+            if(!failed) _store_cached(args, cache_key, cache_data, cache_length);
+            free(cache_data);
+            context_report_end(report, REPORT_STAGE_CACHE);
+        }
+
+        context_report_begin(report, REPORT_STAGE_OUTPUT);
+        if(result == 0 && args->output_format == FORMAT_BINARY) {
+            result = lexer_write_binary(outfile, list, names);
+        } else if(result == 0) {
+            lexer_write_output(outfile, list);
+        }
+        context_report_end(report, REPORT_STAGE_OUTPUT);
+
+        context_report_untrack_arenas(report);
+        lexer_token_list_destroy(list);
+        utils_intern_table_destroy(names);
+        io_source_destroy(source);
+        return result;
     }
 
+    // Identifiers go straight into the table of names of the AST
     ast_global_scope_t* ast = ast_global_scope_make();
-    result = parser_process_token_list(list, ast);
 
-    // After all tokens have been consumed, destroy the list.
-    lexer_token_list_destroy(list);
+    context_report_track_arena(report, ast->names->storage);
+    context_report_track_arena(report, ast->types->storage);
+
+    if(is_binary && binfile.stage == IO_BINFILE_STAGE_PARSER) {
+        // The AST was saved, nothing is left to do for the lexer or the parser
+        context_report_begin(report, REPORT_STAGE_PARSER);
+        result = parser_load_binary(&binfile, ast);
+        context_report_end(report, REPORT_STAGE_PARSER);
+    } else if(is_binary || num_threads > 1) {
+        // Saved tokens are parsed the same way as the ones from the parallel lexer
+        // With more threads the whole source is lexed up front, then the list is parsed in chunks
+        context_report_begin(report, REPORT_STAGE_LEXER);
+        lexer_token_list_t* list = NULL;
+
+        if(is_binary) {
+            list = lexer_token_list_make_view();
+            result = lexer_load_binary(&binfile, ast->names, list);
+        } else {
+            list = lexer_token_list_make();
+            result = lexer_process_source_code_parallel(source->contents, ast->names, list, num_threads);
+        }
+
+        context_report_end(report, REPORT_STAGE_LEXER);
+        if(report != NULL) report->num_tokens = list->num_tokens;
+
+        if(result == 0) {
+            context_report_begin(report, REPORT_STAGE_PARSER);
+            result = parser_process_token_list_parallel(list, ast, num_threads);
+            context_report_end(report, REPORT_STAGE_PARSER);
+        }
+
+        lexer_token_list_destroy(list);
+    } else {
+        // Otherwise the parser pulls tokens from the lexer as it goes, so the list is never built
+        context_report_begin(report, REPORT_STAGE_PARSER);
+        lexer_state_t lexer;
+        lexer_state_init(&lexer, source->contents, ast->names);
+
+        lexer_token_iterator_t iter;
+        lexer_token_iter_from_lexer(&lexer, &iter);
+
+        result = parser_process_tokens(&iter, ast);
+        context_report_end(report, REPORT_STAGE_PARSER);
+        if(report != NULL) report->num_tokens = lexer.num_tokens;
+    }
+
+    if(report != NULL) {
+        report->num_decls = UTILS_VEC_LENGTH(&(ast->decls));
+        report->num_types = ast->types->num_types;
+        report->num_names = ast->names->num_strings;
+    }
 
     // Error checking
     if(result != 0) {
-        free(args);
+        context_report_untrack_arenas(report);
+        io_source_destroy(source);
         ast_global_scope_destroy(ast);
-        return 0;
+        return result;
+    }
+
+    FILE* cache_file = NULL;
+    if(store_in_cache && (cache_file = open_memstream(&cache_data, &cache_length)) != NULL) {
+        context_report_begin(report, REPORT_STAGE_CACHE);
+        int failed = parser_write_binary(cache_file, ast);
+        fclose(cache_file);
+
+        if(!failed) _store_cached(args, cache_key, cache_data, cache_length);
+        free(cache_data);
+        context_report_end(report, REPORT_STAGE_CACHE);
     }
 
     if(args->output_stage == STAGE_PARSER) {
-        parser_write_output(args->output_file, ast);
+        context_report_begin(report, REPORT_STAGE_OUTPUT);
+        if(args->output_format == FORMAT_BINARY) {
+            result = parser_write_binary(outfile, ast);
+        } else {
+            parser_write_output(outfile, ast);
+        }
+        context_report_end(report, REPORT_STAGE_OUTPUT);
+
+        context_report_untrack_arenas(report);
         ast_global_scope_destroy(ast);
-        free(args);
-        return 0;
+        io_source_destroy(source);
+        return result;
+    }
+
+    // Symbols are resolved again on every run, the binary output and the caches hold only the AST
+    resolver_symbols_t* symbols = resolver_symbols_make();
+
+    context_report_begin(report, REPORT_STAGE_RESOLVER);
+    result = resolver_process_ast(ast, symbols);
+    context_report_end(report, REPORT_STAGE_RESOLVER);
+
+    if(result == 0) {
+        context_report_begin(report, REPORT_STAGE_OUTPUT);
+        if(args->output_format == FORMAT_BINARY) {
+            result = parser_write_binary(outfile, ast);
+        } else {
+            resolver_write_output(outfile, ast, symbols);
+        }
+        context_report_end(report, REPORT_STAGE_OUTPUT);
     }
 
-    // TODO: After parsing is finished move to next stage (probably validity checks?)
+    // TODO: After the symbols are resolved move to next stage (probably type checks?)
 
-    free(args);
+    context_report_untrack_arenas(report);
+    resolver_symbols_destroy(symbols);
+    io_source_destroy(source);
     ast_global_scope_destroy(ast);
-#endif
+    return result;
+}
+
+// Same as above, for sources which do not come from a file (requests to the server)
+int _compile_source(const context_args_t* args, io_source_t* source, FILE* outfile, size_t num_threads) {
+    if(args->time_report == TIME_REPORT_NONE) {
+        return _compile_source_reported(args, source, outfile, num_threads, NULL);
+    }
+
+    context_report_t report;
+    context_report_init(&report, "<request>");
+
+    // Requests are handled on their own threads, up to args->num_jobs at once
+    context_report_set_threads(&report, num_threads, args->num_jobs > 1);
+
+    report.status = _compile_source_reported(args, source, outfile, num_threads, &report);
+    context_report_finish(args, &report);
+
+    return report.status;
+}
+
+// Compiles the file at path ("-" being stdin)
+// Return value: 0 if ok, 1 if error
+int _compile_input(const context_args_t* args, const char* path, FILE* outfile, size_t num_threads) {
+    FILE* infile = stdin;
+    if(strcmp(path, "-") != 0) {
+        infile = fopen(path, "r");
+    }
+
+    if(infile == NULL) {
+        fprintf(UTILS_DIAG, "[context] Error: cannot open file %s for reading.\n", path);
+        return 1;
+    }
+
+    context_report_t report;
+    context_report_t* report_ptr = args->time_report != TIME_REPORT_NONE ? &report : NULL;
+    context_report_init(&report, path);
+
+    // The driver gives all of its threads to a single input, or one thread to each of many inputs at once
+    context_report_set_threads(report_ptr, num_threads, num_threads < args->num_jobs);
+
+    // Retrieve source code from somewhere (in this case, a file or stdin)
+    // Store it as a null-terminated string
+    // A mapped file stays mapped after it is closed
+    context_report_begin(report_ptr, REPORT_STAGE_READ);
+    io_source_t* source = io_read_source_file(infile);
+    if(infile != stdin) fclose(infile);
+    context_report_end(report_ptr, REPORT_STAGE_READ);
+
+    report.status = source != NULL ? _compile_source_reported(args, source, outfile, num_threads, report_ptr) : 1;
+    context_report_finish(args, report_ptr);
+
+    return report.status;
+}
+
+int main(int argc, char** argv) {
+    context_args_t* args = context_args_parse(argc, argv);
+    if(args == NULL) {
+        return 1;
+    }
+
+    // The JSON report is opened up front, so that a bad path fails before all the work is done
+    FILE* report_file = NULL;
+    if(args->time_report == TIME_REPORT_JSON) {
+        report_file = fopen(args->time_report_file, "w");
+        if(report_file == NULL) {
+            fprintf(stderr, "[context] Error: cannot open file %s for writing.\n", args->time_report_file);
+            context_args_destroy(args);
+            return 1;
+        }
+
+        args->report_log = context_report_log_make();
+    }
+
+    // Every input is compiled on its own, the exit status tells if any of them failed
+    size_t num_failed = 0;
+    if(args->server_socket != NULL) {
+        num_failed = context_server_run(args, _compile_source);
+    } else if(args->client_socket != NULL) {
+        num_failed = context_client_run(args);
+    } else {
+        num_failed = context_compile_all(args, _compile_input);
+    }
+
+    if(report_file != NULL) {
+        int failed = context_report_log_write_json(report_file, args->report_log, &(args->inputs));
+        if(fclose(report_file) != 0 || failed) {
+            fprintf(stderr, "[context] Error: cannot write the time report to %s\n", args->time_report_file);
+            num_failed += 1;
+        }
+
+        context_report_log_destroy(args->report_log);
+    }
+
+    if(args->output_file != stdout) fclose(args->output_file);
+    context_args_destroy(args);
+
+    return num_failed != 0 ? 1 : 0;
 }
@@ -0,0 +1,386 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// binary - Binary output of the parsing stage, and loading it back
+
+#include "parser.h"
+#include "parse_types.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "ast/ast.h"
+#include "types/types.h"
+#include "types/type_table.h"
+#include "io/binfile.h"
+#include "utils/intern.h"
+#include "utils/strbuf.h"
+#include "utils/vec.h"
+#include "utils/diag.h"
+
+int parser_write_binary(FILE* outfile, ast_global_scope_t* ast) {
+    utils_strbuf_t blob;
+    utils_strbuf_init(&blob);
+
+    uint32_t* name_offsets = malloc((ast->names->num_strings + 1) * sizeof(uint32_t));
+    utils_intern_table_pack(ast->names, &blob, name_offsets);
+
+    // Types are flattened in the order of ids, children are referred to by their ids
+    type_table_t* types = ast->types;
+    io_binfile_type_t* type_records = malloc(types->num_types * sizeof(io_binfile_type_t));
+
+    size_t num_args = 0;
+    for(size_t id = 0; id < types->num_types; id++) {
+        if(TYPE_TABLE_GET(types, id)->family == TYPE_FAMILY_ROUTINE) {
+            num_args += TYPE_TABLE_GET(types, id)->type_data.routine.num_args;
+        }
+    }
+
+    uint32_t* type_args = malloc((num_args + 1) * sizeof(uint32_t));
+    num_args = 0;
+
+    for(size_t id = 0; id < types->num_types; id++) {
+        const type_info_t* type = TYPE_TABLE_GET(types, id);
+        io_binfile_type_t* record = type_records + id;
+
+        record->family = (uint32_t) type->family;
+        record->payload = type->id;
+        record->first_arg = 0;
+        record->num_args = 0;
+
+        if(type->family == TYPE_FAMILY_POINTER) {
+            record->payload = type->type_data.pointer.type->id;
+        } else if(type->family == TYPE_FAMILY_ROUTINE) {
+            const type_info_routine_t* rt = &(type->type_data.routine);
+
+            record->payload = rt->return_type->id;
+            record->first_arg = (uint32_t) num_args;
+            record->num_args = rt->args != NULL ? (uint32_t) rt->num_args : IO_BINFILE_NO_ARGS;
+
+            for(size_t i = 0; i < rt->num_args; i++) {
+                type_args[num_args] = rt->args[i]->id;
+                num_args += 1;
+            }
+        }
+    }
+
+    io_binfile_writer_t w;
+    io_binfile_writer_init(&w, IO_BINFILE_STAGE_PARSER);
+
+    io_binfile_writer_add(&w, IO_BINFILE_SECTION_NAMES, UTILS_STRBUF_DATA(&blob), sizeof(char), UTILS_STRBUF_LENGTH(&blob));
+    io_binfile_writer_add(&w, IO_BINFILE_SECTION_NAME_OFFSETS, name_offsets, sizeof(uint32_t), ast->names->num_strings);
+    io_binfile_writer_add(&w, IO_BINFILE_SECTION_TYPES, type_records, sizeof(io_binfile_type_t), types->num_types);
+    io_binfile_writer_add(&w, IO_BINFILE_SECTION_TYPE_ARGS, type_args, sizeof(uint32_t), num_args);
+    // Nodes of the AST have no pointers, they are written as they are
+    io_binfile_writer_add(&w, IO_BINFILE_SECTION_DECLS, ast->decls.arr, sizeof(ast_decl_t), UTILS_VEC_LENGTH(&(ast->decls)));
+    io_binfile_writer_add(&w, IO_BINFILE_SECTION_EXPRS, ast->exprs.arr, sizeof(ast_expr_t), UTILS_VEC_LENGTH(&(ast->exprs)));
+    io_binfile_writer_add(&w, IO_BINFILE_SECTION_EXPR_ARGS, ast->expr_args.arr, sizeof(uint32_t), UTILS_VEC_LENGTH(&(ast->expr_args)));
+    io_binfile_writer_add(&w, IO_BINFILE_SECTION_STMTS, ast->stmts.arr, sizeof(ast_stmt_t), UTILS_VEC_LENGTH(&(ast->stmts)));
+    io_binfile_writer_add(&w, IO_BINFILE_SECTION_ROUTINES, ast->routines.arr, sizeof(ast_routine_t), UTILS_VEC_LENGTH(&(ast->routines)));
+    io_binfile_writer_add(&w, IO_BINFILE_SECTION_LOCALS, ast->locals.arr, sizeof(ast_decl_t), UTILS_VEC_LENGTH(&(ast->locals)));
+    io_binfile_writer_add(&w, IO_BINFILE_SECTION_LITERALS, UTILS_STRBUF_DATA(&(ast->literals)), sizeof(char), UTILS_STRBUF_LENGTH(&(ast->literals)));
+
+    int result = io_binfile_write(&w, outfile);
+
+    free(type_args);
+    free(type_records);
+    free(name_offsets);
+    utils_strbuf_deinit(&blob);
+
+    return result;
+}
+
+// Adds the types of the file to the table, in order, so that they get the same ids as before
+// Return value: 0 if ok, 1 if error
+int _parser_load_types(type_table_t* types, const io_binfile_type_t* records, size_t num_types, const uint32_t* type_args, size_t num_args) {
+    // Builtins are in every table already, and they are always the same
+    if(num_types < TYPE_BUILTINS_NUM) return 1;
+
+    for(size_t id = 0; id < TYPE_BUILTINS_NUM; id++) {
+        if(records[id].family != TYPE_FAMILY_BUILTIN || records[id].payload != id) return 1;
+    }
+
+    type_info_ptr_vec_t args;
+    type_info_ptr_vec_init(&args);
+
+    // Nesting of every type, limited like in the source, so that later stages do not get huge types
+    // A routine literal adds one level above the types of its params
+    uint16_t* depths = calloc(num_types, sizeof(uint16_t));
+
+    for(size_t id = TYPE_BUILTINS_NUM; id < num_types; id++) {
+        const io_binfile_type_t* record = records + id;
+
+        // Children always have lower ids than the types built from them
+        if(record->payload >= id) break;
+
+        depths[id] = depths[record->payload] + 1;
+
+        type_info_t* type = NULL;
+        type_info_t* child = TYPE_TABLE_GET(types, record->payload);
+
+        if(record->family == TYPE_FAMILY_POINTER) {
+            type = type_make_pointer_to(types, child);
+        } else if(record->family == TYPE_FAMILY_ROUTINE && record->num_args == IO_BINFILE_NO_ARGS) {
+            type = type_make_routine(types, NULL, child);
+        } else if(record->family == TYPE_FAMILY_ROUTINE) {
+            if(record->first_arg > num_args || record->num_args > num_args - record->first_arg) break;
+
+            type_info_ptr_vec_truncate(&args, 0);
+            for(size_t i = 0; i < record->num_args; i++) {
+                uint32_t arg_id = type_args[record->first_arg + i];
+                if(arg_id >= id) break;
+
+                if(depths[arg_id] >= depths[id]) depths[id] = depths[arg_id] + 1;
+                type_info_ptr_vec_push(&args, TYPE_TABLE_GET(types, arg_id));
+            }
+
+            if(UTILS_VEC_LENGTH(&args) != record->num_args) break;
+
+            type = type_make_routine(types, &args, child);
+        }
+
+        // A duplicate would get the id of the first one
+        if(type == NULL || type->id != id) break;
+        if(depths[id] > PARSER_MAX_TYPE_DEPTH + 1) break;
+    }
+
+    free(depths);
+    type_info_ptr_vec_deinit(&args);
+
+    return types->num_types != num_types;
+}
+
+// Marks the expression as referred to, every one can be referred to only once and only from after it (below limit)
+// Return value: 0 if ok, 1 if error
+int _parser_use_expr(uint8_t* used, uint32_t id, size_t limit) {
+    if(id >= limit || used[id]) return 1;
+
+    used[id] = 1;
+    return 0;
+}
+
+// Marks the expressions of the statements of the routine, which has to be the expression with the id limit
+// Return value: 0 if ok, 1 if error
+int _parser_use_routine_exprs(ast_global_scope_t* ast, uint8_t* used, const ast_routine_t* routine, size_t limit) {
+    for(uint32_t idx = 0; idx < routine->num_stmts; idx++) {
+        const ast_stmt_t* stmt = &UTILS_VEC_AT(&(ast->stmts), routine->first_stmt + idx);
+        uint32_t value = stmt->kind == AST_STMT_DECL ? UTILS_VEC_AT(&(ast->locals), stmt->value).value : stmt->value;
+
+        if(value != AST_EXPR_NONE && _parser_use_expr(used, value, limit) != 0) return 1;
+    }
+
+    return 0;
+}
+
+// Checks that the declarations refer only to existing names, types and expressions
+// Return value: 0 if ok, 1 if error
+int _parser_check_decls(ast_global_scope_t* ast, const ast_decl_vec_t* decls) {
+    for(size_t idx = 0; idx < UTILS_VEC_LENGTH(decls); idx++) {
+        const ast_decl_t* decl = &UTILS_VEC_AT(decls, idx);
+
+        if(decl->symbol >= ast->names->num_strings) return 1;
+        if(decl->type != TYPE_ID_NONE && decl->type >= ast->types->num_types) return 1;
+        if(decl->value != AST_EXPR_NONE && decl->value >= UTILS_VEC_LENGTH(&(ast->exprs))) return 1;
+    }
+
+    return 0;
+}
+
+// Checks that the nodes loaded into the AST form trees, so that walking them always ends
+// and visits every node once, and that everything they refer to exists
+// Return value: 0 if ok, 1 if error
+int _parser_check_ast(ast_global_scope_t* ast) {
+    size_t num_exprs = UTILS_VEC_LENGTH(&(ast->exprs));
+    size_t num_args = UTILS_VEC_LENGTH(&(ast->expr_args));
+    size_t num_stmts = UTILS_VEC_LENGTH(&(ast->stmts));
+    size_t num_routines = UTILS_VEC_LENGTH(&(ast->routines));
+    size_t num_locals = UTILS_VEC_LENGTH(&(ast->locals));
+    size_t num_names = ast->names->num_strings;
+    size_t literals_length = UTILS_STRBUF_LENGTH(&(ast->literals));
+
+    // One flag per expression, then per local and per routine
+    uint8_t* used = calloc(num_exprs + num_locals + num_routines + 1, sizeof(uint8_t));
+    uint8_t* used_locals = used + num_exprs;
+    uint8_t* used_routines = used_locals + num_locals;
+    int result = 1;
+
+    if(_parser_check_decls(ast, &(ast->decls)) != 0 || _parser_check_decls(ast, &(ast->locals)) != 0) goto cleanup;
+
+    // Statements of routines follow each other, their params are locals referred to by nothing else
+    size_t next_stmt = 0;
+    for(size_t idx = 0; idx < num_routines; idx++) {
+        const ast_routine_t* routine = &UTILS_VEC_AT(&(ast->routines), idx);
+
+        if(routine->first_stmt != next_stmt || routine->num_stmts > num_stmts - next_stmt) goto cleanup;
+        if(routine->first_param > num_locals || routine->num_params > num_locals - routine->first_param) goto cleanup;
+        if(routine->type >= ast->types->num_types || TYPE_TABLE_GET(ast->types, routine->type)->family != TYPE_FAMILY_ROUTINE) goto cleanup;
+        next_stmt += routine->num_stmts;
+
+        for(uint32_t i = 0; i < routine->num_params; i++) {
+            const ast_decl_t* param = &UTILS_VEC_AT(&(ast->locals), routine->first_param + i);
+
+            if(used_locals[routine->first_param + i] || param->type == TYPE_ID_NONE || param->value != AST_EXPR_NONE) goto cleanup;
+            used_locals[routine->first_param + i] = 1;
+        }
+    }
+
+    if(next_stmt != num_stmts) goto cleanup;
+
+    for(size_t idx = 0; idx < num_stmts; idx++) {
+        const ast_stmt_t* stmt = &UTILS_VEC_AT(&(ast->stmts), idx);
+
+        if(stmt->kind == AST_STMT_DECL) {
+            if(stmt->value >= num_locals || used_locals[stmt->value]) goto cleanup;
+            used_locals[stmt->value] = 1;
+        } else if(stmt->kind == AST_STMT_RETURN) {
+            if(stmt->value != AST_EXPR_NONE && stmt->value >= num_exprs) goto cleanup;
+        } else if(stmt->kind != AST_STMT_EXPR || stmt->value >= num_exprs) {
+            goto cleanup;
+        }
+    }
+
+    for(size_t id = 0; id < num_exprs; id++) {
+        const ast_expr_t* expr = AST_EXPR_GET(ast, id);
+
+        switch(expr->kind) {
+            case AST_EXPR_INTEGER: break;
+
+            case AST_EXPR_STRING:
+            case AST_EXPR_CHAR: {
+                if(expr->left > literals_length || expr->right > literals_length - expr->left) goto cleanup;
+                break;
+            }
+
+            case AST_EXPR_SYMBOL: {
+                if(expr->left >= num_names) goto cleanup;
+                break;
+            }
+
+            case AST_EXPR_UNARY: {
+                if(expr->op > AST_EXPR_OP_ADDR || _parser_use_expr(used, expr->left, id) != 0) goto cleanup;
+                break;
+            }
+
+            case AST_EXPR_BINARY: {
+                if(expr->op < AST_EXPR_OP_INDEX || expr->op >= AST_EXPR_OPS_NUM) goto cleanup;
+                if(_parser_use_expr(used, expr->left, id) != 0 || _parser_use_expr(used, expr->right, id) != 0) goto cleanup;
+                break;
+            }
+
+            case AST_EXPR_CALL: {
+                if(_parser_use_expr(used, expr->left, id) != 0 || expr->right >= num_args) goto cleanup;
+
+                uint32_t count = UTILS_VEC_AT(&(ast->expr_args), expr->right);
+                if(count > num_args - expr->right - 1) goto cleanup;
+
+                for(uint32_t i = 1; i <= count; i++) {
+                    if(_parser_use_expr(used, UTILS_VEC_AT(&(ast->expr_args), expr->right + i), id) != 0) goto cleanup;
+                }
+                break;
+            }
+
+            case AST_EXPR_MEMBER: {
+                if(_parser_use_expr(used, expr->left, id) != 0 || expr->right >= num_names) goto cleanup;
+                break;
+            }
+
+            case AST_EXPR_ROUTINE: {
+                if(expr->left >= num_routines || used_routines[expr->left]) goto cleanup;
+                used_routines[expr->left] = 1;
+
+                const ast_routine_t* routine = &UTILS_VEC_AT(&(ast->routines), expr->left);
+                if(_parser_use_routine_exprs(ast, used, routine, id) != 0) goto cleanup;
+                break;
+            }
+
+            default: goto cleanup;
+        }
+    }
+
+    // Values of global declarations are the roots
+    result = 0;
+    for(size_t idx = 0; idx < UTILS_VEC_LENGTH(&(ast->decls)) && result == 0; idx++) {
+        uint32_t value = UTILS_VEC_AT(&(ast->decls), idx).value;
+        result = value != AST_EXPR_NONE && _parser_use_expr(used, value, num_exprs) != 0;
+    }
+
+cleanup:
+    free(used);
+
+    return result;
+}
+
+int parser_load_binary(const io_binfile_t* binfile, ast_global_scope_t* ast) {
+    if(binfile->stage != IO_BINFILE_STAGE_PARSER) {
+        fprintf(UTILS_DIAG, "%s", "[parser] Error loading binary input: not an output of the parsing stage\n");
+        return 1;
+    }
+
+    size_t blob_length = 0;
+    size_t num_names = 0;
+    size_t num_types = 0;
+    size_t num_args = 0;
+    size_t num_decls = 0;
+    size_t num_exprs = 0;
+    size_t num_expr_args = 0;
+    size_t num_stmts = 0;
+    size_t num_routines = 0;
+    size_t num_locals = 0;
+    size_t literals_length = 0;
+
+    const char* blob = io_binfile_get(binfile, IO_BINFILE_SECTION_NAMES, sizeof(char), &blob_length);
+    const uint32_t* name_offsets = io_binfile_get(binfile, IO_BINFILE_SECTION_NAME_OFFSETS, sizeof(uint32_t), &num_names);
+    const io_binfile_type_t* type_records = io_binfile_get(binfile, IO_BINFILE_SECTION_TYPES, sizeof(io_binfile_type_t), &num_types);
+    const uint32_t* type_args = io_binfile_get(binfile, IO_BINFILE_SECTION_TYPE_ARGS, sizeof(uint32_t), &num_args);
+    const ast_decl_t* decl_records = io_binfile_get(binfile, IO_BINFILE_SECTION_DECLS, sizeof(ast_decl_t), &num_decls);
+
+    const ast_expr_t* expr_records = io_binfile_get(binfile, IO_BINFILE_SECTION_EXPRS, sizeof(ast_expr_t), &num_exprs);
+    const uint32_t* expr_args = io_binfile_get(binfile, IO_BINFILE_SECTION_EXPR_ARGS, sizeof(uint32_t), &num_expr_args);
+    const ast_stmt_t* stmt_records = io_binfile_get(binfile, IO_BINFILE_SECTION_STMTS, sizeof(ast_stmt_t), &num_stmts);
+    const ast_routine_t* routine_records = io_binfile_get(binfile, IO_BINFILE_SECTION_ROUTINES, sizeof(ast_routine_t), &num_routines);
+    const ast_decl_t* local_records = io_binfile_get(binfile, IO_BINFILE_SECTION_LOCALS, sizeof(ast_decl_t), &num_locals);
+    const char* literals = io_binfile_get(binfile, IO_BINFILE_SECTION_LITERALS, sizeof(char), &literals_length);
+
+    if(blob == NULL || name_offsets == NULL || type_records == NULL || type_args == NULL || decl_records == NULL) return 1;
+    if(expr_records == NULL || expr_args == NULL || stmt_records == NULL || routine_records == NULL || local_records == NULL || literals == NULL) return 1;
+
+    if(utils_intern_table_unpack(ast->names, blob, blob_length, name_offsets, num_names) != 0) {
+        fprintf(UTILS_DIAG, "%s", "[parser] Error loading binary input: invalid table of names\n");
+        return 1;
+    }
+
+    if(_parser_load_types(ast->types, type_records, num_types, type_args, num_args) != 0) {
+        fprintf(UTILS_DIAG, "%s", "[parser] Error loading binary input: invalid table of types\n");
+        return 1;
+    }
+
+    // Nodes have no pointers, they are copied as they are and checked afterwards
+    ast_decl_vec_append(&(ast->decls), decl_records, num_decls);
+    ast_decl_vec_append(&(ast->locals), local_records, num_locals);
+    ast_routine_vec_append(&(ast->routines), routine_records, num_routines);
+    ast_expr_vec_append(&(ast->exprs), expr_records, num_exprs);
+    ast_index_vec_append(&(ast->expr_args), expr_args, num_expr_args);
+    ast_stmt_vec_append(&(ast->stmts), stmt_records, num_stmts);
+    utils_strbuf_append(&(ast->literals), literals, literals_length);
+
+    if(_parser_check_ast(ast) != 0) {
+        fprintf(UTILS_DIAG, "%s", "[parser] Error loading binary input: invalid nodes of the AST\n");
+        return 1;
+    }
+
+    return 0;
+}
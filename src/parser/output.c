@@ -17,24 +17,235 @@
 // output - Printing output of the parsing stage
 
 #include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
 
-#include "utils/list.h"
+#include "utils/vec.h"
+#include "utils/strbuf.h"
+#include "utils/intern.h"
 #include "ast/ast.h"
+#include "types/type_table.h"
+
+// Expressions are printed with an explicit stack of pending pieces, not recursively,
+// so a long chain of operators does not need a deep C stack
+enum _parser_print_kind_t {
+    PRINT_TEXT = 0,     // text is printed as it is
+    PRINT_EXPR,         // index is the id of an expression
+    PRINT_STMT,         // index is the index of a statement
+};
+
+struct _parser_print_item_t {
+    int kind;
+    const char* text;
+    uint32_t index;
+};
+
+UTILS_VEC_MAKE_SMALL_DECLARATION(_parser_print, struct _parser_print_item_t, 32)
+UTILS_VEC_MAKE_SMALL_IMPLEMENTATION(_parser_print, struct _parser_print_item_t, 128)
+
+void _parser_print_push(_parser_print_vec_t* stack, int kind, const char* text, uint32_t index) {
+    struct _parser_print_item_t item = { .kind = kind, .text = text, .index = index };
+    _parser_print_vec_push(stack, item);
+}
+
+// Writes the routine literal up to the opening of its body and pushes the statements of the body
+void _parser_print_routine(utils_strbuf_t* buf, _parser_print_vec_t* stack, ast_global_scope_t* ast, const ast_routine_t* routine) {
+    const type_info_routine_t* type = &(TYPE_TABLE_GET(ast->types, routine->type)->type_data.routine);
+
+    utils_strbuf_append_cstr(buf, "rt ");
+
+    if(type->args != NULL) {
+        utils_strbuf_append_char(buf, '[');
+
+        for(uint32_t idx = 0; idx < routine->num_params; idx++) {
+            const ast_decl_t* param = &UTILS_VEC_AT(&(ast->locals), routine->first_param + idx);
+
+            if(idx != 0) utils_strbuf_append_cstr(buf, ", ");
+            utils_strbuf_append_cstr(buf, AST_DECL_SYMBOL(ast, param));
+            utils_strbuf_append_cstr(buf, ": ");
+            utils_strbuf_append_cstr(buf, type_table_to_string(ast->types, AST_TYPE_GET(ast, param->type)));
+        }
+
+        utils_strbuf_append_char(buf, ']');
+    }
+
+    utils_strbuf_append_cstr(buf, ": ");
+    utils_strbuf_append_cstr(buf, type_table_to_string(ast->types, type->return_type));
+    utils_strbuf_append_cstr(buf, " {");
+
+    _parser_print_push(stack, PRINT_TEXT, " }", 0);
+    for(uint32_t idx = routine->num_stmts; idx > 0; idx--) {
+        _parser_print_push(stack, PRINT_STMT, NULL, routine->first_stmt + idx - 1);
+        _parser_print_push(stack, PRINT_TEXT, " ", 0);
+    }
+}
+
+// Writes a statement, or the part of it before its expression which is pushed to the stack
+void _parser_print_stmt(utils_strbuf_t* buf, _parser_print_vec_t* stack, ast_global_scope_t* ast, const ast_stmt_t* stmt) {
+    _parser_print_push(stack, PRINT_TEXT, ";", 0);
+
+    switch(stmt->kind) {
+        case AST_STMT_DECL: {
+            const ast_decl_t* decl = &UTILS_VEC_AT(&(ast->locals), stmt->value);
+
+            utils_strbuf_append_cstr(buf, decl->is_const ? "const " : "decl ");
+            utils_strbuf_append_cstr(buf, AST_DECL_SYMBOL(ast, decl));
+
+            if(decl->type != TYPE_ID_NONE) {
+                utils_strbuf_append_cstr(buf, ": ");
+                utils_strbuf_append_cstr(buf, type_table_to_string(ast->types, AST_TYPE_GET(ast, decl->type)));
+            }
+
+            if(decl->value != AST_EXPR_NONE) {
+                utils_strbuf_append_cstr(buf, " = ");
+                _parser_print_push(stack, PRINT_EXPR, NULL, decl->value);
+            }
+            break;
+        }
+
+        case AST_STMT_RETURN: {
+            utils_strbuf_append_cstr(buf, "return");
+
+            if(stmt->value != AST_EXPR_NONE) {
+                utils_strbuf_append_char(buf, ' ');
+                _parser_print_push(stack, PRINT_EXPR, NULL, stmt->value);
+            }
+            break;
+        }
+
+        default: {
+            _parser_print_push(stack, PRINT_EXPR, NULL, stmt->value);
+            break;
+        }
+    }
+}
+
+// Writes a node, or the part of it before its operands which are pushed to the stack (in reverse order)
+void _parser_print_expr(utils_strbuf_t* buf, _parser_print_vec_t* stack, ast_global_scope_t* ast, const ast_expr_t* expr) {
+    const char* op = ast_expr_op_string((ast_expr_op_t) expr->op);
+
+    switch(expr->kind) {
+        case AST_EXPR_INTEGER: {
+            char num[24];
+            snprintf(num, sizeof(num), "%" PRIu64, ((uint64_t) expr->right << 32) | expr->left);
+            utils_strbuf_append_cstr(buf, num);
+            break;
+        }
+
+        case AST_EXPR_STRING:
+        case AST_EXPR_CHAR: {
+            utils_strbuf_append(buf, UTILS_STRBUF_DATA(&(ast->literals)) + expr->left, expr->right);
+            break;
+        }
+
+        case AST_EXPR_SYMBOL: {
+            utils_strbuf_append_cstr(buf, UTILS_INTERN_GET(ast->names, expr->left));
+            break;
+        }
+
+        // Prefix operators are written as (-x), postfix ones as (x$)
+        case AST_EXPR_UNARY: {
+            utils_strbuf_append_char(buf, '(');
+            _parser_print_push(stack, PRINT_TEXT, ")", 0);
+
+            if(expr->op == AST_EXPR_OP_DEREF || expr->op == AST_EXPR_OP_ADDR) {
+                _parser_print_push(stack, PRINT_TEXT, op, 0);
+                _parser_print_push(stack, PRINT_EXPR, NULL, expr->left);
+            } else {
+                utils_strbuf_append_cstr(buf, op);
+                _parser_print_push(stack, PRINT_EXPR, NULL, expr->left);
+            }
+            break;
+        }
+
+        case AST_EXPR_BINARY: {
+            utils_strbuf_append_char(buf, '(');
+            _parser_print_push(stack, PRINT_TEXT, ")", 0);
+            _parser_print_push(stack, PRINT_EXPR, NULL, expr->right);
+            _parser_print_push(stack, PRINT_TEXT, " ", 0);
+            _parser_print_push(stack, PRINT_TEXT, op, 0);
+            _parser_print_push(stack, PRINT_TEXT, " ", 0);
+            _parser_print_push(stack, PRINT_EXPR, NULL, expr->left);
+            break;
+        }
+
+        case AST_EXPR_CALL: {
+            uint32_t num_args = UTILS_VEC_AT(&(ast->expr_args), expr->right);
+
+            _parser_print_push(stack, PRINT_TEXT, ")", 0);
+            for(uint32_t idx = num_args; idx > 0; idx--) {
+                _parser_print_push(stack, PRINT_EXPR, NULL, UTILS_VEC_AT(&(ast->expr_args), expr->right + idx));
+                if(idx != 1) _parser_print_push(stack, PRINT_TEXT, ", ", 0);
+            }
+            _parser_print_push(stack, PRINT_TEXT, "(", 0);
+            _parser_print_push(stack, PRINT_EXPR, NULL, expr->left);
+            break;
+        }
+
+        case AST_EXPR_MEMBER: {
+            _parser_print_push(stack, PRINT_TEXT, UTILS_INTERN_GET(ast->names, expr->right), 0);
+            _parser_print_push(stack, PRINT_TEXT, ".", 0);
+            _parser_print_push(stack, PRINT_EXPR, NULL, expr->left);
+            break;
+        }
+
+        default: {
+            _parser_print_routine(buf, stack, ast, &UTILS_VEC_AT(&(ast->routines), expr->left));
+            break;
+        }
+    }
+}
+
+// Appends the expression to the buffer, with every operation in parentheses
+void _parser_write_expr(utils_strbuf_t* buf, _parser_print_vec_t* stack, ast_global_scope_t* ast, ast_expr_id_t id) {
+    _parser_print_push(stack, PRINT_EXPR, NULL, id);
+
+    while(UTILS_VEC_LENGTH(stack) != 0) {
+        struct _parser_print_item_t item = _parser_print_vec_pop(stack);
+
+        if(item.kind == PRINT_TEXT) {
+            utils_strbuf_append_cstr(buf, item.text);
+        } else if(item.kind == PRINT_EXPR) {
+            _parser_print_expr(buf, stack, ast, AST_EXPR_GET(ast, item.index));
+        } else {
+            _parser_print_stmt(buf, stack, ast, &UTILS_VEC_AT(&(ast->stmts), item.index));
+        }
+    }
+}
 
 void parser_write_output(FILE* outfile, ast_global_scope_t* ast) {
     fprintf(outfile, "Global {");
 
-    for(size_t idx = 0; idx < UTILS_LIST_GENERIC_LENGTH(ast->decls); idx++) {
-        ast_decl_t* decl = UTILS_LIST_GENERIC_GET(ast->decls, idx);
+    utils_strbuf_t value;
+    utils_strbuf_init(&value);
 
-        char* type_str = decl->type != NULL ? type_to_string(decl->type) : "(to infer)";
+    _parser_print_vec_t stack;
+    _parser_print_vec_init(&stack);
 
-        fprintf(outfile, "\n\tDeclaration {\n\t\tsymbol - %s\n\t\tis const - %d\n\t\ttype - %s\n\t\tline - %zu\n\t\tchar - %zu\n\t}",
-            decl->symbol, decl->is_const, type_str, decl->line_ref, decl->char_ref
+    for(size_t idx = 0; idx < UTILS_VEC_LENGTH(&(ast->decls)); idx++) {
+        ast_decl_t* decl = &UTILS_VEC_AT(&(ast->decls), idx);
+
+        // Strings of types are cached in the table, each distinct type is rendered once
+        const char* type_str = decl->type != TYPE_ID_NONE ? type_table_to_string(ast->types, AST_TYPE_GET(ast, decl->type)) : "(to infer)";
+
+        fprintf(outfile, "\n\tDeclaration {\n\t\tsymbol - %s\n\t\tis const - %d\n\t\ttype - %s",
+            AST_DECL_SYMBOL(ast, decl), (int) decl->is_const, type_str
         );
 
-        if(decl->type != NULL) free(type_str);
+        // Declarations without a value print the same as before values were parsed
+        if(decl->value != AST_EXPR_NONE) {
+            utils_strbuf_clear(&value);
+            _parser_write_expr(&value, &stack, ast, decl->value);
+
+            fprintf(outfile, "%s", "\n\t\tvalue - ");
+            utils_strbuf_flush(&value, outfile);
+        }
+
+        fprintf(outfile, "\n\t\tline - %u\n\t\tchar - %u\n\t}", decl->line_ref, decl->char_ref);
     };
 
+    _parser_print_vec_deinit(&stack);
+    utils_strbuf_deinit(&value);
+
     fprintf(outfile, "\n}\n");
 }
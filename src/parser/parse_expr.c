@@ -0,0 +1,631 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// parse_expr - Parsing of expressions, and of the routine literals inside of them
+
+// Expressions are parsed with precedence climbing, but instead of recursing for every operand
+// the pending operators and operands are kept on two explicit stacks (shunting yard). Long chains
+// like a$@$@$@... or deeply nested parentheses therefore take linear time and constant C stack.
+// Only the bodies of routine literals are parsed recursively, and those are limited to PARSER_MAX_NESTING.
+
+#include "parse_expr.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "lexer/token_list.h"
+#include "lexer/token_types.h"
+#include "types/types.h"
+#include "types/type_list.h"
+#include "types/type_table.h"
+#include "ast/ast.h"
+#include "utils/intern.h"
+#include "utils/strbuf.h"
+#include "utils/vec.h"
+#include "utils/diag.h"
+
+#include "parse_types.h"
+
+// Binding power of the operators, higher binds tighter
+// Postfix operators, calls and members are applied straight away, they bind tighter than all of these
+#define PREC_ASSIGN 1
+#define PREC_LOG_OR 2
+#define PREC_LOG_AND 3
+#define PREC_BIT_OR 4
+#define PREC_BIT_XOR 5
+#define PREC_BIT_AND 6
+#define PREC_EQUALITY 7
+#define PREC_RELATION 8
+#define PREC_ADDITIVE 9
+#define PREC_MULTIPLICATIVE 10
+#define PREC_PREFIX 11
+#define PREC_INDEX 12
+
+enum _parser_frame_kind_t {
+    FRAME_UNARY = 0,    // Prefix operator waiting for its operand
+    FRAME_BINARY,       // Binary operator waiting for its right operand
+    FRAME_PAREN,        // Open parenthesis
+    FRAME_CALL,         // Open argument list of a call
+};
+
+// Entry of the stack of pending operators
+struct _parser_frame_t {
+    uint8_t kind;
+    uint8_t op;             // ast_expr_op_t of operators
+    uint8_t precedence;
+    uint32_t line_ref;
+    uint32_t char_ref;
+    uint32_t num_operands;  // Size of the operand stack when a parenthesis or a call was opened
+};
+
+// Typical expressions fit in the inline storage, so parsing them does not allocate
+UTILS_VEC_MAKE_SMALL_DECLARATION(_parser_frame, struct _parser_frame_t, 16)
+UTILS_VEC_MAKE_SMALL_IMPLEMENTATION(_parser_frame, struct _parser_frame_t, 64)
+UTILS_VEC_MAKE_SMALL_DECLARATION(_parser_operand, ast_expr_id_t, 16)
+UTILS_VEC_MAKE_SMALL_IMPLEMENTATION(_parser_operand, ast_expr_id_t, 64)
+UTILS_VEC_MAKE_SMALL_DECLARATION(_parser_stmt, ast_stmt_t, 8)
+UTILS_VEC_MAKE_SMALL_IMPLEMENTATION(_parser_stmt, ast_stmt_t, 32)
+
+// Returns 1 and fills op and precedence if the token is a binary operator, 0 otherwise
+// '@' is handled on its own, since it's also a postfix operator
+int _parser_binary_op(lexer_token_type_t type, ast_expr_op_t* op, int* precedence) {
+    switch(type) {
+        case TOKEN_EQUAL: *op = AST_EXPR_OP_ASSIGN; *precedence = PREC_ASSIGN; return 1;
+        case TOKEN_DOUBLE_PIPE: *op = AST_EXPR_OP_LOG_OR; *precedence = PREC_LOG_OR; return 1;
+        case TOKEN_DOUBLE_AMPERSAND: *op = AST_EXPR_OP_LOG_AND; *precedence = PREC_LOG_AND; return 1;
+        case TOKEN_PIPE: *op = AST_EXPR_OP_BIT_OR; *precedence = PREC_BIT_OR; return 1;
+        case TOKEN_UP_ARROW: *op = AST_EXPR_OP_BIT_XOR; *precedence = PREC_BIT_XOR; return 1;
+        case TOKEN_AMPERSAND: *op = AST_EXPR_OP_BIT_AND; *precedence = PREC_BIT_AND; return 1;
+        case TOKEN_DOUBLE_EQUAL: *op = AST_EXPR_OP_EQ; *precedence = PREC_EQUALITY; return 1;
+        case TOKEN_TWO_TRIANGLES: *op = AST_EXPR_OP_NOT_EQ; *precedence = PREC_EQUALITY; return 1;
+        case TOKEN_TRIANGLE_LEFT: *op = AST_EXPR_OP_LT; *precedence = PREC_RELATION; return 1;
+        case TOKEN_TRIANGLE_RIGHT: *op = AST_EXPR_OP_GT; *precedence = PREC_RELATION; return 1;
+        case TOKEN_TRIANGLE_EQUAL_LEFT: *op = AST_EXPR_OP_LT_EQ; *precedence = PREC_RELATION; return 1;
+        case TOKEN_TRIANGLE_EQUAL_RIGHT: *op = AST_EXPR_OP_GT_EQ; *precedence = PREC_RELATION; return 1;
+        case TOKEN_PLUS: *op = AST_EXPR_OP_ADD; *precedence = PREC_ADDITIVE; return 1;
+        case TOKEN_MINUS: *op = AST_EXPR_OP_SUB; *precedence = PREC_ADDITIVE; return 1;
+        case TOKEN_ASTERISK: *op = AST_EXPR_OP_MUL; *precedence = PREC_MULTIPLICATIVE; return 1;
+        case TOKEN_SLASH: *op = AST_EXPR_OP_DIV; *precedence = PREC_MULTIPLICATIVE; return 1;
+        default: return 0;
+    }
+}
+
+// Returns 1 if the token may begin an operand without any prefix operator, 0 otherwise
+int _parser_starts_primary(const lexer_token_t* token) {
+    return token != NULL && (TOKEN_TYPE_IS_DYNAMIC(token->type) || token->type == TOKEN_PAREN);
+}
+
+// Node at the position of the token
+ast_expr_t _parser_node(ast_expr_kind_t kind, size_t line_ref, size_t char_ref) {
+    ast_expr_t node = {
+        .kind = (uint8_t) kind,
+        .op = 0,
+        .reserved = 0,
+        .line_ref = (uint32_t) line_ref,
+        .char_ref = (uint32_t) char_ref,
+        .left = 0,
+        .right = 0,
+    };
+
+    return node;
+}
+
+// Pops the operator on top of the stack and replaces its operands with the node of the operation
+void _parser_reduce(ast_global_scope_t* ast, _parser_frame_vec_t* frames, _parser_operand_vec_t* operands) {
+    struct _parser_frame_t frame = _parser_frame_vec_pop(frames);
+
+    ast_expr_t node = _parser_node(frame.kind == FRAME_UNARY ? AST_EXPR_UNARY : AST_EXPR_BINARY, frame.line_ref, frame.char_ref);
+    node.op = frame.op;
+
+    if(frame.kind == FRAME_BINARY) {
+        node.right = _parser_operand_vec_pop(operands);
+    }
+    node.left = _parser_operand_vec_pop(operands);
+
+    _parser_operand_vec_push(operands, ast_add_expr(ast, node));
+}
+
+// Reduces the operators on top of the stack which bind at least as tight as precedence
+// (or tighter only, for right associative operators)
+void _parser_reduce_while(ast_global_scope_t* ast, _parser_frame_vec_t* frames, _parser_operand_vec_t* operands, int precedence, int right_assoc) {
+    while(UTILS_VEC_LENGTH(frames) != 0) {
+        const struct _parser_frame_t* top = &UTILS_VEC_AT(frames, UTILS_VEC_LENGTH(frames) - 1);
+
+        if(top->kind != FRAME_UNARY && top->kind != FRAME_BINARY) break;
+        if(top->precedence < precedence || (top->precedence == precedence && right_assoc)) break;
+
+        _parser_reduce(ast, frames, operands);
+    }
+}
+
+// Replaces the operand on top of the stack with a unary operation on it
+void _parser_apply_postfix(ast_global_scope_t* ast, _parser_operand_vec_t* operands, ast_expr_op_t op, size_t line_ref, size_t char_ref) {
+    ast_expr_t node = _parser_node(AST_EXPR_UNARY, line_ref, char_ref);
+    node.op = (uint8_t) op;
+    node.left = _parser_operand_vec_pop(operands);
+
+    _parser_operand_vec_push(operands, ast_add_expr(ast, node));
+}
+
+// Closes the call on top of the stack, its callee and args are replaced with the node of the call
+void _parser_close_call(ast_global_scope_t* ast, _parser_frame_vec_t* frames, _parser_operand_vec_t* operands) {
+    struct _parser_frame_t frame = _parser_frame_vec_pop(frames);
+
+    uint32_t num_args = (uint32_t) UTILS_VEC_LENGTH(operands) - frame.num_operands;
+    const ast_expr_id_t* args = &UTILS_VEC_AT(operands, frame.num_operands);
+
+    // Args of nested calls were closed before, so every list is in one piece
+    ast_expr_t node = _parser_node(AST_EXPR_CALL, frame.line_ref, frame.char_ref);
+    node.left = UTILS_VEC_AT(operands, frame.num_operands - 1);
+    node.right = (uint32_t) UTILS_VEC_LENGTH(&(ast->expr_args));
+
+    ast_index_vec_push(&(ast->expr_args), num_args);
+    ast_index_vec_append(&(ast->expr_args), args, num_args);
+
+    _parser_operand_vec_truncate(operands, frame.num_operands - 1);
+    _parser_operand_vec_push(operands, ast_add_expr(ast, node));
+}
+
+ast_expr_id_t _parser_parse_routine(lexer_token_iterator_t* iter, ast_global_scope_t* ast, size_t depth);
+
+// Makes the node of a literal, a symbol or a routine literal starting at the token, which is not consumed yet
+// Returns AST_EXPR_NONE if error
+ast_expr_id_t _parser_parse_primary(lexer_token_iterator_t* iter, ast_global_scope_t* ast, size_t depth) {
+    lexer_token_t* token = lexer_token_iter_peek(iter);
+
+    if(token->type == TOKEN_RT) {
+        return _parser_parse_routine(iter, ast, depth + 1);
+    }
+
+    token = lexer_token_iter_next(iter);
+    ast_expr_t node = _parser_node(AST_EXPR_INTEGER, token->line_ref, token->char_ref);
+
+    switch(token->type) {
+        case TOKEN_LITERAL_NUMERIC_BIN:
+        case TOKEN_LITERAL_NUMERIC_OCT:
+        case TOKEN_LITERAL_NUMERIC_DEC:
+        case TOKEN_LITERAL_NUMERIC_HEX: {
+            node.left = (uint32_t) token->value;
+            node.right = (uint32_t) (token->value >> 32);
+            break;
+        }
+
+        // The text is kept as it is in the source, escapes and all
+        case TOKEN_LITERAL_STRING:
+        case TOKEN_LITERAL_CHAR: {
+            node.kind = token->type == TOKEN_LITERAL_STRING ? AST_EXPR_STRING : AST_EXPR_CHAR;
+            node.left = (uint32_t) UTILS_STRBUF_LENGTH(&(ast->literals));
+            node.right = (uint32_t) token->length;
+
+            utils_strbuf_append(&(ast->literals), token->contents, token->length);
+            break;
+        }
+
+        case TOKEN_IDENTIFIER: {
+            if(token->id == UTILS_INTERN_NONE) {
+                fprintf(UTILS_DIAG, "[parser] Error in line %zu char %zu: Identifier was not interned.\n", token->line_ref, token->char_ref);
+                return AST_EXPR_NONE;
+            }
+
+            node.kind = AST_EXPR_SYMBOL;
+            node.left = token->id;
+            break;
+        }
+
+        default: {
+            fprintf(UTILS_DIAG, "[parser] Error in line %zu char %zu: Expected an expression.\n", token->line_ref, token->char_ref);
+            return AST_EXPR_NONE;
+        }
+    }
+
+    return ast_add_expr(ast, node);
+}
+
+ast_expr_id_t parser_parse_expression(lexer_token_iterator_t* iter, ast_global_scope_t* ast, size_t depth) {
+    _parser_frame_vec_t frames;
+    _parser_operand_vec_t operands;
+    _parser_frame_vec_init(&frames);
+    _parser_operand_vec_init(&operands);
+
+    int expect_operand = 1;
+    int failed = 0;
+
+    while(!failed) {
+        lexer_token_t* token = lexer_token_iter_peek(iter);
+
+        // The end of the source ends a complete expression, the caller decides whether it should have
+        if(token == NULL) {
+            if(!expect_operand) {
+                _parser_reduce_while(ast, &frames, &operands, 0, 0);
+            }
+
+            if(expect_operand || UTILS_VEC_LENGTH(&frames) != 0) {
+                fprintf(UTILS_DIAG, "%s", "[parser] Error in expression: Unexpected end of file.\n");
+                failed = 1;
+            }
+            break;
+        }
+
+        struct _parser_frame_t frame = {
+            .kind = FRAME_UNARY,
+            .op = 0,
+            .precedence = PREC_PREFIX,
+            .line_ref = (uint32_t) token->line_ref,
+            .char_ref = (uint32_t) token->char_ref,
+            .num_operands = (uint32_t) UTILS_VEC_LENGTH(&operands),
+        };
+
+        size_t num_frames = UTILS_VEC_LENGTH(&frames);
+        const struct _parser_frame_t* top = num_frames != 0 ? &UTILS_VEC_AT(&frames, num_frames - 1) : NULL;
+
+        if(expect_operand) {
+            switch(token->type) {
+                // Prefix operators
+                case TOKEN_MINUS:
+                case TOKEN_TILDE:
+                case TOKEN_EXCLAMATION: {
+                    frame.op = token->type == TOKEN_MINUS ? AST_EXPR_OP_NEG : (token->type == TOKEN_TILDE ? AST_EXPR_OP_BIT_NOT : AST_EXPR_OP_LOG_NOT);
+                    lexer_token_iter_next(iter);
+                    _parser_frame_vec_push(&frames, frame);
+                    break;
+                }
+
+                case TOKEN_PAREN: {
+                    frame.kind = FRAME_PAREN;
+                    lexer_token_iter_next(iter);
+                    _parser_frame_vec_push(&frames, frame);
+                    break;
+                }
+
+                // A call without args, like f()
+                case TOKEN_END_PAREN: {
+                    if(top == NULL || top->kind != FRAME_CALL || top->num_operands != UTILS_VEC_LENGTH(&operands)) {
+                        fprintf(UTILS_DIAG, "[parser] Error in line %zu char %zu: Expected an expression.\n", token->line_ref, token->char_ref);
+                        failed = 1;
+                        break;
+                    }
+
+                    lexer_token_iter_next(iter);
+                    _parser_close_call(ast, &frames, &operands);
+                    expect_operand = 0;
+                    break;
+                }
+
+                default: {
+                    ast_expr_id_t operand = _parser_parse_primary(iter, ast, depth);
+                    if(operand == AST_EXPR_NONE) {
+                        failed = 1;
+                        break;
+                    }
+
+                    _parser_operand_vec_push(&operands, operand);
+                    expect_operand = 0;
+                    break;
+                }
+            }
+
+            continue;
+        }
+
+        // Postfix operators apply to the operand on top, which has to be complete, so an index before them is reduced first
+        if(token->type == TOKEN_DOLLAR || token->type == TOKEN_DOT || token->type == TOKEN_PAREN || token->type == TOKEN_AT) {
+            _parser_reduce_while(ast, &frames, &operands, PREC_INDEX, 0);
+        }
+
+        ast_expr_op_t op = AST_EXPR_OP_ADD;
+        int precedence = 0;
+
+        if(token->type == TOKEN_DOLLAR) {
+            lexer_token_iter_next(iter);
+            _parser_apply_postfix(ast, &operands, AST_EXPR_OP_ADDR, frame.line_ref, frame.char_ref);
+        } else if(token->type == TOKEN_AT) {
+            // Followed by an operand it's an index, like argv@1, otherwise a dereference, like ptr@
+            lexer_token_iter_next(iter);
+
+            if(_parser_starts_primary(lexer_token_iter_peek(iter))) {
+                frame.kind = FRAME_BINARY;
+                frame.op = AST_EXPR_OP_INDEX;
+                frame.precedence = PREC_INDEX;
+                _parser_frame_vec_push(&frames, frame);
+                expect_operand = 1;
+            } else {
+                _parser_apply_postfix(ast, &operands, AST_EXPR_OP_DEREF, frame.line_ref, frame.char_ref);
+            }
+        } else if(token->type == TOKEN_DOT) {
+            lexer_token_iter_next(iter);
+            token = lexer_token_iter_next(iter);
+
+            if(token == NULL || token->type != TOKEN_IDENTIFIER || token->id == UTILS_INTERN_NONE) {
+                fprintf(UTILS_DIAG, "[parser] Error in line %u char %u: Expected a member name after '.'.\n", frame.line_ref, frame.char_ref);
+                failed = 1;
+                break;
+            }
+
+            ast_expr_t node = _parser_node(AST_EXPR_MEMBER, frame.line_ref, frame.char_ref);
+            node.left = _parser_operand_vec_pop(&operands);
+            node.right = token->id;
+            _parser_operand_vec_push(&operands, ast_add_expr(ast, node));
+        } else if(token->type == TOKEN_PAREN) {
+            // The callee stays on the operand stack, below the args
+            frame.kind = FRAME_CALL;
+            lexer_token_iter_next(iter);
+            _parser_frame_vec_push(&frames, frame);
+            expect_operand = 1;
+        } else if(_parser_binary_op(token->type, &op, &precedence)) {
+            int right_assoc = op == AST_EXPR_OP_ASSIGN;
+            _parser_reduce_while(ast, &frames, &operands, precedence, right_assoc);
+
+            frame.kind = FRAME_BINARY;
+            frame.op = (uint8_t) op;
+            frame.precedence = (uint8_t) precedence;
+
+            lexer_token_iter_next(iter);
+            _parser_frame_vec_push(&frames, frame);
+            expect_operand = 1;
+        } else {
+            // Anything else closes a parenthesis or a call, or ends the expression
+            _parser_reduce_while(ast, &frames, &operands, 0, 0);
+
+            num_frames = UTILS_VEC_LENGTH(&frames);
+            top = num_frames != 0 ? &UTILS_VEC_AT(&frames, num_frames - 1) : NULL;
+
+            if(top != NULL && token->type == TOKEN_END_PAREN) {
+                lexer_token_iter_next(iter);
+
+                if(top->kind == FRAME_PAREN) {
+                    _parser_frame_vec_pop(&frames);
+                } else {
+                    _parser_close_call(ast, &frames, &operands);
+                }
+            } else if(top != NULL && top->kind == FRAME_CALL && token->type == TOKEN_COMMA) {
+                lexer_token_iter_next(iter);
+                expect_operand = 1;
+            } else if(top != NULL) {
+                fprintf(UTILS_DIAG, "[parser] Error in line %u char %u: Expected ')' to close the '(' from line %u char %u.\n",
+                    frame.line_ref, frame.char_ref, top->line_ref, top->char_ref
+                );
+                failed = 1;
+            } else {
+                break;
+            }
+        }
+    }
+
+    ast_expr_id_t result = AST_EXPR_NONE;
+    if(!failed) {
+        result = _parser_operand_vec_pop(&operands);
+    }
+
+    _parser_frame_vec_deinit(&frames);
+    _parser_operand_vec_deinit(&operands);
+
+    return result;
+}
+
+// Parses the params of a routine literal from the token after '[' up to and with ']'
+// Params are added to the locals of the AST, their types pushed into types
+// line_ref and char_ref are the position of the '[', for errors at the end of file
+// Return value: 0 if ok, 1 if error
+int _parser_parse_params(lexer_token_iterator_t* iter, ast_global_scope_t* ast, type_info_ptr_vec_t* types, size_t line_ref, size_t char_ref) {
+    lexer_token_t* token = lexer_token_iter_peek(iter);
+
+    // Empty list
+    if(token != NULL && token->type == TOKEN_END_SQUARE) {
+        lexer_token_iter_next(iter);
+        return 0;
+    }
+
+    while(1) {
+        token = lexer_token_iter_next(iter);
+        if(token == NULL || token->type != TOKEN_IDENTIFIER || token->id == UTILS_INTERN_NONE) {
+            if(token != NULL) {
+                fprintf(UTILS_DIAG, "[parser] Error in line %zu char %zu: Expected param name.\n", token->line_ref, token->char_ref);
+            } else {
+                fprintf(UTILS_DIAG, "[parser] Error in params in line %zu char %zu: Unexpected end of file, expected param name.\n", line_ref, char_ref);
+            }
+            return 1;
+        }
+
+        ast_decl_t param = {
+            .line_ref = (uint32_t) token->line_ref,
+            .char_ref = (uint32_t) token->char_ref,
+            .is_const = 0,
+            .type = TYPE_ID_NONE,
+            .symbol = token->id,
+            .value = AST_EXPR_NONE,
+        };
+
+        token = lexer_token_iter_next(iter);
+        if(token == NULL || token->type != TOKEN_COLON) {
+            fprintf(UTILS_DIAG, "[parser] Error in line %u char %u: Expected ':' after param name.\n", param.line_ref, param.char_ref);
+            return 1;
+        }
+
+        if(!lexer_token_iter_isnt_empty(iter)) {
+            fprintf(UTILS_DIAG, "[parser] Error in param in line %u char %u: Unexpected end of file, expected type of param.\n", param.line_ref, param.char_ref);
+            return 1;
+        }
+
+        type_info_t* type = parser_parse_type(iter, ast->types);
+        if(type == NULL) {
+            fprintf(UTILS_DIAG, "[parser] Error in line %u char %u: Cannot parse type of param.\n", param.line_ref, param.char_ref);
+            return 1;
+        }
+
+        param.type = type->id;
+        ast_decl_vec_push(&(ast->locals), param);
+        type_info_ptr_vec_push(types, type);
+
+        token = lexer_token_iter_next(iter);
+        if(token == NULL) {
+            fprintf(UTILS_DIAG, "[parser] Error in param in line %u char %u: Unexpected end of file, expected ',' or ']'.\n", param.line_ref, param.char_ref);
+            return 1;
+        }
+        if(token->type == TOKEN_END_SQUARE) return 0;
+
+        if(token->type != TOKEN_COMMA) {
+            fprintf(UTILS_DIAG, "[parser] Error in line %zu char %zu: Unexpected token, expected comma\n", token->line_ref, token->char_ref);
+            return 1;
+        }
+    }
+}
+
+// Parses a statement of the body of a routine into stmt
+// Return value: 0 if ok, 1 if error
+int _parser_parse_statement(lexer_token_iterator_t* iter, ast_global_scope_t* ast, ast_stmt_t* stmt, size_t depth) {
+    lexer_token_t* token = lexer_token_iter_peek(iter);
+
+    stmt->line_ref = (uint32_t) token->line_ref;
+    stmt->char_ref = (uint32_t) token->char_ref;
+    stmt->value = AST_EXPR_NONE;
+
+    // Declarations end with a semicolon on their own
+    if(token->type == TOKEN_DECL || token->type == TOKEN_CONST) {
+        ast_decl_t decl;
+        if(parser_parse_declaration(iter, ast, &decl, depth) != 0) return 1;
+
+        stmt->kind = AST_STMT_DECL;
+        stmt->value = (uint32_t) UTILS_VEC_LENGTH(&(ast->locals));
+        ast_decl_vec_push(&(ast->locals), decl);
+
+        return 0;
+    }
+
+    if(token->type == TOKEN_RETURN) {
+        stmt->kind = AST_STMT_RETURN;
+        lexer_token_iter_next(iter);
+
+        token = lexer_token_iter_peek(iter);
+        if(token != NULL && token->type != TOKEN_SEMICOLON) {
+            stmt->value = parser_parse_expression(iter, ast, depth);
+            if(stmt->value == AST_EXPR_NONE) return 1;
+        }
+    } else {
+        stmt->kind = AST_STMT_EXPR;
+        stmt->value = parser_parse_expression(iter, ast, depth);
+        if(stmt->value == AST_EXPR_NONE) return 1;
+    }
+
+    token = lexer_token_iter_next(iter);
+    if(token == NULL || token->type != TOKEN_SEMICOLON) {
+        fprintf(UTILS_DIAG, "[parser] Error in statement in line %u char %u: Expected ';'.\n", stmt->line_ref, stmt->char_ref);
+        return 1;
+    }
+
+    return 0;
+}
+
+// Parses a routine literal, like rt [ x: u32 ]: u32 { return x * x; }, starting from 'rt'
+// Returns the id of its node or AST_EXPR_NONE if error
+ast_expr_id_t _parser_parse_routine(lexer_token_iterator_t* iter, ast_global_scope_t* ast, size_t depth) {
+    lexer_token_t* token = lexer_token_iter_next(iter);
+
+    ast_routine_t routine = {
+        .line_ref = (uint32_t) token->line_ref,
+        .char_ref = (uint32_t) token->char_ref,
+        .type = TYPE_ID_NONE,
+        .first_param = (uint32_t) UTILS_VEC_LENGTH(&(ast->locals)),
+        .num_params = 0,
+        .first_stmt = 0,
+        .num_stmts = 0,
+        .reserved = 0,
+    };
+
+    if(depth > PARSER_MAX_NESTING) {
+        fprintf(UTILS_DIAG, "[parser] Error in line %u char %u: Routines are nested too deeply.\n", routine.line_ref, routine.char_ref);
+        return AST_EXPR_NONE;
+    }
+
+    type_info_ptr_vec_t param_types;
+    type_info_ptr_vec_init(&param_types);
+
+    _parser_stmt_vec_t stmts;
+    _parser_stmt_vec_init(&stmts);
+
+    int failed = 0;
+    int has_params = 0;
+
+    // Params are optional, same as in routine types
+    token = lexer_token_iter_next(iter);
+    if(token != NULL && token->type == TOKEN_SQUARE) {
+        has_params = 1;
+        failed = _parser_parse_params(iter, ast, &param_types, token->line_ref, token->char_ref);
+        token = failed ? NULL : lexer_token_iter_next(iter);
+    }
+
+    if(!failed && (token == NULL || token->type != TOKEN_COLON)) {
+        fprintf(UTILS_DIAG, "[parser] Error in routine in line %u char %u: Expected ':' before the return type.\n", routine.line_ref, routine.char_ref);
+        failed = 1;
+    }
+
+    type_info_t* return_type = NULL;
+    if(!failed && lexer_token_iter_isnt_empty(iter)) {
+        return_type = parser_parse_type(iter, ast->types);
+    }
+
+    if(!failed && return_type == NULL) {
+        fprintf(UTILS_DIAG, "[parser] Error in routine in line %u char %u: Cannot parse return type.\n", routine.line_ref, routine.char_ref);
+        failed = 1;
+    }
+
+    token = failed ? NULL : lexer_token_iter_next(iter);
+    if(!failed && (token == NULL || token->type != TOKEN_BRACKET)) {
+        fprintf(UTILS_DIAG, "[parser] Error in routine in line %u char %u: Expected '{' before the body.\n", routine.line_ref, routine.char_ref);
+        failed = 1;
+    }
+
+    // Statements are collected here first, the ones of the routines nested in them are added to the AST before
+    while(!failed) {
+        token = lexer_token_iter_peek(iter);
+
+        if(token == NULL) {
+            fprintf(UTILS_DIAG, "[parser] Error in routine in line %u char %u: Unexpected end of file.\n", routine.line_ref, routine.char_ref);
+            failed = 1;
+        } else if(token->type == TOKEN_END_BRACKET) {
+            lexer_token_iter_next(iter);
+            break;
+        } else {
+            ast_stmt_t stmt;
+            failed = _parser_parse_statement(iter, ast, &stmt, depth);
+            if(!failed) _parser_stmt_vec_push(&stmts, stmt);
+        }
+    }
+
+    ast_expr_id_t id = AST_EXPR_NONE;
+
+    if(!failed) {
+        routine.type = type_make_routine(ast->types, has_params ? &param_types : NULL, return_type)->id;
+        routine.first_stmt = (uint32_t) UTILS_VEC_LENGTH(&(ast->stmts));
+        routine.num_stmts = (uint32_t) UTILS_VEC_LENGTH(&stmts);
+
+        // Params are the locals from first_param on, the declarations of the body come after them
+        routine.num_params = (uint32_t) UTILS_VEC_LENGTH(&param_types);
+
+        ast_stmt_vec_append(&(ast->stmts), stmts.arr, UTILS_VEC_LENGTH(&stmts));
+
+        ast_expr_t node = _parser_node(AST_EXPR_ROUTINE, routine.line_ref, routine.char_ref);
+        node.left = (uint32_t) UTILS_VEC_LENGTH(&(ast->routines));
+        ast_routine_vec_push(&(ast->routines), routine);
+
+        id = ast_add_expr(ast, node);
+    }
+
+    _parser_stmt_vec_deinit(&stmts);
+    type_info_ptr_vec_deinit(&param_types);
+
+    return id;
+}
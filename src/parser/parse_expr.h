@@ -0,0 +1,39 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// parse_expr - Parsing of expressions, and of the routine literals inside of them
+
+#ifndef _I_PARSER_PARSE_EXPR_H_
+#define _I_PARSER_PARSE_EXPR_H_
+
+#include <stddef.h>
+
+#include "ast/ast.h"
+#include "lexer/token_list.h"
+
+// Deepest nesting of routine literals, their bodies are the only part of an expression parsed recursively
+#define PARSER_MAX_NESTING 256
+
+// Assumes iterator points to the first token of an expression
+// Consumes the tokens of the expression, up to (without) the first token which cannot continue it, like ';'
+// Returns the id of the root node, or AST_EXPR_NONE if error (reported into UTILS_DIAG)
+// Nested routine literals are parsed at depth + 1
+ast_expr_id_t parser_parse_expression(lexer_token_iterator_t* iter, ast_global_scope_t* ast, size_t depth);
+
+// Defined in parser.c, declarations inside of routines are parsed the same way as the global ones
+int parser_parse_declaration(lexer_token_iterator_t* iter, ast_global_scope_t* ast, ast_decl_t* new_decl, size_t depth);
+
+#endif
@@ -15,9 +15,9 @@
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 // parse_types - Parsing of type decalrations
-// Assumes iterator points to the first token of a type
-// Consumes tokens until type is fully described
-// Returns NULL if error, or new declaration if ok
+// Types are added to the table, so on errors the parts parsed so far are just left there
+// Parsing does not recurse: every '>' and 'rt' still waiting for the types inside of it is a frame
+// on an explicit stack, finished arg types wait on a second stack until their routine is done
 
 #include "parse_types.h"
 
@@ -29,157 +29,171 @@
 #include "lexer/token_types.h"
 #include "types/types.h"
 #include "types/type_list.h"
-#include "ast/ast.h"
-
-// Parse the [] portion of a routine type, starting from the first
-// token after '['
-type_info_list_t* parser_parse_routine_type_args(lexer_token_iterator_t* iter) {
-    // We need to peek here, because its either ']' which ends args
-    // Or it is important for the nested _parse_type call
-    lexer_token_t* token = lexer_token_iter_peek(iter);
+#include "types/type_table.h"
+#include "utils/vec.h"
+#include "utils/diag.h"
+
+enum _parser_type_frame_kind_t {
+    TYPE_FRAME_POINTER = 0,     // '>', waiting for the type pointed to
+    TYPE_FRAME_ARGS,            // 'rt [', waiting for the next arg
+    TYPE_FRAME_RETURN,          // 'rt ... :', waiting for the return type
+};
+
+struct _parser_type_frame_t {
+    int kind;
+    int has_args;               // Routine has an argument list, even if an empty one
+    size_t first_arg;           // Index of its first arg on the stack of finished args
+    size_t line_ref;            // Position of the '>' or 'rt', for errors
+    size_t char_ref;
+};
+
+UTILS_VEC_MAKE_SMALL_DECLARATION(_parser_type_frame, struct _parser_type_frame_t, 16)
+UTILS_VEC_MAKE_SMALL_IMPLEMENTATION(_parser_type_frame, struct _parser_type_frame_t, 64)
+
+// Reads the token after 'rt' (or after the arg list) which has to be ':'
+// Return value: 0 if ok, 1 if error
+int _parser_expect_colon(lexer_token_iterator_t* iter, const struct _parser_type_frame_t* frame) {
+    lexer_token_t* token = lexer_token_iter_next(iter);
 
     if(token == NULL) {
-        fprintf(stderr, "%s", "[parser] Error: Unexpected end of file.\n");
-        return NULL;
+        fprintf(UTILS_DIAG, "[parser] Error in routine type in line %zu char %zu: Unexpected end of file.\n", frame->line_ref, frame->char_ref);
+        return 1;
     }
 
-    // empty argument list is still valid, cause NULL means error
-    type_info_list_t* args = type_info_list_make();
-    // Check if arg list is not followed by ']' immediately, dont allocate a list of args in such case
-    if(token->type != TOKEN_END_SQUARE) {
-
-        while(1) {
-            type_info_t* arg_type = parser_parse_type(iter);
-
-            if(arg_type == NULL) {
-                fprintf(stderr, "[parser] Error in line %zu char %zu: Unable to parse type.\n", token->line_ref, token->char_ref);
-                type_info_list_destroy(args);
-                return NULL;
-            }
-
-            type_info_list_append(args, arg_type);
-
-            token = lexer_token_iter_next(iter);
-
-            if(token == NULL) {
-                fprintf(stderr, "%s", "[parser] Error: Unexpected end of file.\n");
-                type_info_list_destroy(args);
-                return NULL;
-            }
-
-            // If it's ']' we leave the arg list
-            if(token->type == TOKEN_END_SQUARE) {
-                break;
-            }
-
-            // Each arg except the last must be followed by ','
-            if(token->type != TOKEN_COMMA) {
-                fprintf(stderr, "[parser] Error in line %zu char %zu: Unexpected token, expected comma\n", token->line_ref, token->char_ref);
-                type_info_list_destroy(args);
-                return NULL;
-            }
-        }
-    } else {
-        lexer_token_iter_next(iter);
+    if(token->type != TOKEN_COLON) {
+        fprintf(UTILS_DIAG, "[parser] Error in line %zu char %zu: Expected ':'.\n", token->line_ref, token->char_ref);
+        return 1;
     }
 
-    return args;
+    return 0;
 }
 
-// Parse the routine type, starting from first toke nafter 'rt'
-type_info_t* parser_parse_routine_type(lexer_token_iterator_t* iter) {
-    type_info_list_t* args = NULL;
-    type_info_t* ret = NULL;
-
-    // Next token is either '[' if there are args, or ':' if no args, just return type
+// Reads the beginning of a type, pushing a frame for '>' and 'rt' or returning the builtin type
+// Returns NULL if a frame was pushed (or on error, then failed is set), the type otherwise
+type_info_t* _parser_type_begin(lexer_token_iterator_t* iter, _parser_type_frame_vec_t* frames, size_t num_args, int* failed) {
     lexer_token_t* token = lexer_token_iter_next(iter);
 
     if(token == NULL) {
-        fprintf(stderr, "%s", "[parser] Error: Unexpected end of file.\n");
+        fprintf(UTILS_DIAG, "%s", "[parser] Error in type: Unexpected end of file.\n");
+        *failed = 1;
         return NULL;
     }
 
-    // If it's '[' means routine accepts arguments, if its not it HAS to be ':' for return type
-    if(token->type == TOKEN_SQUARE) {
-        args = parser_parse_routine_type_args(iter);
-
-        if(args == NULL) {
-            fprintf(stderr, "[parser] Error in line %zu char %zu: Unable to parse argument list.\n", token->line_ref, token->char_ref);
-            return NULL;
-        }
-
-        // Put the next token into the variable (should be ':')
-        token = lexer_token_iter_next(iter);
+    struct _parser_type_frame_t frame = {
+        .kind = TYPE_FRAME_POINTER,
+        .has_args = 0,
+        .first_arg = num_args,
+        .line_ref = token->line_ref,
+        .char_ref = token->char_ref,
     };
 
-    if(token == NULL) {
-        fprintf(stderr, "%s", "[parser] Error: Unexpected end of file.\n");
-        type_info_list_destroy(args);
+    if(token->type != TOKEN_RT && token->type != TOKEN_TRIANGLE_RIGHT && token->type != TOKEN_IDENTIFIER) {
+        fprintf(UTILS_DIAG, "[parser] Error in line %zu char %zu: Unexpected token, expected type.\n", token->line_ref, token->char_ref);
+        *failed = 1;
         return NULL;
     }
 
-    // Has to be ':'
-    if(token->type != TOKEN_COLON) {
-        fprintf(stderr, "[parser] Error in line %zu char %zu: Expected ':'.\n", token->line_ref, token->char_ref);
-        type_info_list_destroy(args);
+    // TODO: Handle structural types here once they are implemented
+    if(token->type == TOKEN_IDENTIFIER) {
+        type_info_t* builtin = type_get_builtin_by_id(token->id);
+
+        if(builtin == NULL) {
+            fprintf(UTILS_DIAG, "[parser] Error in line %zu char %zu: Unable to parse type '%.*s'.\n", token->line_ref, token->char_ref, (int) token->length, token->contents);
+            *failed = 1;
+        }
+
+        return builtin;
+    }
+
+    if(UTILS_VEC_LENGTH(frames) >= PARSER_MAX_TYPE_DEPTH) {
+        fprintf(UTILS_DIAG, "[parser] Error in line %zu char %zu: Type is nested too deeply (more than %d levels).\n", frame.line_ref, frame.char_ref, PARSER_MAX_TYPE_DEPTH);
+        *failed = 1;
         return NULL;
     }
 
-    ret = parser_parse_type(iter);
+    if(token->type == TOKEN_RT) {
+        // Next token is either '[' if there are args, or ':' if no args, just return type
+        token = lexer_token_iter_peek(iter);
+        frame.kind = TYPE_FRAME_RETURN;
+
+        if(token != NULL && token->type == TOKEN_SQUARE) {
+            lexer_token_iter_next(iter);
+            frame.kind = TYPE_FRAME_ARGS;
+            frame.has_args = 1;
+
+            // Empty argument list is still valid
+            token = lexer_token_iter_peek(iter);
+            if(token != NULL && token->type == TOKEN_END_SQUARE) {
+                lexer_token_iter_next(iter);
+                frame.kind = TYPE_FRAME_RETURN;
+            }
+        }
 
-    if(ret == NULL) {
-        fprintf(stderr, "%s", "[parser] Error while parsing routine type: Unable to parse type.\n");
-        type_info_list_destroy(args);
-        return NULL;
+        if(frame.kind == TYPE_FRAME_RETURN && _parser_expect_colon(iter, &frame) != 0) {
+            *failed = 1;
+            return NULL;
+        }
     }
 
-    return type_make_routine(args, ret);
+    _parser_type_frame_vec_push(frames, frame);
+    return NULL;
 }
 
-type_info_t* parser_parse_type(lexer_token_iterator_t* iter) {
-    type_info_t* parsed_type = NULL;
+type_info_t* parser_parse_type(lexer_token_iterator_t* iter, type_table_t* types) {
+    _parser_type_frame_vec_t frames;
+    _parser_type_frame_vec_init(&frames);
 
-    lexer_token_t* token = lexer_token_iter_next(iter);
+    // Finished args of the routines on the stack, the args of the innermost one are on top
+    type_info_ptr_vec_t args;
+    type_info_ptr_vec_init(&args);
 
-    switch(token->type) {
-        // 'rt' keyword means routine
-        case TOKEN_RT: {
-            parsed_type = parser_parse_routine_type(iter);
-            if(parsed_type == NULL) {
-                fprintf(stderr, "[parser] Error in line %zu char %zu: Unable to parse routine type.\n", token->line_ref, token->char_ref);
-                return NULL;
-            }
-            break;
-        }
+    type_info_t* result = NULL;
+    int failed = 0;
 
-        // '>' means a pointer
-        case TOKEN_TRIANGLE_RIGHT: {
-            type_info_t* type_pointed_to = parser_parse_type(iter);
-            if(type_pointed_to == NULL) {
-                fprintf(stderr, "[parser] Error in line %zu char %zu: Unable to parse pointer type.\n", token->line_ref, token->char_ref);
-                return NULL;
-            }
-            parsed_type = type_make_pointer_to(type_pointed_to);
-            break;
-        }
+    while(!failed && result == NULL) {
+        type_info_t* type = _parser_type_begin(iter, &frames, UTILS_VEC_LENGTH(&args), &failed);
 
-        // identifier means a builtin type (or structural once those are implemented)
-        case TOKEN_IDENTIFIER: {
-            // TODO: Handle structural types here once they are implemented
-            parsed_type = type_get_builtin_by_name(token->contents);
-            if(parsed_type == NULL) {
-                fprintf(stderr, "[parser] Error in line %zu char %zu: Unable to parse type '%s'.\n", token->line_ref, token->char_ref, token->contents);
-                return NULL;
+        // A finished type completes the frames above it, until one which needs more tokens
+        while(type != NULL && !failed) {
+            if(UTILS_VEC_LENGTH(&frames) == 0) {
+                result = type;
+                break;
             }
-            break;
-        }
 
-        // Unknown token
-        default: {
-            fprintf(stderr, "[parser] Error in line %zu char %zu: Unexpected token, expected type.\n", token->line_ref, token->char_ref);
-            return NULL;
+            struct _parser_type_frame_t* frame = &UTILS_VEC_AT(&frames, UTILS_VEC_LENGTH(&frames) - 1);
+
+            if(frame->kind == TYPE_FRAME_POINTER) {
+                type = type_make_pointer_to(types, type);
+                _parser_type_frame_vec_pop(&frames);
+            } else if(frame->kind == TYPE_FRAME_RETURN) {
+                type_info_t** frame_args = frame->has_args ? args.arr + frame->first_arg : NULL;
+                type = type_make_routine_from(types, frame_args, UTILS_VEC_LENGTH(&args) - frame->first_arg, type);
+
+                type_info_ptr_vec_truncate(&args, frame->first_arg);
+                _parser_type_frame_vec_pop(&frames);
+            } else {
+                type_info_ptr_vec_push(&args, type);
+                type = NULL;
+
+                // Each arg except the last must be followed by ','
+                lexer_token_t* token = lexer_token_iter_next(iter);
+
+                if(token == NULL) {
+                    fprintf(UTILS_DIAG, "[parser] Error in routine type in line %zu char %zu: Unexpected end of file.\n", frame->line_ref, frame->char_ref);
+                    failed = 1;
+                } else if(token->type == TOKEN_END_SQUARE) {
+                    frame->kind = TYPE_FRAME_RETURN;
+                    failed = _parser_expect_colon(iter, frame);
+                } else if(token->type != TOKEN_COMMA) {
+                    fprintf(UTILS_DIAG, "[parser] Error in line %zu char %zu: Unexpected token, expected comma\n", token->line_ref, token->char_ref);
+                    failed = 1;
+                }
+            }
         }
     }
 
-    return parsed_type;
+    type_info_ptr_vec_deinit(&args);
+    _parser_type_frame_vec_deinit(&frames);
+
+    return failed ? NULL : result;
 }
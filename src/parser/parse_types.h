@@ -20,11 +20,18 @@
 #define _I_PARSER_PARSE_TYPES_H_
 
 #include "types/types.h"
+#include "types/type_table.h"
 #include "lexer/token_list.h"
 
+// Deepest nesting of '>' and 'rt' in a single type, may be set at build time (MORE_FLAGS="-DPARSER_MAX_TYPE_DEPTH=...")
+// Parsing does not recurse, the limit keeps the types (and strings of types) of the later stages reasonable
+#ifndef PARSER_MAX_TYPE_DEPTH
+#define PARSER_MAX_TYPE_DEPTH 256
+#endif
+
 // Assumes iterator points to the first token of a type
 // Consumes tokens until type is fully described
-// Returns NULL if error, or new declaration if ok
-type_info_t* parser_parse_type(lexer_token_iterator_t* iter);
+// Returns NULL if error, or the type if ok (unique in the table)
+type_info_t* parser_parse_type(lexer_token_iterator_t* iter, type_table_t* types);
 
 #endif
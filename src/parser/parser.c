@@ -20,22 +20,33 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
+#include <pthread.h>
 
 #include "lexer/token_list.h"
 #include "lexer/token_types.h"
 #include "types/types.h"
 #include "ast/ast.h"
+#include "utils/intern.h"
+#include "utils/diag.h"
+#include "utils/vec.h"
+#include "types/type_table.h"
 
 #include "parse_types.h"
-#include <stdio.h>
+#include "parse_expr.h"
+
+// Used to guess how many declarations there are from the number of tokens
+#define PARSER_TOKENS_PER_DECL_HINT 16
+
 // Assumes iterator points to the first token of a declaration
 // Consumes tokens until declaration is fully described
-// Returns NULL if error, or new declaration if ok
-ast_decl_t* parser_parse_declaration(lexer_token_iterator_t* iter) {
-    ast_decl_t* new_decl = malloc(sizeof(ast_decl_t));
-
+// Returns 1 if error, or 0 if ok and the declaration was written into new_decl
+// Types are added to the table of the AST, on errors they are just left there (same for the nodes of the value)
+// Routine literals in the value are parsed at depth + 1
+int parser_parse_declaration(lexer_token_iterator_t* iter, ast_global_scope_t* ast, ast_decl_t* new_decl, size_t depth) {
     lexer_token_t* token = lexer_token_iter_next(iter);
+    new_decl->value = AST_EXPR_NONE;
 
     switch(token->type) {
         case TOKEN_CONST:
@@ -47,42 +58,36 @@ ast_decl_t* parser_parse_declaration(lexer_token_iterator_t* iter) {
             break;
 
         default: {
-            fprintf(stderr, "[parser] Error in line %zu char %zu: Unexpected token at the beginning of a declaration, expected 'const' or 'decl'.\n", token->line_ref, token->char_ref);
-            free(new_decl);
-            return NULL;
+            fprintf(UTILS_DIAG, "[parser] Error in line %zu char %zu: Unexpected token at the beginning of a declaration, expected 'const' or 'decl'.\n", token->line_ref, token->char_ref);
+            return 1;
         }
     }
 
     // Declarations takes its references from the const/decl keyword
-    new_decl->line_ref = token->line_ref;
-    new_decl->char_ref = token->char_ref;
+    new_decl->line_ref = (uint32_t) token->line_ref;
+    new_decl->char_ref = (uint32_t) token->char_ref;
 
     token = lexer_token_iter_next(iter);
 
     if(token == NULL) {
-        fprintf(stderr, "[parser] Error in declaration in line %zu char %zu: Unexpected end of file.\n", new_decl->line_ref, new_decl->char_ref);
-        free(new_decl);
-        return NULL;
+        fprintf(UTILS_DIAG, "[parser] Error in declaration in line %u char %u: Unexpected end of file.\n", new_decl->line_ref, new_decl->char_ref);
+        return 1;
     }
 
     // We expect the identifier now
-    if(token->type != TOKEN_IDENTIFIER || token->contents == NULL) {
-        fprintf(stderr, "[parser] Error in declaration in line %zu char %zu: Expected identifier.\n", new_decl->line_ref, new_decl->char_ref);
-        free(new_decl);
-        return NULL;
+    if(token->type != TOKEN_IDENTIFIER || token->id == UTILS_INTERN_NONE) {
+        fprintf(UTILS_DIAG, "[parser] Error in declaration in line %u char %u: Expected identifier.\n", new_decl->line_ref, new_decl->char_ref);
+        return 1;
     }
 
-    // Copy the identifier to decl structure
-    new_decl->symbol = malloc(strlen(token->contents) + 1);
-    strcpy(new_decl->symbol, token->contents);
+    // The identifier was interned by the lexer, the decl only refers to it by id
+    new_decl->symbol = token->id;
 
     token = lexer_token_iter_next(iter);
 
     if(token == NULL) {
-        fprintf(stderr, "[parser] Error in declaration in line %zu char %zu: Unexpected end of file.\n", new_decl->line_ref, new_decl->char_ref);
-        free(new_decl->symbol);
-        free(new_decl);
-        return NULL;
+        fprintf(UTILS_DIAG, "[parser] Error in declaration in line %u char %u: Unexpected end of file.\n", new_decl->line_ref, new_decl->char_ref);
+        return 1;
     }
 
     // We expect a separator, either : for type definition or = to infer type and provide expression
@@ -90,86 +95,228 @@ ast_decl_t* parser_parse_declaration(lexer_token_iterator_t* iter) {
         // Declaration contains type information
 
         if(!lexer_token_iter_isnt_empty(iter)) {
-            fprintf(stderr, "[parser] Error in declaration in line %zu char %zu: Unexpected end of file.\n", new_decl->line_ref, new_decl->char_ref);
-            free(new_decl->symbol);
-            free(new_decl);
-            return NULL;
+            fprintf(UTILS_DIAG, "[parser] Error in declaration in line %u char %u: Unexpected end of file.\n", new_decl->line_ref, new_decl->char_ref);
+            return 1;
         }
 
         // Parse the type and handle errors
-        new_decl->type = parser_parse_type(iter);
-        if(new_decl->type == NULL) {
-            fprintf(stderr, "[parser] Error in declaration in line %zu char %zu: Cannot parse type.\n", new_decl->line_ref, new_decl->char_ref);
-            free(new_decl->symbol);
-            free(new_decl);
-            return NULL;
+        type_info_t* type = parser_parse_type(iter, ast->types);
+        if(type == NULL) {
+            fprintf(UTILS_DIAG, "[parser] Error in declaration in line %u char %u: Cannot parse type.\n", new_decl->line_ref, new_decl->char_ref);
+            return 1;
         }
+
+        new_decl->type = type->id;
         token = lexer_token_iter_next(iter);
     } else {
         // Declaration is immediately followed by value, skipping
         // type info. Leave type to be inferred later.
-        new_decl->type = NULL;
+        new_decl->type = TYPE_ID_NONE;
     }
 
     if(token == NULL) {
-        fprintf(stderr, "[parser] Error in declaration in line %zu char %zu: Unexpected end of file.\n", new_decl->line_ref, new_decl->char_ref);
-        type_destroy(new_decl->type);
-        free(new_decl->symbol);
-        free(new_decl);
-        return NULL;
+        fprintf(UTILS_DIAG, "[parser] Error in declaration in line %u char %u: Unexpected end of file.\n", new_decl->line_ref, new_decl->char_ref);
+        return 1;
     }
 
     // If it is followed by semicolon it means were done with current decl, can return
     if(token->type == TOKEN_SEMICOLON) {
-        return new_decl;
+        return 0;
     }
 
     // If it is NOT followed by '=' its an error, you either end declaration or provide value
     if(token->type != TOKEN_EQUAL) {
-        fprintf(stderr, "[parser] Error in declaration in line %zu char %zu: Expected value or end of declaration.\n", new_decl->line_ref, new_decl->char_ref);
-        type_destroy(new_decl->type);
-        free(new_decl->symbol);
-        free(new_decl);
-        return NULL;
+        fprintf(UTILS_DIAG, "[parser] Error in declaration in line %u char %u: Expected value or end of declaration.\n", new_decl->line_ref, new_decl->char_ref);
+        return 1;
     }
 
-    // TODO: Parse body here
-    // For now lets just consume all tokens until semicolon ends declaration
-    do {
-        token = lexer_token_iter_next(iter);
-        if(token == NULL) {
-            fprintf(stderr, "[parser] Error in declaration in line %zu char %zu: Unexpected end of file.\n", new_decl->line_ref, new_decl->char_ref);
-            type_destroy(new_decl->type);
-            free(new_decl->symbol);
-            free(new_decl);
-            return NULL;
+    token = lexer_token_iter_peek(iter);
+    if(token == NULL) {
+        fprintf(UTILS_DIAG, "[parser] Error in declaration in line %u char %u: Unexpected end of file.\n", new_decl->line_ref, new_decl->char_ref);
+        return 1;
+    }
+
+    // An empty value, as in "decl x: u32 = ;", is the same as no value
+    if(token->type != TOKEN_SEMICOLON) {
+        new_decl->value = parser_parse_expression(iter, ast, depth);
+        if(new_decl->value == AST_EXPR_NONE) {
+            fprintf(UTILS_DIAG, "[parser] Error in declaration in line %u char %u: Cannot parse value.\n", new_decl->line_ref, new_decl->char_ref);
+            return 1;
         }
-    } while(token->type != TOKEN_SEMICOLON);
+    }
 
-    return new_decl;
+    token = lexer_token_iter_next(iter);
+    if(token == NULL || token->type != TOKEN_SEMICOLON) {
+        fprintf(UTILS_DIAG, "[parser] Error in declaration in line %u char %u: Expected ';' after the value.\n", new_decl->line_ref, new_decl->char_ref);
+        return 1;
+    }
+
+    return 0;
+}
+
+// Processes tokens from the iterator and generates AST
+int parser_process_tokens(lexer_token_iterator_t* iter, ast_global_scope_t* ast) {
+    while(lexer_token_iter_isnt_empty(iter)) {
+        ast_decl_t new_decl;
+
+        if(parser_parse_declaration(iter, ast, &new_decl, 0) != 0) {
+            fprintf(UTILS_DIAG, "%s", "[parser] Error during parsing of global declarations.\n");
+            return 1;
+        }
+
+        ast_decl_vec_push(&(ast->decls), new_decl);
+    }
+
+    // In pull mode the iterator also stops when the lexer fails, which is not the end of the source
+    if(lexer_token_iter_failed(iter)) {
+        return 1;
+    }
+
+    return 0;
 }
 
 // Processes the token list and generates AST
-// TODO: Parse more than just declarations, add expressions etc
 int parser_process_token_list(lexer_token_list_t* list, ast_global_scope_t* ast) {
     // Create an iterator over the list's contents.
     // The iterator is reference-only. The list cannot be destroyed before the end of iteration.
     lexer_token_iterator_t iter;
     lexer_token_list_into_iter(list, &iter);
 
-    ast_decl_list_t* decls = ast->decls;
-    while(lexer_token_iter_isnt_empty(&iter)) {
-        ast_decl_t* new_decl = parser_parse_declaration(&iter);
+    // The number of tokens gives an estimate of the number of declarations, even short ones take a few tokens
+    ast_decl_vec_reserve(&(ast->decls), list->num_tokens / PARSER_TOKENS_PER_DECL_HINT);
 
-        if(new_decl == NULL) {
-            fprintf(stderr, "%s", "[parser] Error during parsing of global declarations.\n");
-            return 1;
+    return parser_process_tokens(&iter, ast);
+}
+
+// Part of the tokens parsed by one thread in parser_process_token_list_parallel()
+struct _parser_chunk_t {
+    lexer_token_list_t* list;
+    ast_global_scope_t* ast;        // Part of the AST, with its own types and nodes
+    size_t start;                   // Indices of the first token of the chunk and one past the last one,
+    size_t end;                     // the chunk begins with a top-level declaration
+    FILE* diag;                     // Errors are not reported from the chunks, see below
+    int result;
+};
+
+void* _parser_chunk_worker(void* arg) {
+    struct _parser_chunk_t* chunk = arg;
+
+    FILE* previous_diag = utils_diag_stream();
+    utils_diag_set_stream(chunk->diag);
+
+    lexer_token_iterator_t iter;
+    lexer_token_list_range_iter(chunk->list, chunk->start, chunk->end, &iter);
+
+    ast_decl_vec_reserve(&(chunk->ast->decls), (chunk->end - chunk->start) / PARSER_TOKENS_PER_DECL_HINT);
+    chunk->result = parser_process_tokens(&iter, chunk->ast);
+
+    utils_diag_set_stream(previous_diag);
+
+    return NULL;
+}
+
+// Finds where the chunks begin, about evenly spaced, writing the indices of their first tokens into starts
+// A chunk may only begin with 'const' or 'decl' right after the ';' or '}' which ends the previous declaration,
+// outside of any brackets, so that it is where the serial parser would begin a declaration as well
+// Returns the number of chunks found, which may be less than num_chunks
+size_t _parser_find_chunks(const lexer_token_list_t* list, size_t* starts, size_t num_chunks) {
+    size_t found = 1;
+    starts[0] = 0;
+
+    long depth = 0;
+    for(size_t i = 1; i < list->num_tokens && found < num_chunks; i++) {
+        lexer_token_type_t type = (lexer_token_type_t) list->types[i];
+        lexer_token_type_t previous = (lexer_token_type_t) list->types[i - 1];
+
+        if(previous == TOKEN_BRACKET || previous == TOKEN_PAREN || previous == TOKEN_SQUARE) {
+            depth += 1;
+        } else if(previous == TOKEN_END_BRACKET || previous == TOKEN_END_PAREN || previous == TOKEN_END_SQUARE) {
+            depth -= 1;
+        }
+
+        // Unbalanced source, whatever the parser makes of it is better found out without the threads
+        if(depth < 0) break;
+
+        if(depth != 0 || i < list->num_tokens / num_chunks * found) continue;
+
+        if((type == TOKEN_CONST || type == TOKEN_DECL) && (previous == TOKEN_SEMICOLON || previous == TOKEN_END_BRACKET)) {
+            starts[found] = i;
+            found += 1;
         }
+    }
 
-        ast_decl_list_append(decls, new_decl);
+    return found;
+}
+
+int parser_process_token_list_parallel(lexer_token_list_t* list, ast_global_scope_t* ast, size_t num_threads) {
+    size_t num_chunks = list->num_tokens / PARSER_MIN_CHUNK_TOKENS;
+    if(num_chunks > num_threads) num_chunks = num_threads;
+
+    // Diagnostics of the chunks are thrown away, if there are any the whole list is parsed again
+    FILE* devnull = num_chunks > 1 ? fopen("/dev/null", "w") : NULL;
+    if(devnull == NULL) {
+        return parser_process_token_list(list, ast);
     }
 
-    ast->decls = decls;
+    size_t* starts = malloc(num_chunks * sizeof(size_t));
+    num_chunks = _parser_find_chunks(list, starts, num_chunks);
+
+    // The index of lines is built here, the threads only read it
+    lexer_token_list_index_lines(list);
+
+    struct _parser_chunk_t* chunks = malloc(num_chunks * sizeof(struct _parser_chunk_t));
+    for(size_t i = 0; i < num_chunks; i++) {
+        struct _parser_chunk_t* chunk = chunks + i;
+
+        chunk->list = list;
+        chunk->ast = ast_global_scope_make_part(ast);
+        chunk->start = starts[i];
+        chunk->end = i != num_chunks - 1 ? starts[i + 1] : list->num_tokens;
+        chunk->diag = devnull;
+        chunk->result = 0;
+    }
+
+    // The first chunk is done by this thread
+    pthread_t* threads = malloc(num_chunks * sizeof(pthread_t));
+    int* started = calloc(num_chunks, sizeof(int));
+
+    for(size_t i = 1; i < num_chunks; i++) {
+        started[i] = pthread_create(threads + i, NULL, _parser_chunk_worker, chunks + i) == 0;
+
+        // If the thread can't be created, the chunk is done by this thread later
+        if(!started[i]) _parser_chunk_worker(chunks + i);
+    }
+
+    _parser_chunk_worker(chunks);
+
+    int result = 0;
+    for(size_t i = 0; i < num_chunks; i++) {
+        if(i != 0 && started[i]) pthread_join(threads[i], NULL);
+        if(chunks[i].result != 0) result = 1;
+    }
+
+    // Parts are appended in order, so the ids of types and nodes are the same as from the serial parser
+    if(result == 0) {
+        for(size_t i = 0; i < num_chunks; i++) {
+            ast_global_scope_merge(ast, chunks[i].ast);
+        }
+    }
+
+    for(size_t i = 0; i < num_chunks; i++) {
+        ast_global_scope_destroy(chunks[i].ast);
+    }
+
+    free(started);
+    free(threads);
+    free(chunks);
+    free(starts);
+    fclose(devnull);
+
+    // Errors are rare, so the list is simply parsed again by the serial parser, which reports the first
+    // one exactly like it would without the threads
+    if(result != 0) {
+        return parser_process_token_list(list, ast);
+    }
 
     return 0;
 }
@@ -23,11 +23,37 @@
 
 #include "lexer/token_list.h"
 #include "ast/ast.h"
+#include "io/binfile.h"
+
+// Processes tokens from the iterator and generates AST
+// Works with both iterators over a token list and pull mode iterators reading straight from a lexer
+// The lexer has to intern the identifiers into the table of names of the AST (ast->names)
+int parser_process_tokens(lexer_token_iterator_t* iter, ast_global_scope_t* ast);
 
 // Processes the token list and generates AST
+// Identifiers in the list have to be interned into the table of names of the AST
 int parser_process_token_list(lexer_token_list_t* list, ast_global_scope_t* ast);
 
+// Token lists shorter than this per thread are not split between threads
+#define PARSER_MIN_CHUNK_TOKENS ((size_t) 64 * 1024)
+
+// Same as parser_process_token_list(), but splits the list between top-level declarations into chunks
+// which are parsed by up to num_threads threads at once. The resulting AST is exactly the same as the one
+// made by parser_process_token_list(), errors are reported the same way as well
+int parser_process_token_list_parallel(lexer_token_list_t* list, ast_global_scope_t* ast, size_t num_threads);
+
 // Output from the parsing stage
 void parser_write_output(FILE* outfile, ast_global_scope_t* ast);
 
+// Binary output from the parsing stage (see io/binfile.h)
+//
+// Return value: 0 if ok, 1 if error
+int parser_write_binary(FILE* outfile, ast_global_scope_t* ast);
+
+// Fills the empty AST (fresh from ast_global_scope_make()) with the declarations, types and names of the binary file
+// Names and types are put into the tables of the AST, so the file does not have to outlive it
+//
+// Return value: 0 if ok, 1 if error
+int parser_load_binary(const io_binfile_t* binfile, ast_global_scope_t* ast);
+
 #endif
@@ -0,0 +1,44 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// output - Printing output of the name resolution stage
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "resolver.h"
+#include "ast/ast.h"
+#include "utils/intern.h"
+
+// Every resolved symbol on its own line, in the order of the ids of the expressions
+void resolver_write_output(FILE* outfile, ast_global_scope_t* ast, const resolver_symbols_t* symbols) {
+    fprintf(outfile, "Symbols {\n");
+
+    for(size_t id = 0; id < symbols->num_exprs; id++) {
+        resolver_ref_t ref = symbols->refs[id];
+        if(ref == RESOLVER_REF_NONE) continue;
+
+        const ast_expr_t* expr = AST_EXPR_GET(ast, id);
+        const ast_decl_t* decl = RESOLVER_REF_DECL(ast, ref);
+
+        fprintf(outfile, "\t%s (line %u char %u) -> %s (line %u char %u)\n",
+            UTILS_INTERN_GET(ast->names, expr->left), expr->line_ref, expr->char_ref,
+            RESOLVER_REF_IS_LOCAL(ref) ? "local" : "global", decl->line_ref, decl->char_ref
+        );
+    }
+
+    fprintf(outfile, "}\n");
+}
@@ -0,0 +1,245 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// resolver - Name resolution, finds the declaration which every symbol used in the AST refers to
+
+#include "resolver.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "ast/ast.h"
+#include "utils/vec.h"
+#include "utils/intern.h"
+#include "utils/diag.h"
+#include "symtab.h"
+
+// Expressions and bodies of routines are walked with an explicit stack of pending work, not recursively
+// Statements are pushed in reverse, so they are done in order, each with everything inside of it before the next one
+enum _resolver_work_kind_t {
+    WORK_EXPR = 0,      // index is the id of an expression to resolve
+    WORK_STMT,          // index is the index of a statement
+    WORK_DECLARE,       // index is the index of a local, declared after its value is resolved
+    WORK_LEAVE,         // closes the scope of a routine
+};
+
+struct _resolver_work_t {
+    uint32_t kind;
+    uint32_t index;
+};
+
+UTILS_VEC_MAKE_SMALL_DECLARATION(_resolver_work, struct _resolver_work_t, 32)
+UTILS_VEC_MAKE_SMALL_IMPLEMENTATION(_resolver_work, struct _resolver_work_t, 128)
+
+struct _resolver_state_t {
+    ast_global_scope_t* ast;
+    resolver_symbols_t* symbols;
+    resolver_symtab_t symtab;
+    _resolver_work_vec_t work;
+    int failed;
+};
+
+void _resolver_push(struct _resolver_state_t* state, uint32_t kind, uint32_t index) {
+    struct _resolver_work_t item = { .kind = kind, .index = index };
+    _resolver_work_vec_push(&(state->work), item);
+}
+
+// Declares the symbol of the declaration in the current scope, reports it if the name is taken there already
+void _resolver_declare(struct _resolver_state_t* state, const ast_decl_t* decl, resolver_ref_t ref) {
+    resolver_ref_t earlier = resolver_symtab_declare(&(state->symtab), decl->symbol, ref);
+
+    if(earlier != RESOLVER_REF_NONE) {
+        const ast_decl_t* first = RESOLVER_REF_DECL(state->ast, earlier);
+
+        fprintf(UTILS_DIAG, "[resolver] Error in line %u char %u: Symbol '%s' is already declared in this scope, in line %u char %u.\n",
+            decl->line_ref, decl->char_ref, AST_DECL_SYMBOL(state->ast, decl), first->line_ref, first->char_ref
+        );
+        state->failed = 1;
+    }
+}
+
+// Opens the scope of the routine with its params, and pushes its statements and the closing of the scope
+void _resolver_enter_routine(struct _resolver_state_t* state, const ast_routine_t* routine) {
+    resolver_symtab_enter(&(state->symtab));
+
+    for(uint32_t idx = routine->first_param; idx < routine->first_param + routine->num_params; idx++) {
+        _resolver_declare(state, &UTILS_VEC_AT(&(state->ast->locals), idx), idx | RESOLVER_REF_LOCAL);
+    }
+
+    _resolver_push(state, WORK_LEAVE, 0);
+    for(uint32_t idx = routine->num_stmts; idx > 0; idx--) {
+        _resolver_push(state, WORK_STMT, routine->first_stmt + idx - 1);
+    }
+}
+
+// Resolves a symbol, or pushes the operands of the expression (in reverse, so the errors come in the order of the source)
+void _resolver_expr(struct _resolver_state_t* state, ast_expr_id_t id) {
+    ast_global_scope_t* ast = state->ast;
+    const ast_expr_t* expr = AST_EXPR_GET(ast, id);
+
+    switch(expr->kind) {
+        case AST_EXPR_SYMBOL: {
+            resolver_ref_t ref = resolver_symtab_lookup(&(state->symtab), expr->left);
+
+            if(ref == RESOLVER_REF_NONE) {
+                fprintf(UTILS_DIAG, "[resolver] Error in line %u char %u: Undeclared symbol '%s'.\n",
+                    expr->line_ref, expr->char_ref, UTILS_INTERN_GET(ast->names, expr->left)
+                );
+                state->failed = 1;
+            } else {
+                state->symbols->num_uses += 1;
+            }
+
+            state->symbols->refs[id] = ref;
+            break;
+        }
+
+        case AST_EXPR_BINARY: {
+            _resolver_push(state, WORK_EXPR, expr->right);
+            _resolver_push(state, WORK_EXPR, expr->left);
+            break;
+        }
+
+        case AST_EXPR_CALL: {
+            uint32_t num_args = UTILS_VEC_AT(&(ast->expr_args), expr->right);
+
+            for(uint32_t idx = num_args; idx > 0; idx--) {
+                _resolver_push(state, WORK_EXPR, UTILS_VEC_AT(&(ast->expr_args), expr->right + idx));
+            }
+            _resolver_push(state, WORK_EXPR, expr->left);
+            break;
+        }
+
+        // Names of members belong to the type of the left side, not to any scope
+        case AST_EXPR_UNARY:
+        case AST_EXPR_MEMBER: {
+            _resolver_push(state, WORK_EXPR, expr->left);
+            break;
+        }
+
+        case AST_EXPR_ROUTINE: {
+            _resolver_enter_routine(state, &UTILS_VEC_AT(&(ast->routines), expr->left));
+            break;
+        }
+
+        // Literals
+        default:
+            break;
+    }
+}
+
+void _resolver_stmt(struct _resolver_state_t* state, const ast_stmt_t* stmt) {
+    uint32_t value = stmt->value;
+
+    if(stmt->kind == AST_STMT_DECL) {
+        _resolver_push(state, WORK_DECLARE, stmt->value);
+        value = UTILS_VEC_AT(&(state->ast->locals), stmt->value).value;
+    }
+
+    if(value != AST_EXPR_NONE) {
+        _resolver_push(state, WORK_EXPR, value);
+    }
+}
+
+// Resolves the expression and everything inside of it, including the bodies of routine literals
+void _resolver_walk(struct _resolver_state_t* state, ast_expr_id_t root) {
+    _resolver_push(state, WORK_EXPR, root);
+
+    while(UTILS_VEC_LENGTH(&(state->work)) != 0) {
+        struct _resolver_work_t item = _resolver_work_vec_pop(&(state->work));
+
+        switch(item.kind) {
+            case WORK_EXPR: {
+                _resolver_expr(state, item.index);
+                break;
+            }
+
+            case WORK_STMT: {
+                _resolver_stmt(state, &UTILS_VEC_AT(&(state->ast->stmts), item.index));
+                break;
+            }
+
+            case WORK_DECLARE: {
+                _resolver_declare(state, &UTILS_VEC_AT(&(state->ast->locals), item.index), item.index | RESOLVER_REF_LOCAL);
+                break;
+            }
+
+            default: {
+                resolver_symtab_leave(&(state->symtab));
+                break;
+            }
+        }
+    }
+}
+
+resolver_symbols_t* resolver_symbols_make() {
+    resolver_symbols_t* symbols = malloc(sizeof(resolver_symbols_t));
+
+    symbols->refs = NULL;
+    symbols->num_exprs = 0;
+    symbols->num_uses = 0;
+
+    return symbols;
+}
+
+void resolver_symbols_destroy(resolver_symbols_t* symbols) {
+    if(symbols == NULL) return;
+
+    free(symbols->refs);
+    free(symbols);
+}
+
+int resolver_process_ast(ast_global_scope_t* ast, resolver_symbols_t* symbols) {
+    size_t num_decls = UTILS_VEC_LENGTH(&(ast->decls));
+
+    symbols->num_exprs = UTILS_VEC_LENGTH(&(ast->exprs));
+    symbols->refs = malloc((symbols->num_exprs + 1) * sizeof(resolver_ref_t));
+    for(size_t id = 0; id < symbols->num_exprs; id++) {
+        symbols->refs[id] = RESOLVER_REF_NONE;
+    }
+
+    struct _resolver_state_t state;
+    state.ast = ast;
+    state.symbols = symbols;
+    state.failed = 0;
+
+    // With room for every name of the source the slots never grow, and no two names share a probe sequence
+    resolver_symtab_init(&(state.symtab), ast->names->num_strings);
+    _resolver_work_vec_init(&(state.work));
+
+    // All of the globals are visible in the whole source, so they are declared before any value is resolved
+    for(size_t idx = 0; idx < num_decls; idx++) {
+        _resolver_declare(&state, &UTILS_VEC_AT(&(ast->decls), idx), (resolver_ref_t) idx);
+    }
+
+    for(size_t idx = 0; idx < num_decls; idx++) {
+        ast_expr_id_t value = UTILS_VEC_AT(&(ast->decls), idx).value;
+
+        if(value != AST_EXPR_NONE) {
+            _resolver_walk(&state, value);
+        }
+    }
+
+    _resolver_work_vec_deinit(&(state.work));
+    resolver_symtab_deinit(&(state.symtab));
+
+    if(state.failed) {
+        fprintf(UTILS_DIAG, "%s", "[resolver] Error during resolution of symbols.\n");
+    }
+
+    return state.failed;
+}
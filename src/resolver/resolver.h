@@ -0,0 +1,62 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// resolver - Name resolution, finds the declaration which every symbol used in the AST refers to
+
+// Scopes are the ones of language_design_notes/parsing.txt: the global scope holds all of the top-level declarations,
+// which are visible in the whole source (also before they are declared), every routine literal opens a scope with
+// its params and the declarations of its body, and a routine literal inside of it opens a scope inside of that one.
+// A declaration inside of a routine is visible from the statement after it on, so its own value still sees the
+// outer name. A name may be declared once per scope, an inner scope may hide the names of the outer ones.
+// There are no closures: a routine sees the globals and its own names, not the ones of the routines around it.
+//
+// The resolution is not saved in binary files: the binary output of this stage is the AST of the parsing stage,
+// which takes a single pass to resolve again once it is loaded.
+
+#ifndef _I_RESOLVER_RESOLVER_H_
+#define _I_RESOLVER_RESOLVER_H_
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "ast/ast.h"
+#include "symtab.h"
+
+// Result of the resolution of an AST
+struct resolver_symbols_t {
+    resolver_ref_t* refs;   // Declaration of every expression by its id, RESOLVER_REF_NONE if it is not a symbol
+    size_t num_exprs;
+    size_t num_uses;        // Symbols which were resolved
+};
+typedef struct resolver_symbols_t resolver_symbols_t;
+
+// The structure is malloc'ed - requires freeing with resolver_symbols_destroy()
+resolver_symbols_t* resolver_symbols_make();
+void resolver_symbols_destroy(resolver_symbols_t* symbols);
+
+// Resolves every symbol of the AST into symbols (fresh from resolver_symbols_make())
+// All of the undeclared and redeclared symbols are reported, not only the first one
+//
+// Return value: 0 if ok, 1 if error
+int resolver_process_ast(ast_global_scope_t* ast, resolver_symbols_t* symbols);
+
+// Output from the name resolution stage
+void resolver_write_output(FILE* outfile, ast_global_scope_t* ast, const resolver_symbols_t* symbols);
+
+// Declaration (ast_decl_t*) a resolved symbol refers to, in decls or in locals of the AST
+#define RESOLVER_REF_DECL(ast, ref) (RESOLVER_REF_IS_LOCAL(ref) ? &UTILS_VEC_AT(&((ast)->locals), RESOLVER_REF_INDEX(ref)) : &UTILS_VEC_AT(&((ast)->decls), (ref)))
+
+#endif
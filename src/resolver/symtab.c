@@ -0,0 +1,150 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// symtab - Scoped table of symbols, tells which declaration a name refers to at the current point
+
+#include "symtab.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "utils/vec.h"
+#include "utils/intern.h"
+
+#define DEFAULT_SLOTS_NUM 64
+
+// Ids of names are consecutive numbers from 0, so they are their own hash: they do not collide at all until there
+// are more names than slots, and names declared one after another (like the globals) get slots next to each other
+#define SYMTAB_HASH(name) ((uint32_t) (name))
+
+UTILS_VEC_MAKE_IMPLEMENTATION(resolver_binding, struct resolver_binding_t, 64)
+UTILS_VEC_MAKE_IMPLEMENTATION(resolver_mark, size_t, 16)
+
+// Returns the slot of the name, or the empty slot where it should go
+size_t _resolver_symtab_probe(const resolver_symtab_t* t, utils_intern_id_t name) {
+    size_t mask = t->num_slots - 1;
+    size_t slot = SYMTAB_HASH(name) & mask;
+
+    while(t->slots[slot].name != UTILS_INTERN_NONE && t->slots[slot].name != name) {
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+// Allocates num_slots empty slots (a power of 2)
+void _resolver_symtab_alloc_slots(resolver_symtab_t* t, size_t num_slots) {
+    t->num_slots = num_slots;
+    t->slots = malloc(num_slots * sizeof(resolver_binding_t));
+
+    // Empty name and no declarations are all ones
+    memset(t->slots, 0xFF, num_slots * sizeof(resolver_binding_t));
+}
+
+// Doubles the number of slots and puts every used one back
+void _resolver_symtab_grow_slots(resolver_symtab_t* t) {
+    resolver_binding_t* old_slots = t->slots;
+    size_t old_num_slots = t->num_slots;
+
+    _resolver_symtab_alloc_slots(t, old_num_slots * 2);
+
+    for(size_t idx = 0; idx < old_num_slots; idx++) {
+        if(old_slots[idx].name == UTILS_INTERN_NONE) continue;
+
+        t->slots[_resolver_symtab_probe(t, old_slots[idx].name)] = old_slots[idx];
+    }
+
+    free(old_slots);
+}
+
+void resolver_symtab_init(resolver_symtab_t* t, size_t expected_names) {
+    // At most half full, like the other hash tables
+    size_t num_slots = DEFAULT_SLOTS_NUM;
+    while(num_slots < expected_names * 2) num_slots *= 2;
+
+    _resolver_symtab_alloc_slots(t, num_slots);
+    t->num_used = 0;
+
+    resolver_binding_vec_init(&(t->undo));
+    resolver_mark_vec_init(&(t->scopes));
+}
+
+void resolver_symtab_deinit(resolver_symtab_t* t) {
+    free(t->slots);
+    t->slots = NULL;
+
+    resolver_binding_vec_deinit(&(t->undo));
+    resolver_mark_vec_deinit(&(t->scopes));
+}
+
+void resolver_symtab_enter(resolver_symtab_t* t) {
+    resolver_mark_vec_push(&(t->scopes), UTILS_VEC_LENGTH(&(t->undo)));
+}
+
+void resolver_symtab_leave(resolver_symtab_t* t) {
+    if(UTILS_VEC_LENGTH(&(t->scopes)) == 0) return;
+
+    size_t mark = resolver_mark_vec_pop(&(t->scopes));
+
+    // Newest first, so a name declared twice on the way (in the scopes left already) ends up as it was before all of them
+    while(UTILS_VEC_LENGTH(&(t->undo)) > mark) {
+        resolver_binding_t old = resolver_binding_vec_pop(&(t->undo));
+        t->slots[_resolver_symtab_probe(t, old.name)] = old;
+    }
+}
+
+resolver_ref_t resolver_symtab_declare(resolver_symtab_t* t, utils_intern_id_t name, resolver_ref_t ref) {
+    uint32_t depth = RESOLVER_SYMTAB_DEPTH(t);
+    resolver_binding_t* binding = &(t->slots[_resolver_symtab_probe(t, name)]);
+
+    int is_new = binding->name == UTILS_INTERN_NONE;
+
+    if(is_new) {
+        binding->name = name;
+        binding->ref = RESOLVER_REF_NONE;
+        binding->depth = 0;
+        binding->global = RESOLVER_REF_NONE;
+        t->num_used += 1;
+    } else if(binding->ref != RESOLVER_REF_NONE && binding->depth == depth) {
+        return binding->ref;
+    }
+
+    // The global scope is never left, nothing to put back there
+    if(depth != 0) {
+        resolver_binding_vec_push(&(t->undo), *binding);
+    }
+
+    binding->ref = ref;
+    binding->depth = depth;
+    if(depth == 0) binding->global = ref;
+
+    if(is_new && t->num_used * 2 > t->num_slots) {
+        _resolver_symtab_grow_slots(t);
+    }
+
+    return RESOLVER_REF_NONE;
+}
+
+resolver_ref_t resolver_symtab_lookup(const resolver_symtab_t* t, utils_intern_id_t name) {
+    const resolver_binding_t* binding = &(t->slots[_resolver_symtab_probe(t, name)]);
+
+    // An empty slot has no declaration either
+    if(binding->depth == 0 || binding->depth == RESOLVER_SYMTAB_DEPTH(t)) return binding->ref;
+
+    // Declared by one of the routines around the current one
+    return binding->global;
+}
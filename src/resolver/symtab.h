@@ -0,0 +1,96 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// symtab - Scoped table of symbols, tells which declaration a name refers to at the current point
+
+// Every name has at most one slot in an open addressing hash table keyed by the id of the name (names are interned,
+// so the id is the whole key). The slot holds the declaration the name refers to right now and the depth of the scope
+// it was declared in. Declaring a name in an inner scope overwrites its slot and puts the old contents into an undo
+// log, so leaving the scope only puts back the slots of the names declared in it, from the end of the log.
+//
+// Every scope but the global one is the scope of a routine, and routines do not see the params and declarations of
+// the routines around them (there are no closures). So a name declared in an outer scope other than the global one
+// is not declared at all in the current scope, unless it is a global too - which is why the slot also keeps the
+// global declaration of the name next to the one it refers to in the innermost scope.
+//
+// Entering a scope is O(1), leaving it is O(1) per name declared inside of it, and looking a name up is a single
+// probe sequence, no matter how many scopes are open or how many names are declared in the global scope.
+// Slots are never removed (a name no longer declared keeps its slot with RESOLVER_REF_NONE), so there are no tombstones.
+
+#ifndef _I_RESOLVER_SYMTAB_H_
+#define _I_RESOLVER_SYMTAB_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils/vec.h"
+#include "utils/intern.h"
+
+// Declaration a name refers to: the index in decls of the AST for globals,
+// or the index in locals with RESOLVER_REF_LOCAL set for params and declarations inside of routines
+typedef uint32_t resolver_ref_t;
+
+#define RESOLVER_REF_NONE ((resolver_ref_t) UINT32_MAX)
+#define RESOLVER_REF_LOCAL ((resolver_ref_t) 0x80000000u)
+
+#define RESOLVER_REF_IS_LOCAL(ref) (((ref) & RESOLVER_REF_LOCAL) != 0)
+#define RESOLVER_REF_INDEX(ref) ((ref) & ~RESOLVER_REF_LOCAL)
+
+// Contents of a slot, also kept in the undo log to be put back
+struct resolver_binding_t {
+    utils_intern_id_t name; // UTILS_INTERN_NONE if the slot is empty
+    resolver_ref_t ref;     // RESOLVER_REF_NONE if the name is not declared in any open scope
+    uint32_t depth;         // Depth of the scope of the declaration, 0 is the global scope
+    resolver_ref_t global;  // Declaration of the name in the global scope, RESOLVER_REF_NONE if there is none
+};
+typedef struct resolver_binding_t resolver_binding_t;
+
+UTILS_VEC_MAKE_DECLARATION(resolver_binding, struct resolver_binding_t)
+UTILS_VEC_MAKE_DECLARATION(resolver_mark, size_t)
+
+struct resolver_symtab_t {
+    size_t num_slots;               // Always a power of 2
+    size_t num_used;                // Slots with a name in them
+    resolver_binding_t* slots;
+
+    resolver_binding_vec_t undo;    // Bindings overwritten by the declarations in the open scopes, oldest first
+    resolver_mark_vec_t scopes;     // Length of the undo log when each of the open scopes was entered
+};
+typedef struct resolver_symtab_t resolver_symtab_t;
+
+// Starts with the global scope open, with room for about expected_names names before the slots grow
+void resolver_symtab_init(resolver_symtab_t* t, size_t expected_names);
+void resolver_symtab_deinit(resolver_symtab_t* t);
+
+// Opens a scope inside of the current one, the scope of a routine
+void resolver_symtab_enter(resolver_symtab_t* t);
+
+// Closes the current scope, the names declared in it refer to what they did before it was entered
+// The global scope cannot be closed
+void resolver_symtab_leave(resolver_symtab_t* t);
+
+// Declares the name in the current scope
+// Returns RESOLVER_REF_NONE if ok, or the earlier declaration of the name in the same scope (then nothing changes)
+resolver_ref_t resolver_symtab_declare(resolver_symtab_t* t, utils_intern_id_t name, resolver_ref_t ref);
+
+// Returns the declaration the name refers to in the current scope, RESOLVER_REF_NONE if it is not declared
+// in it nor in the global scope (declarations of the outer scopes in between are not visible)
+resolver_ref_t resolver_symtab_lookup(const resolver_symtab_t* t, utils_intern_id_t name);
+
+// Depth of the current scope, 0 for the global scope
+#define RESOLVER_SYMTAB_DEPTH(t) ((uint32_t) UTILS_VEC_LENGTH(&((t)->scopes)))
+
+#endif
@@ -0,0 +1,110 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// layout - Size, alignment and other target dependent properties of types
+
+#include "layout.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+const type_target_t type_target_x86_64 = {
+    .name = "x86_64",
+    .pointer_size = 8,
+    .pointer_align = 8,
+    .register_size = 8,
+    .max_align = 8,
+};
+
+// All the supported targets, searched by type_target_find()
+static const type_target_t* _targets[] = {
+    &type_target_x86_64,
+};
+
+#define TARGETS_NUM (sizeof(_targets) / sizeof(_targets[0]))
+
+const type_target_t* type_target_find(const char* name) {
+    for(size_t i = 0; i < TARGETS_NUM; i++) {
+        if(strcmp(_targets[i]->name, name) == 0) return _targets[i];
+    }
+
+    return NULL;
+}
+
+type_layout_cache_t* type_layout_cache_make(const type_target_t* target, const type_table_t* types) {
+    type_layout_cache_t* cache = malloc(sizeof(type_layout_cache_t));
+
+    cache->target = target;
+    cache->types = types;
+    cache->num_layouts = 0;
+    cache->layouts = NULL;
+
+    return cache;
+}
+
+void type_layout_cache_destroy(type_layout_cache_t* cache) {
+    if(cache == NULL) return;
+
+    free(cache->layouts);
+    free(cache);
+}
+
+// Computes the layout of a single type, none of the supported types needs the layout of its children
+void _type_layout_compute(const type_target_t* target, const type_info_t* type, type_layout_t* layout) {
+    layout->size = 0;
+    layout->alignment = 0;
+
+    switch(type->family) {
+        case TYPE_FAMILY_BUILTIN: {
+            layout->size = type->type_data.builtin.size;
+            layout->alignment = layout->size < target->max_align ? layout->size : target->max_align;
+            break;
+        }
+
+        case TYPE_FAMILY_POINTER: {
+            // Pointers to unsized types are still sized, the type pointed to does not matter
+            layout->size = target->pointer_size;
+            layout->alignment = target->pointer_align;
+            break;
+        }
+
+        // Routines can only be used through pointers, so they are unsized
+        default:
+            break;
+    }
+
+    layout->is_sized = layout->size != 0;
+    layout->is_native = layout->is_sized && layout->size <= target->register_size;
+    layout->is_computed = 1;
+}
+
+const type_layout_t* type_layout_of(type_layout_cache_t* cache, const type_info_t* type) {
+    // Types may be added to the table after the cache was made, so grow it to cover all of them
+    if(type->id >= cache->num_layouts) {
+        size_t num_layouts = cache->types->num_types;
+
+        cache->layouts = realloc(cache->layouts, num_layouts * sizeof(type_layout_t));
+        memset(cache->layouts + cache->num_layouts, 0, (num_layouts - cache->num_layouts) * sizeof(type_layout_t));
+        cache->num_layouts = num_layouts;
+    }
+
+    type_layout_t* layout = cache->layouts + type->id;
+    if(!layout->is_computed) {
+        _type_layout_compute(cache->target, type, layout);
+    }
+
+    return layout;
+}
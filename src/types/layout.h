@@ -0,0 +1,76 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// layout - Size, alignment and other target dependent properties of types
+
+// The properties of a type which depend on the target architecture are described by type_target_t,
+// there is one for every supported target (see type_target_find()). The layout of a type is
+// computed once per target and stored by the id of the type, since types are unique in their table.
+//
+// Following the design notes: every type is either sized or unsized (void, routines). A sized type
+// which fits into a register of the target is native, and only symbols of native types may be declared.
+
+#ifndef _I_TYPES_LAYOUT_H_
+#define _I_TYPES_LAYOUT_H_
+
+#include <stddef.h>
+
+#include "types.h"
+#include "type_table.h"
+
+// Description of a target architecture
+struct type_target_t {
+    const char* name;
+    size_t pointer_size;    // in bytes, same for all the pointers
+    size_t pointer_align;
+    size_t register_size;   // Biggest native type
+    size_t max_align;       // Builtins are aligned to their size, but at most to this
+};
+typedef struct type_target_t type_target_t;
+
+extern const type_target_t type_target_x86_64;
+
+// Target used if none is chosen
+#define TYPE_TARGET_DEFAULT (&type_target_x86_64)
+
+// Returns the target with the given name, or NULL if there is none
+const type_target_t* type_target_find(const char* name);
+
+struct type_layout_t {
+    size_t size;        // in bytes, 0 if unsized
+    size_t alignment;   // in bytes, 0 if unsized
+    int is_sized;
+    int is_native;      // Sized and fits into a register
+    int is_computed;    // Used by the cache, the rest is valid only if set
+};
+typedef struct type_layout_t type_layout_t;
+
+// Layouts of the types of one table for one target, computed when first asked for
+struct type_layout_cache_t {
+    const type_target_t* target;
+    const type_table_t* types;
+    size_t num_layouts;
+    type_layout_t* layouts; // Indexed by the type id
+};
+typedef struct type_layout_cache_t type_layout_cache_t;
+
+type_layout_cache_t* type_layout_cache_make(const type_target_t* target, const type_table_t* types);
+void type_layout_cache_destroy(type_layout_cache_t* cache);
+
+// Returns the layout of the type (from the table of the cache), valid until the next call
+const type_layout_t* type_layout_of(type_layout_cache_t* cache, const type_info_t* type);
+
+#endif
@@ -19,29 +19,7 @@
 #include "types.h"
 #include "type_list.h"
 
-// Make implementation of type_info_list_t (used in routine args)
-UTILS_LIST_MAKE_IMPLEMENTATION(type_info, struct type_info_t, 8, type_destroy)
+#include <string.h>
 
-void type_destroy(type_info_t* type) {
-    if(type == NULL || type->family == TYPE_FAMILY_BUILTIN) return;
-
-    switch(type->family) {
-        case TYPE_FAMILY_POINTER: {
-            type_destroy(type->type_data.pointer.type);
-            break;
-        }
-
-        case TYPE_FAMILY_ROUTINE: {
-            type_info_list_destroy(type->type_data.routine.args);
-            type_destroy(type->type_data.routine.return_type);
-            break;
-        }
-
-        default:
-            break;
-    }
-
-    free(type);
-
-    return;
-}
+// Make implementation of type_info_ptr_vec_t (used in routine args)
+UTILS_VEC_MAKE_SMALL_IMPLEMENTATION(type_info_ptr, struct type_info_t*, 16)
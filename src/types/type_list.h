@@ -21,13 +21,14 @@
 
 #include <stddef.h>
 
-#include "types.h"
-#include "utils/list.h"
+#include "utils/vec.h"
 
-// Declare a list of type_info_t, used in args of routine type_info_t
-UTILS_LIST_MAKE_DECLARATION(type_info, struct type_info_t)
+// Most routines take only a few args, those fit without allocating
+#define TYPE_ARGS_INLINE_SIZE 4
 
-// Deallocate memory owned by the type_info structure
-void type_destroy(struct type_info_t* type);
+// Declare a vec of pointers to type_info_t, used while collecting args of routine type_info_t
+// The vec only references the types, which are owned by an arena
+struct type_info_t;
+UTILS_VEC_MAKE_SMALL_DECLARATION(type_info_ptr, struct type_info_t*, TYPE_ARGS_INLINE_SIZE)
 
 #endif
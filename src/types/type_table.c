@@ -0,0 +1,365 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// type_table - Table of unique types, each structural type is stored exactly once
+
+#include "type_table.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "utils/arena.h"
+#include "utils/vec.h"
+
+#define DEFAULT_TYPES_ALLOC 64
+#define DEFAULT_SLOTS_NUM 128
+
+// FNV-1a over 32 bit words instead of bytes, children are hashed by their ids
+#define TYPE_HASH_INIT ((uint32_t) 2166136261u)
+#define TYPE_HASH_STEP(hash, word) (((hash) ^ (uint32_t) (word)) * (uint32_t) 16777619u)
+
+uint32_t _type_table_hash(const type_info_t* key) {
+    uint32_t hash = TYPE_HASH_STEP(TYPE_HASH_INIT, key->family);
+
+    switch(key->family) {
+        case TYPE_FAMILY_POINTER: {
+            hash = TYPE_HASH_STEP(hash, key->type_data.pointer.type->id);
+            break;
+        }
+
+        case TYPE_FAMILY_ROUTINE: {
+            const type_info_routine_t* rt = &(key->type_data.routine);
+
+            // "rt []: t" and "rt: t" are different types, so the missing list is hashed differently than an empty one
+            hash = TYPE_HASH_STEP(hash, rt->args == NULL ? UINT32_MAX : (uint32_t) rt->num_args);
+            for(size_t i = 0; i < rt->num_args; i++) {
+                hash = TYPE_HASH_STEP(hash, rt->args[i]->id);
+            }
+            hash = TYPE_HASH_STEP(hash, rt->return_type->id);
+            break;
+        }
+
+        default: {
+            // Builtins are unique already, their id is enough
+            hash = TYPE_HASH_STEP(hash, key->id);
+            break;
+        }
+    }
+
+    return hash;
+}
+
+// Children are unique, so comparing them by pointer is enough, there is no need to recurse
+int _type_table_equal(const type_info_t* a, const type_info_t* b) {
+    if(a->family != b->family) return 0;
+
+    switch(a->family) {
+        case TYPE_FAMILY_POINTER: {
+            return a->type_data.pointer.type == b->type_data.pointer.type;
+        }
+
+        case TYPE_FAMILY_ROUTINE: {
+            const type_info_routine_t* a_rt = &(a->type_data.routine);
+            const type_info_routine_t* b_rt = &(b->type_data.routine);
+
+            if((a_rt->args == NULL) != (b_rt->args == NULL)) return 0;
+            if(a_rt->num_args != b_rt->num_args) return 0;
+            if(a_rt->return_type != b_rt->return_type) return 0;
+
+            for(size_t i = 0; i < a_rt->num_args; i++) {
+                if(a_rt->args[i] != b_rt->args[i]) return 0;
+            }
+
+            return 1;
+        }
+
+        default:
+            return a == b;
+    }
+}
+
+// Returns the slot which holds the type, or the empty slot where it should go
+size_t _type_table_probe(const type_table_t* table, const type_info_t* key, uint32_t hash) {
+    size_t mask = table->num_slots - 1;
+    size_t slot = hash & mask;
+
+    while(1) {
+        type_id_t id = table->slots[slot];
+
+        if(id == TYPE_ID_NONE) return slot;
+
+        if(table->hashes[id] == hash && _type_table_equal(table->types[id], key)) {
+            return slot;
+        }
+
+        slot = (slot + 1) & mask;
+    }
+}
+
+// Doubles the number of slots and puts every id back, using the stored hashes
+void _type_table_grow_slots(type_table_t* table) {
+    free(table->slots);
+
+    table->num_slots *= 2;
+    table->slots = malloc(table->num_slots * sizeof(type_id_t));
+    memset(table->slots, 0xFF, table->num_slots * sizeof(type_id_t));
+
+    size_t mask = table->num_slots - 1;
+    for(type_id_t id = 0; id < table->num_types; id++) {
+        size_t slot = table->hashes[id] & mask;
+
+        while(table->slots[slot] != TYPE_ID_NONE) {
+            slot = (slot + 1) & mask;
+        }
+
+        table->slots[slot] = id;
+    }
+}
+
+// Puts the type into the slot and gives it the next id
+void _type_table_insert(type_table_t* table, type_info_t* type, uint32_t hash, size_t slot) {
+    if(table->num_types >= table->alloc_types) {
+        table->alloc_types *= 2;
+        table->types = realloc(table->types, table->alloc_types * sizeof(type_info_t*));
+        table->hashes = realloc(table->hashes, table->alloc_types * sizeof(uint32_t));
+        table->strings = realloc(table->strings, table->alloc_types * sizeof(const char*));
+        table->lengths = realloc(table->lengths, table->alloc_types * sizeof(uint32_t));
+    }
+
+    type_id_t id = (type_id_t) table->num_types;
+    table->types[id] = type;
+    table->hashes[id] = hash;
+    table->strings[id] = NULL;
+    table->num_types += 1;
+
+    table->slots[slot] = id;
+
+    // Keep the table at most half full, so the probe sequences stay short
+    if(table->num_types * 2 > table->num_slots) {
+        _type_table_grow_slots(table);
+    }
+}
+
+type_table_t* type_table_make() {
+    type_table_t* table = malloc(sizeof(type_table_t));
+
+    table->num_types = 0;
+    table->alloc_types = DEFAULT_TYPES_ALLOC;
+    table->types = malloc(table->alloc_types * sizeof(type_info_t*));
+    table->hashes = malloc(table->alloc_types * sizeof(uint32_t));
+    table->strings = malloc(table->alloc_types * sizeof(const char*));
+    table->lengths = malloc(table->alloc_types * sizeof(uint32_t));
+    utils_strbuf_init(&(table->scratch));
+
+    table->num_slots = DEFAULT_SLOTS_NUM;
+    table->slots = malloc(table->num_slots * sizeof(type_id_t));
+    memset(table->slots, 0xFF, table->num_slots * sizeof(type_id_t)); // TYPE_ID_NONE everywhere
+
+    table->storage = utils_arena_make();
+
+    // Builtins go in first and in order, so that their ids match their positions
+    for(type_id_t id = 0; id < TYPE_BUILTINS_NUM; id++) {
+        type_info_t* builtin = type_get_builtin_by_id(id);
+        uint32_t hash = _type_table_hash(builtin);
+
+        _type_table_insert(table, builtin, hash, _type_table_probe(table, builtin, hash));
+    }
+
+    return table;
+}
+
+void type_table_destroy(type_table_t* table) {
+    if(table == NULL) return;
+
+    utils_arena_destroy(table->storage);
+    free(table->types);
+    free(table->hashes);
+    free(table->strings);
+    free(table->lengths);
+    utils_strbuf_deinit(&(table->scratch));
+    free(table->slots);
+    free(table);
+}
+
+type_info_t* type_table_add(type_table_t* table, const type_info_t* key) {
+    uint32_t hash = _type_table_hash(key);
+    size_t slot = _type_table_probe(table, key, hash);
+
+    if(table->slots[slot] != TYPE_ID_NONE) return table->types[table->slots[slot]];
+
+    // New type, the key (and its args) may live on the stack of the caller, so copy it
+    type_info_t* type = UTILS_ARENA_NEW(table->storage, type_info_t);
+    *type = *key;
+    type->id = (type_id_t) table->num_types;
+
+    if(type->family == TYPE_FAMILY_ROUTINE && key->type_data.routine.args != NULL) {
+        size_t args_size = key->type_data.routine.num_args * sizeof(type_info_t*);
+
+        type->type_data.routine.args = utils_arena_alloc(table->storage, args_size);
+        memcpy(type->type_data.routine.args, key->type_data.routine.args, args_size);
+    }
+
+    _type_table_insert(table, type, hash, slot);
+
+    return type;
+}
+
+void type_table_merge(type_table_t* table, const type_table_t* part, type_id_t* ids) {
+    type_info_ptr_vec_t args;
+    type_info_ptr_vec_init(&args);
+
+    // Builtins are the same in every table
+    for(size_t id = 0; id < part->num_types && id < TYPE_BUILTINS_NUM; id++) {
+        ids[id] = (type_id_t) id;
+    }
+
+    // Children have lower ids, so they are already in the table when the types built from them are added
+    for(size_t id = TYPE_BUILTINS_NUM; id < part->num_types; id++) {
+        const type_info_t* type = part->types[id];
+        type_info_t key = *type;
+
+        if(type->family == TYPE_FAMILY_POINTER) {
+            key.type_data.pointer.type = table->types[ids[type->type_data.pointer.type->id]];
+        } else if(type->family == TYPE_FAMILY_ROUTINE) {
+            const type_info_routine_t* rt = &(type->type_data.routine);
+            key.type_data.routine.return_type = table->types[ids[rt->return_type->id]];
+
+            if(rt->args != NULL) {
+                type_info_ptr_vec_truncate(&args, 0);
+                for(size_t i = 0; i < rt->num_args; i++) {
+                    type_info_ptr_vec_push(&args, table->types[ids[rt->args[i]->id]]);
+                }
+
+                key.type_data.routine.args = args.arr;
+            }
+        }
+
+        ids[id] = type_table_add(table, &key)->id;
+    }
+
+    type_info_ptr_vec_deinit(&args);
+}
+
+// Types waiting for their children to be rendered
+UTILS_VEC_MAKE_SMALL_DECLARATION(_type_table_pending, const type_info_t*, 16)
+UTILS_VEC_MAKE_SMALL_IMPLEMENTATION(_type_table_pending, const type_info_t*, 64)
+
+// Appends the already rendered child type
+void _type_table_append_string(type_table_t* table, const type_info_t* type) {
+    utils_strbuf_append(&(table->scratch), table->strings[type->id], table->lengths[type->id]);
+}
+
+// Pushes the children of the type which are not rendered yet, returns how many were pushed
+size_t _type_table_push_unrendered(type_table_t* table, _type_table_pending_vec_t* stack, const type_info_t* type) {
+    size_t num_pushed = 0;
+
+    if(type->family == TYPE_FAMILY_POINTER) {
+        if(table->strings[type->type_data.pointer.type->id] == NULL) {
+            _type_table_pending_vec_push(stack, type->type_data.pointer.type);
+            num_pushed++;
+        }
+    } else if(type->family == TYPE_FAMILY_ROUTINE) {
+        const type_info_routine_t* rt = &(type->type_data.routine);
+
+        for(size_t i = 0; i < rt->num_args; i++) {
+            if(table->strings[rt->args[i]->id] == NULL) {
+                _type_table_pending_vec_push(stack, rt->args[i]);
+                num_pushed++;
+            }
+        }
+
+        if(table->strings[rt->return_type->id] == NULL) {
+            _type_table_pending_vec_push(stack, rt->return_type);
+            num_pushed++;
+        }
+    }
+
+    return num_pushed;
+}
+
+// Renders the type into its string, all of its children have to be rendered already
+void _type_table_render(type_table_t* table, const type_info_t* type) {
+    utils_strbuf_clear(&(table->scratch));
+
+    switch(type->family) {
+        case TYPE_FAMILY_POINTER: {
+            utils_strbuf_append_char(&(table->scratch), '>');
+            _type_table_append_string(table, type->type_data.pointer.type);
+            break;
+        }
+
+        case TYPE_FAMILY_ROUTINE: {
+            const type_info_routine_t* rt = &(type->type_data.routine);
+
+            utils_strbuf_append(&(table->scratch), "rt ", 3);
+
+            if(rt->args != NULL) {
+                utils_strbuf_append_char(&(table->scratch), '[');
+
+                for(size_t i = 0; i < rt->num_args; i++) {
+                    if(i != 0) utils_strbuf_append(&(table->scratch), ", ", 2);
+                    _type_table_append_string(table, rt->args[i]);
+                }
+
+                utils_strbuf_append_char(&(table->scratch), ']');
+            }
+
+            utils_strbuf_append(&(table->scratch), ": ", 2);
+            _type_table_append_string(table, rt->return_type);
+            break;
+        }
+
+        default: {
+            // Builtins have nothing to reuse
+            type_write_string(&(table->scratch), type);
+            break;
+        }
+    }
+
+    size_t length = UTILS_STRBUF_LENGTH(&(table->scratch));
+    char* str = utils_arena_alloc_bytes(table->storage, length + 1);
+    memcpy(str, UTILS_STRBUF_DATA(&(table->scratch)), length + 1);
+
+    table->strings[type->id] = str;
+    table->lengths[type->id] = (uint32_t) length;
+}
+
+// Children are rendered before their parents, from an explicit stack so that deep types do not recurse
+// A type can be on the stack twice (like an arg repeated), then the second time it is already rendered
+const char* type_table_to_string(type_table_t* table, const type_info_t* type) {
+    if(table->strings[type->id] != NULL) return table->strings[type->id];
+
+    _type_table_pending_vec_t stack;
+    _type_table_pending_vec_init(&stack);
+
+    _type_table_pending_vec_push(&stack, type);
+
+    while(UTILS_VEC_LENGTH(&stack) > 0) {
+        const type_info_t* top = UTILS_VEC_AT(&stack, UTILS_VEC_LENGTH(&stack) - 1);
+
+        if(table->strings[top->id] != NULL) {
+            _type_table_pending_vec_pop(&stack);
+        } else if(_type_table_push_unrendered(table, &stack, top) == 0) {
+            _type_table_render(table, top);
+            _type_table_pending_vec_pop(&stack);
+        }
+    }
+
+    _type_table_pending_vec_deinit(&stack);
+
+    return table->strings[type->id];
+}
@@ -0,0 +1,75 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// type_table - Table of unique types, each structural type is stored exactly once
+
+// Pointer and routine types are hash-consed: a type is looked up by its family and the ids
+// of the types it is built from, and a new type_info_t is only made if an identical one is
+// not in the table yet. Since the children are unique as well, two types are structurally
+// the same if and only if they are the same pointer (or have the same id). That also means that
+// anything computed for a type (like its string) can be stored once per id.
+//
+// Builtin types are put into the table first, so their ids are the indices into the array
+// of builtins (which also match the ids of their names, see type_intern_builtins()).
+// All the other types are allocated from the arena of the table and live as long as it does.
+
+#ifndef _I_TYPES_TYPE_TABLE_H_
+#define _I_TYPES_TYPE_TABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "types.h"
+#include "utils/arena.h"
+#include "utils/strbuf.h"
+
+struct type_table_t {
+    size_t num_types;
+    size_t alloc_types;
+    type_info_t** types;    // Every unique type, indexed by id
+    uint32_t* hashes;       // Hash of every type, so that the slots can be rebuilt without rehashing
+
+    size_t num_slots;       // Always a power of 2
+    type_id_t* slots;       // Open addressing hash table of ids, TYPE_ID_NONE if empty
+
+    const char** strings;   // Rendered type by id, NULL until it is asked for
+    uint32_t* lengths;      // Lengths of the rendered types
+    utils_strbuf_t scratch; // The type being rendered is built here before it is stored
+
+    utils_arena_t* storage; // Storage for the types, their arrays of args and the rendered strings
+};
+typedef struct type_table_t type_table_t;
+
+type_table_t* type_table_make();
+void type_table_destroy(type_table_t* table);
+
+// Returns the unique type which is structurally the same as key, adding a copy of it if there is none yet
+// Children of the key (pointed to type, args, return type) have to come from the same table
+type_info_t* type_table_add(type_table_t* table, const type_info_t* key);
+
+// Adds every type of part (another table) to the table, ids[id] is set to the id in the table of the type with the id in part
+// Types new to the table are added in the order of their ids in part, so merging the tables of consecutive parts of
+// a source gives the same ids as one table filled with the whole source
+void type_table_merge(type_table_t* table, const type_table_t* part, type_id_t* ids);
+
+// Returns the type as a string, the way it is written in the source (owned by the table)
+// Every type is rendered once, then the string is reused, also when it is a part of a bigger type
+const char* type_table_to_string(type_table_t* table, const type_info_t* type);
+
+// Type with the given id, valid until the table is destroyed
+#define TYPE_TABLE_GET(table, id) ((table)->types[id])
+
+#endif
@@ -21,237 +21,255 @@
 #include <string.h>
 #include <stdlib.h>
 
-#include "utils/list.h"
+#include "utils/vec.h"
+#include "utils/intern.h"
+#include "utils/strbuf.h"
+#include "type_table.h"
 
 // An array defining basic builtin types
 static type_info_t _builtin_types[] = {
     {
         .family = TYPE_FAMILY_BUILTIN,
+        .id = 0,
         .type_data.builtin = {
             .name = "void",
+            .size = 0,
+            .is_signed = 0,
         }
     },
     {
         .family = TYPE_FAMILY_BUILTIN,
+        .id = 1,
         .type_data.builtin = {
             .name = "bool",
+            .size = 1,
+            .is_signed = 0,
         }
     },
     {
         .family = TYPE_FAMILY_BUILTIN,
+        .id = 2,
         .type_data.builtin = {
             .name = "char",
+            .size = 1,
+            .is_signed = 0,
         }
     },
     {
         .family = TYPE_FAMILY_BUILTIN,
+        .id = 3,
         .type_data.builtin = {
             .name = "u8",
+            .size = 1,
+            .is_signed = 0,
         }
     },
     {
         .family = TYPE_FAMILY_BUILTIN,
+        .id = 4,
         .type_data.builtin = {
             .name = "i8",
+            .size = 1,
+            .is_signed = 1,
         }
     },
     {
         .family = TYPE_FAMILY_BUILTIN,
+        .id = 5,
         .type_data.builtin = {
             .name = "u16",
+            .size = 2,
+            .is_signed = 0,
         }
     },
     {
         .family = TYPE_FAMILY_BUILTIN,
+        .id = 6,
         .type_data.builtin = {
             .name = "i16",
+            .size = 2,
+            .is_signed = 1,
         }
     },
     {
         .family = TYPE_FAMILY_BUILTIN,
+        .id = 7,
         .type_data.builtin = {
             .name = "u32",
+            .size = 4,
+            .is_signed = 0,
         }
     },
     {
         .family = TYPE_FAMILY_BUILTIN,
+        .id = 8,
         .type_data.builtin = {
             .name = "i32",
+            .size = 4,
+            .is_signed = 1,
         }
     },
     {
         .family = TYPE_FAMILY_BUILTIN,
+        .id = 9,
         .type_data.builtin = {
             .name = "u64",
+            .size = 8,
+            .is_signed = 0,
         }
     },
     {
         .family = TYPE_FAMILY_BUILTIN,
+        .id = 10,
         .type_data.builtin = {
             .name = "i64",
+            .size = 8,
+            .is_signed = 1,
         }
     },
 };
 
 #define BUILTIN_TYPES_NUM (sizeof(_builtin_types) / sizeof(_builtin_types[0]))
 
-// returns static struct ptr
-type_info_t* type_get_builtin_by_name(char* name) {
+// Fails to compile if TYPE_BUILTINS_NUM does not match the array above (the ids have to match the positions too)
+typedef char _builtin_types_num_check[(BUILTIN_TYPES_NUM == TYPE_BUILTINS_NUM) ? 1 : -1];
+
+void type_intern_builtins(utils_intern_table_t* names) {
     for(size_t i = 0; i < BUILTIN_TYPES_NUM; i++) {
-        type_info_t* ptr = _builtin_types + i;
+        const char* name = _builtin_types[i].type_data.builtin.name;
+        size_t length = strlen(name);
+
+        utils_intern_string(names, name, length, utils_intern_hash(name, length));
+    }
+}
 
-        if(strcmp(ptr->type_data.builtin.name, name) == 0) {
-            return ptr;
-        };
+// returns static struct ptr
+type_info_t* type_get_builtin_by_id(utils_intern_id_t id) {
+    // Builtin names were interned first, so their ids are the indices into the array
+    if(id < BUILTIN_TYPES_NUM) {
+        return _builtin_types + id;
     }
 
     return NULL;
 }
 
-// returns dynamic struct ptr
-type_info_t* type_make_pointer_to(type_info_t* type) {
-    type_info_t* new_type = malloc(sizeof(type_info_t));
+// returns table struct ptr
+type_info_t* type_make_pointer_to(type_table_t* types, type_info_t* type) {
+    type_info_t key = {
+        .family = TYPE_FAMILY_POINTER,
+        .id = TYPE_ID_NONE,
+        .type_data.pointer.type = type,
+    };
 
-    new_type->family = TYPE_FAMILY_POINTER;
-    new_type->type_data.pointer.type = type;
-    return new_type;
+    return type_table_add(types, &key);
 }
 
-// returns dynamic struct ptr, args has to be dynamically allocated by caller
-type_info_t* type_make_routine(type_info_list_t* args, type_info_t* ret) {
-    type_info_t* new_type = malloc(sizeof(type_info_t));
+// returns table struct ptr, args are copied if the type is new
+type_info_t* type_make_routine_from(type_table_t* types, type_info_t** args, size_t num_args, type_info_t* ret) {
+    type_info_t key = {
+        .family = TYPE_FAMILY_ROUTINE,
+        .id = TYPE_ID_NONE,
+        .type_data.routine = {
+            .args = args,
+            .num_args = args != NULL ? num_args : 0,
+            .return_type = ret,
+        },
+    };
+
+    // The key only borrows the args, the table makes its own copy
+    return type_table_add(types, &key);
+}
 
-    new_type->family = TYPE_FAMILY_ROUTINE;
-    new_type->type_data.routine.args = args;
-    new_type->type_data.routine.return_type = ret;
+type_info_t* type_make_routine(type_table_t* types, type_info_ptr_vec_t* args, type_info_t* ret) {
+    if(args == NULL) {
+        return type_make_routine_from(types, NULL, 0, ret);
+    }
 
-    return new_type;
+    return type_make_routine_from(types, args->arr, UTILS_VEC_LENGTH(args), ret);
 }
 
+// All types are unique in their table, so structurally the same types are the same pointers
 int type_are_the_same(type_info_t* a, type_info_t* b) {
-    if(a == NULL || b == NULL) return 0;
-
-    if(a->family != b->family) return 0;
-
-    switch(a->family) {
-        case TYPE_FAMILY_BUILTIN: {
-            //return strcmp(a->type_data.native.name, b->type_data.native.name) == 0; // <- this should be used if we copy builtin data type structures
-            return a == b; // If we dont copy, but rather return pointers to static structures, then it should be enough to compare pointers
-        }
-
-        case TYPE_FAMILY_POINTER: {
-            return type_are_the_same(a->type_data.pointer.type, a->type_data.pointer.type);
-        }
-
-        case TYPE_FAMILY_ROUTINE: {
-            type_info_routine_t* a_rt = &(a->type_data.routine);
-            type_info_routine_t* b_rt = &(b->type_data.routine);
-
-            int a_args_empty = (a_rt->args == NULL) || (UTILS_LIST_GENERIC_LENGTH(a_rt->args) == 0);
-            int b_args_empty = (b_rt->args == NULL) || (UTILS_LIST_GENERIC_LENGTH(b_rt->args) == 0);
-            if(a_args_empty && b_args_empty) return 1;
-
-            if(a_args_empty) return 0;
-            if(b_args_empty) return 0;
-
-            if(UTILS_LIST_GENERIC_LENGTH(a_rt->args) != UTILS_LIST_GENERIC_LENGTH(b_rt->args)) return 0;
-
-            for(size_t i = 0; i < UTILS_LIST_GENERIC_LENGTH(a_rt->args); i++) {
-                if(!type_are_the_same(UTILS_LIST_GENERIC_GET(a_rt->args, i), UTILS_LIST_GENERIC_GET(a_rt->args, i))) return 0;
-            }
-
-            return a_rt->return_type == b_rt->return_type;
-        }
-
-        default:
-            return 0;
-    }
+    return a != NULL && a == b;
 }
 
-// Walks through the type tree and builds a string buffer
-char* type_to_string(type_info_t* type) {
-    if(type == NULL) return NULL;
+// Pending piece of output: either a type to write, or a fixed text (if type is NULL)
+struct _type_write_item_t {
+    const type_info_t* type;
+    const char* text;
+};
 
-    switch(type->family) {
-        case TYPE_FAMILY_BUILTIN: {
-            char* name = malloc(strlen(type->type_data.builtin.name) + 1);
-            strcpy(name, type->type_data.builtin.name);
-            return name;
-        }
+UTILS_VEC_MAKE_SMALL_DECLARATION(_type_write_item, struct _type_write_item_t, 16)
+UTILS_VEC_MAKE_SMALL_IMPLEMENTATION(_type_write_item, struct _type_write_item_t, 64)
 
-        case TYPE_FAMILY_POINTER: {
-            char* inner_type = type_to_string(type->type_data.pointer.type);
-            char* name = malloc(strlen(inner_type) + 2);
+#define TYPE_WRITE_TEXT(stack, str) _type_write_item_vec_push((stack), (struct _type_write_item_t) { .type = NULL, .text = (str) })
+#define TYPE_WRITE_TYPE(stack, t) _type_write_item_vec_push((stack), (struct _type_write_item_t) { .type = (t), .text = NULL })
 
-            strcpy(name + 1, inner_type);
-            name[0] = '>';
-            name[1 + strlen(inner_type)] = '\0';
+// Walks through the type tree once, appending to the buffer
+// Uses an explicit stack instead of recursion, so nesting depth is not limited by the call stack
+// Pieces are pushed in reverse, so they are popped in the order in which they are written
+void type_write_string(utils_strbuf_t* buf, const type_info_t* type) {
+    _type_write_item_vec_t stack;
+    _type_write_item_vec_init(&stack);
 
-            free(inner_type);
-            return name;
-        }
+    TYPE_WRITE_TYPE(&stack, type);
 
-        case TYPE_FAMILY_ROUTINE: {
-            // TODO: This traverses the arg list twice, maybe its not needed?
-            type_info_routine_t* rt = &(type->type_data.routine);
+    while(UTILS_VEC_LENGTH(&stack) > 0) {
+        struct _type_write_item_t item = _type_write_item_vec_pop(&stack);
 
-            size_t args_string_length = 0;
-            if(rt->args != NULL) {
-                args_string_length = (UTILS_LIST_GENERIC_LENGTH(rt->args) - 1) * 2; // In the arg list, args are separated by ", "
+        if(item.type == NULL) {
+            utils_strbuf_append_cstr(buf, item.text);
+            continue;
+        }
 
-                for(size_t i = 0; i < UTILS_LIST_GENERIC_LENGTH(rt->args); i++) {
-                    char* arg_type_name = type_to_string(UTILS_LIST_GENERIC_GET(rt->args, i));
-                    args_string_length += strlen(arg_type_name);
-                    free(arg_type_name);
-                }
+        switch(item.type->family) {
+            case TYPE_FAMILY_BUILTIN: {
+                utils_strbuf_append_cstr(buf, item.type->type_data.builtin.name);
+                break;
             }
 
-            char* return_type_str = type_to_string(rt->return_type);
-            size_t ret_type_len = strlen(return_type_str);
-            free(return_type_str);
-
-            // 4 for "rt [ ", then args string length, then 4 for " ]: " then length of the return type + 1 for null byte
-            char* name = malloc(10 + args_string_length + ret_type_len);
-
-            size_t offset = 0;
+            case TYPE_FAMILY_POINTER: {
+                utils_strbuf_append_char(buf, '>');
+                TYPE_WRITE_TYPE(&stack, item.type->type_data.pointer.type);
+                break;
+            }
 
-            memcpy(name + offset, "rt ", 3);
-            offset += 3;
+            case TYPE_FAMILY_ROUTINE: {
+                const type_info_routine_t* rt = &(item.type->type_data.routine);
 
-            if(rt->args != NULL) {
-                name[offset] = '[';
-                offset++;
+                utils_strbuf_append(buf, "rt ", 3);
 
-                for(size_t i = 0; i < UTILS_LIST_GENERIC_LENGTH(rt->args); i++) {
-                    char* arg_type_name = type_to_string(UTILS_LIST_GENERIC_GET(rt->args, i));
+                TYPE_WRITE_TYPE(&stack, rt->return_type);
+                TYPE_WRITE_TEXT(&stack, ": ");
 
-                    strcpy(name + offset, arg_type_name);
-                    offset += strlen(arg_type_name);
+                if(rt->args != NULL) {
+                    TYPE_WRITE_TEXT(&stack, "]");
 
-                    if(i != UTILS_LIST_GENERIC_LENGTH(rt->args) - 1) {
-                        memcpy(name + offset, ", ", 2);
-                        offset += 2;
+                    for(size_t i = rt->num_args; i > 0; i--) {
+                        TYPE_WRITE_TYPE(&stack, rt->args[i - 1]);
+                        if(i != 1) TYPE_WRITE_TEXT(&stack, ", ");
                     }
 
-                    free(arg_type_name);
+                    utils_strbuf_append_char(buf, '[');
                 }
-
-                name[offset] = ']';
-                offset++;
+                break;
             }
 
-            memcpy(name + offset, ": ", 2);
-            offset += 2;
-
-            char* return_type_name = type_to_string(rt->return_type);
-            strcpy(name + offset, return_type_name);
-            free(return_type_name);
-
-            return name;
+            default:
+                break;
         }
-
-        default:
-            return NULL;
     }
+
+    _type_write_item_vec_deinit(&stack);
 }
 
+char* type_to_string(type_info_t* type) {
+    if(type == NULL) return NULL;
+
+    utils_strbuf_t buf;
+    utils_strbuf_init(&buf);
+
+    type_write_string(&buf, type);
+
+    return utils_strbuf_release(&buf);
+}
@@ -27,17 +27,22 @@
 // for the type being pointed to, for routine thats the types of the args
 // and return type and for builtin types thats the name.
 // The functions at the bottom of this file are meant to ease the process
-// of creating type_infos and destroying them when they are not needed.
-// All type_info_t are allocated cynamically, except for builtin types
-// which are statically defined in one of the source codes.
+// of creating type_infos. Every type_info_t is unique (see type_table.h),
+// so the same type written twice in the source is the same structure.
+// Builtin types are statically defined in one of the source codes, all the
+// other ones are allocated from the arena of a type table and are never
+// freed one by one, only all at once with the table.
 
 #ifndef _I_TYPES_TYPES_H_
 #define _I_TYPES_TYPES_H_
 
 #include <stddef.h>
 #include <string.h>
+#include <stdint.h>
 
 #include "type_list.h"
+#include "utils/intern.h"
+#include "utils/strbuf.h"
 
 #define TYPE_FAMILY_VOID 0
 #define TYPE_FAMILY_BUILTIN 1 // TODO: Add support for floating point
@@ -46,17 +51,29 @@
 //#define TYPE_FAMILY_STRUCT 4 TODO: Add support for structs
 //#define TYPE_FAMILY_ALIAS 5 TODO: Add support for type aliasing
 
+// Types are numbered in the order they are added to their table
+typedef uint32_t type_id_t;
+
+// Id which no type ever gets
+#define TYPE_ID_NONE ((type_id_t) UINT32_MAX)
+
+// Number of builtin types, those have the ids from 0 to TYPE_BUILTINS_NUM - 1
+#define TYPE_BUILTINS_NUM 11
+
 // Structure describing any basic builtin data type, including
 // integers, void, bools, chars, floats (in the future)
-// TODO: Maybe should add signedness etc?
+// Sizes of builtins are the same on every target, everything else about the layout is in layout.h
 struct type_info_builtin_t {
     char* name;
+    size_t size; // in bytes, 0 if unsized (void)
+    int is_signed;
 };
 typedef struct type_info_builtin_t type_info_builtin_t;
 
 // Structure describing a routine type (only usable through a pointer)
 struct type_info_routine_t {
-    struct type_info_list_t* args;
+    struct type_info_t** args; // NULL if the routine has no argument list at all
+    size_t num_args;
     struct type_info_t* return_type;
 };
 typedef struct type_info_routine_t type_info_routine_t;
@@ -69,7 +86,7 @@ typedef struct type_info_pointer_t type_info_pointer_t;
 
 struct type_info_t {
     int family;
-    size_t size; // in bytes
+    type_id_t id; // Unique in the table, same ids mean the same type
     union {
         type_info_builtin_t builtin;
         type_info_routine_t routine;
@@ -78,21 +95,35 @@ struct type_info_t {
 };
 typedef struct type_info_t type_info_t;
 
-// All the below functions take ownership of their arguments (Aside from char* name in get builtin) and later those are freed by type_destroy
+struct type_table_t;
+
+// Types returned by the below functions are unique in the table, and live as long as it does
 
-// Returns pointer to a statically allocated structure of a builtin type (or NULL if not found)
-type_info_t* type_get_builtin_by_name(char* name);
+// Interns names of all builtin types, has to be called on an empty table before anything else is interned
+// so that the ids of the names match the builtin types
+void type_intern_builtins(utils_intern_table_t* names);
 
-// Returns pointer to a dynamically allocated structure, which represents a pointer to type in argument
-type_info_t* type_make_pointer_to(type_info_t* type);
+// Returns pointer to a statically allocated structure of a builtin type (or NULL if it's not a builtin)
+// The id is the one of the interned name of the type, in the table prepared with type_intern_builtins()
+type_info_t* type_get_builtin_by_id(utils_intern_id_t id);
 
-// Returns pointer to a dynamically allocated structure, which represents a routine. args has to be dynamically allocated.
-// It is te obligation of the caller to allocate it/create it.
-type_info_t* type_make_routine(struct type_info_list_t* args, type_info_t* ret);
+// Returns pointer to a structure, which represents a pointer to type in argument
+type_info_t* type_make_pointer_to(struct type_table_t* types, type_info_t* type);
 
-// Compare two types to make sure they are the same
+// Returns pointer to a structure, which represents a routine. args are copied into the table if the type is new,
+// the vec itself still belongs to the caller (NULL if there is no argument list)
+type_info_t* type_make_routine(struct type_table_t* types, struct type_info_ptr_vec_t* args, type_info_t* ret);
+
+// Same as above, but with the args in an array (NULL if there is no argument list, an empty list is any other pointer)
+type_info_t* type_make_routine_from(struct type_table_t* types, type_info_t** args, size_t num_args, type_info_t* ret);
+
+// Compare two types to make sure they are the same, both have to come from the same table
 int type_are_the_same(type_info_t* a, type_info_t* b);
 
+// Appends the type, the way it is written in the source, to the buffer
+void type_write_string(utils_strbuf_t* buf, const type_info_t* type);
+
+// Returns the type as a new string, which has to be freed by the caller (see also type_table_to_string())
 char* type_to_string(type_info_t* type);
 
 #endif
@@ -0,0 +1,121 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// arena - Region allocator, everything allocated from an arena is freed at once with it
+
+#include "arena.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+
+// Blocks double in size up to the maximum, so that small arenas stay small and big ones
+// do not end up with a long list of blocks
+#define FIRST_BLOCK_SIZE ((size_t) 4096)
+#define MAX_BLOCK_SIZE ((size_t) 1024 * 1024)
+
+struct utils_arena_block_t {
+    struct utils_arena_block_t* prev;
+    size_t used;
+    size_t size;
+    char data[];
+};
+
+utils_arena_t* utils_arena_make() {
+    utils_arena_t* arena = malloc(sizeof(utils_arena_t));
+
+    arena->blocks = NULL;
+    arena->total_size = 0;
+    arena->num_allocs = 0;
+    arena->allocated_size = 0;
+
+    return arena;
+}
+
+void utils_arena_destroy(utils_arena_t* arena) {
+    if(arena == NULL) return;
+
+    struct utils_arena_block_t* block = arena->blocks;
+    while(block != NULL) {
+        struct utils_arena_block_t* prev = block->prev;
+        free(block);
+        block = prev;
+    }
+
+    free(arena);
+}
+
+// Adds a new block to the arena, which has room for at least size bytes (plus alignment)
+void _utils_arena_grow(utils_arena_t* arena, size_t size) {
+    size_t block_size = arena->blocks != NULL ? arena->blocks->size * 2 : FIRST_BLOCK_SIZE;
+    if(block_size > MAX_BLOCK_SIZE) block_size = MAX_BLOCK_SIZE;
+
+    // Huge allocations get a block of their own
+    if(block_size < size + UTILS_ARENA_ALIGNMENT) block_size = size + UTILS_ARENA_ALIGNMENT;
+
+    struct utils_arena_block_t* block = malloc(sizeof(struct utils_arena_block_t) + block_size);
+    block->prev = arena->blocks;
+    block->used = 0;
+    block->size = block_size;
+
+    arena->blocks = block;
+    arena->total_size += block_size;
+}
+
+void* utils_arena_alloc_bytes(utils_arena_t* arena, size_t size) {
+    struct utils_arena_block_t* block = arena->blocks;
+
+    if(block == NULL || block->size - block->used < size) {
+        _utils_arena_grow(arena, size);
+        block = arena->blocks;
+    }
+
+    void* ptr = block->data + block->used;
+    block->used += size;
+
+    arena->num_allocs += 1;
+    arena->allocated_size += size;
+
+    return ptr;
+}
+
+void* utils_arena_alloc(utils_arena_t* arena, size_t size) {
+    struct utils_arena_block_t* block = arena->blocks;
+
+    // Padding needed to align the next allocation in the current block
+    size_t padding = 0;
+    if(block != NULL) {
+        uintptr_t next = (uintptr_t) (block->data + block->used);
+        padding = (UTILS_ARENA_ALIGNMENT - (next % UTILS_ARENA_ALIGNMENT)) % UTILS_ARENA_ALIGNMENT;
+    }
+
+    if(block == NULL || block->size - block->used < size + padding) {
+        _utils_arena_grow(arena, size);
+        block = arena->blocks;
+
+        uintptr_t next = (uintptr_t) block->data;
+        padding = (UTILS_ARENA_ALIGNMENT - (next % UTILS_ARENA_ALIGNMENT)) % UTILS_ARENA_ALIGNMENT;
+    }
+
+    block->used += padding;
+
+    void* ptr = block->data + block->used;
+    block->used += size;
+
+    arena->num_allocs += 1;
+    arena->allocated_size += size;
+
+    return ptr;
+}
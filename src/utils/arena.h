@@ -0,0 +1,59 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// arena - Region allocator, everything allocated from an arena is freed at once with it
+
+// Allocations are carved out of big blocks, one after another, so allocating is just
+// moving a pointer forward most of the time. There is no way to free a single allocation,
+// the memory is given back only when the whole arena is destroyed, which does not need to
+// visit any of the objects allocated from it.
+//
+// This suits data which lives for a whole stage of the compilation, like the AST, where
+// everything is allocated piece by piece but thrown away all together.
+
+#ifndef _I_UTILS_ARENA_H_
+#define _I_UTILS_ARENA_H_
+
+#include <stddef.h>
+
+// Alignment of the allocations from utils_arena_alloc(), enough for any builtin C type
+#define UTILS_ARENA_ALIGNMENT 16
+
+struct utils_arena_block_t;
+
+struct utils_arena_t {
+    struct utils_arena_block_t* blocks; // Newest block first, allocations are made from it
+    size_t total_size;                  // Sum of the sizes of all the blocks
+    size_t num_allocs;                  // Number of allocations made from the arena
+    size_t allocated_size;              // Sum of their sizes, without the alignment
+};
+typedef struct utils_arena_t utils_arena_t;
+
+utils_arena_t* utils_arena_make();
+
+// Frees the arena with all the memory allocated from it
+void utils_arena_destroy(utils_arena_t* arena);
+
+// Returns size bytes of memory aligned to UTILS_ARENA_ALIGNMENT, which is valid until the arena is destroyed
+void* utils_arena_alloc(utils_arena_t* arena, size_t size);
+
+// Same as above, but without any alignment (for chars)
+void* utils_arena_alloc_bytes(utils_arena_t* arena, size_t size);
+
+// Allocates an object of the type from the arena
+#define UTILS_ARENA_NEW(arena, type) ((type*) utils_arena_alloc((arena), sizeof(type)))
+
+#endif
@@ -0,0 +1,43 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// diag - Stream for diagnostics (errors, warnings), which can be different for every thread
+
+#include "diag.h"
+
+#include <stdio.h>
+#include <pthread.h>
+
+// C99 has no thread local variables, so the stream is kept under a pthread key
+static pthread_key_t _diag_key;
+static pthread_once_t _diag_key_once = PTHREAD_ONCE_INIT;
+
+void _utils_diag_make_key() {
+    pthread_key_create(&_diag_key, NULL);
+}
+
+FILE* utils_diag_stream() {
+    pthread_once(&_diag_key_once, _utils_diag_make_key);
+
+    FILE* stream = pthread_getspecific(_diag_key);
+    return stream != NULL ? stream : stderr;
+}
+
+void utils_diag_set_stream(FILE* stream) {
+    pthread_once(&_diag_key_once, _utils_diag_make_key);
+
+    pthread_setspecific(_diag_key, stream);
+}
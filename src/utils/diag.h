@@ -0,0 +1,35 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// diag - Stream for diagnostics (errors, warnings), which can be different for every thread
+
+// All the stages report errors with fprintf(UTILS_DIAG, ...). It's stderr, unless a thread sets a stream
+// of its own, which is how diagnostics of many inputs compiled at once are kept apart from each other.
+
+#ifndef _I_UTILS_DIAG_H_
+#define _I_UTILS_DIAG_H_
+
+#include <stdio.h>
+
+// Returns the stream for the diagnostics of the calling thread
+FILE* utils_diag_stream();
+
+// Sets the stream for the diagnostics of the calling thread, NULL goes back to stderr
+void utils_diag_set_stream(FILE* stream);
+
+#define UTILS_DIAG (utils_diag_stream())
+
+#endif
@@ -0,0 +1,165 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// intern - Table of unique strings (identifiers), each stored once and referred to by an id
+
+#include "intern.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define DEFAULT_STRINGS_ALLOC 64
+#define DEFAULT_SLOTS_NUM 128
+
+utils_intern_table_t* utils_intern_table_make() {
+    utils_intern_table_t* t = malloc(sizeof(utils_intern_table_t));
+
+    t->num_strings = 0;
+    t->alloc_strings = DEFAULT_STRINGS_ALLOC;
+    t->strings = malloc(t->alloc_strings * sizeof(const char*));
+    t->lengths = malloc(t->alloc_strings * sizeof(uint32_t));
+    t->hashes = malloc(t->alloc_strings * sizeof(uint32_t));
+
+    t->num_slots = DEFAULT_SLOTS_NUM;
+    t->slots = malloc(t->num_slots * sizeof(utils_intern_id_t));
+    memset(t->slots, 0xFF, t->num_slots * sizeof(utils_intern_id_t)); // UTILS_INTERN_NONE everywhere
+
+    t->storage = utils_arena_make();
+
+    return t;
+}
+
+void utils_intern_table_destroy(utils_intern_table_t* t) {
+    if(t == NULL) return;
+
+    utils_arena_destroy(t->storage);
+    free(t->strings);
+    free(t->lengths);
+    free(t->hashes);
+    free(t->slots);
+    free(t);
+}
+
+uint32_t utils_intern_hash(const char* str, size_t length) {
+    uint32_t hash = UTILS_INTERN_HASH_INIT;
+
+    for(size_t i = 0; i < length; i++) {
+        hash = UTILS_INTERN_HASH_STEP(hash, str[i]);
+    }
+
+    return hash;
+}
+
+// Returns the slot which holds the string, or the empty slot where it should go
+size_t _utils_intern_probe(const utils_intern_table_t* t, const char* str, size_t length, uint32_t hash) {
+    size_t mask = t->num_slots - 1;
+    size_t slot = hash & mask;
+
+    while(1) {
+        utils_intern_id_t id = t->slots[slot];
+
+        if(id == UTILS_INTERN_NONE) return slot;
+
+        // Hash is compared first, so the contents are only compared for an actual match
+        if(t->hashes[id] == hash && t->lengths[id] == length && memcmp(t->strings[id], str, length) == 0) {
+            return slot;
+        }
+
+        slot = (slot + 1) & mask;
+    }
+}
+
+// Doubles the number of slots and puts every id back, using the stored hashes
+void _utils_intern_grow_slots(utils_intern_table_t* t) {
+    free(t->slots);
+
+    t->num_slots *= 2;
+    t->slots = malloc(t->num_slots * sizeof(utils_intern_id_t));
+    memset(t->slots, 0xFF, t->num_slots * sizeof(utils_intern_id_t));
+
+    size_t mask = t->num_slots - 1;
+    for(utils_intern_id_t id = 0; id < t->num_strings; id++) {
+        size_t slot = t->hashes[id] & mask;
+
+        while(t->slots[slot] != UTILS_INTERN_NONE) {
+            slot = (slot + 1) & mask;
+        }
+
+        t->slots[slot] = id;
+    }
+}
+
+utils_intern_id_t utils_intern_find(const utils_intern_table_t* t, const char* str, size_t length, uint32_t hash) {
+    return t->slots[_utils_intern_probe(t, str, length, hash)];
+}
+
+utils_intern_id_t utils_intern_string(utils_intern_table_t* t, const char* str, size_t length, uint32_t hash) {
+    size_t slot = _utils_intern_probe(t, str, length, hash);
+    if(t->slots[slot] != UTILS_INTERN_NONE) return t->slots[slot];
+
+    // New string, store a null-terminated copy
+    char* copy = utils_arena_alloc_bytes(t->storage, length + 1);
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+
+    if(t->num_strings >= t->alloc_strings) {
+        t->alloc_strings *= 2;
+        t->strings = realloc(t->strings, t->alloc_strings * sizeof(const char*));
+        t->lengths = realloc(t->lengths, t->alloc_strings * sizeof(uint32_t));
+        t->hashes = realloc(t->hashes, t->alloc_strings * sizeof(uint32_t));
+    }
+
+    utils_intern_id_t id = (utils_intern_id_t) t->num_strings;
+    t->strings[id] = copy;
+    t->lengths[id] = (uint32_t) length;
+    t->hashes[id] = hash;
+    t->num_strings += 1;
+
+    t->slots[slot] = id;
+
+    // Keep the table at most half full, so the probe sequences stay short
+    if(t->num_strings * 2 > t->num_slots) {
+        _utils_intern_grow_slots(t);
+    }
+
+    return id;
+}
+
+void utils_intern_table_pack(const utils_intern_table_t* t, utils_strbuf_t* blob, uint32_t* offsets) {
+    for(size_t id = 0; id < t->num_strings; id++) {
+        offsets[id] = (uint32_t) UTILS_STRBUF_LENGTH(blob);
+
+        // Including the null byte
+        utils_strbuf_append(blob, t->strings[id], t->lengths[id] + 1);
+    }
+}
+
+int utils_intern_table_unpack(utils_intern_table_t* t, const char* blob, size_t blob_length, const uint32_t* offsets, size_t num_strings) {
+    for(size_t i = 0; i < num_strings; i++) {
+        if(offsets[i] >= blob_length) return 1;
+
+        const char* str = blob + offsets[i];
+        const char* end = memchr(str, '\0', blob_length - offsets[i]);
+        if(end == NULL) return 1;
+
+        size_t length = (size_t) (end - str);
+        if(utils_intern_string(t, str, length, utils_intern_hash(str, length)) != (utils_intern_id_t) i) return 1;
+    }
+
+    // Strings interned before, which are not in the blob, would get in the way of the ids too
+    return t->num_strings != num_strings;
+}
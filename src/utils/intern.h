@@ -0,0 +1,86 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// intern - Table of unique strings (identifiers), each stored once and referred to by an id
+
+// Every distinct string is copied into the table exactly once, null-terminated, and gets a small
+// integer id (ids are assigned in order, starting from 0). Interning the same contents again
+// returns the same id, and the stored copy never moves, so two interned strings can be compared
+// by id or by pointer instead of by contents.
+//
+// Lookups take a precomputed hash of the string, so that the lexer can compute it while it is
+// reading the identifier anyway (see the UTILS_INTERN_HASH_ macros).
+
+#ifndef _I_UTILS_INTERN_H_
+#define _I_UTILS_INTERN_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "strbuf.h"
+
+typedef uint32_t utils_intern_id_t;
+
+// Id which no string ever gets, used for "not interned" or "not found"
+#define UTILS_INTERN_NONE ((utils_intern_id_t) UINT32_MAX)
+
+// FNV-1a, one byte at a time
+#define UTILS_INTERN_HASH_INIT ((uint32_t) 2166136261u)
+#define UTILS_INTERN_HASH_STEP(hash, c) (((hash) ^ (uint32_t) (unsigned char) (c)) * (uint32_t) 16777619u)
+
+struct utils_intern_table_t {
+    size_t num_strings;
+    size_t alloc_strings;
+    const char** strings;       // Stored copy of every string, indexed by id
+    uint32_t* lengths;          // Length of every string
+    uint32_t* hashes;           // Hash of every string, so that the slots can be rebuilt without rehashing
+
+    size_t num_slots;           // Always a power of 2
+    utils_intern_id_t* slots;   // Open addressing hash table of ids, UTILS_INTERN_NONE if empty
+
+    utils_arena_t* storage;     // Storage for the copies, they are freed all at once with the table
+};
+typedef struct utils_intern_table_t utils_intern_table_t;
+
+utils_intern_table_t* utils_intern_table_make();
+void utils_intern_table_destroy(utils_intern_table_t* t);
+
+// Hash of length chars at str, same as the one computed with the UTILS_INTERN_HASH_ macros
+uint32_t utils_intern_hash(const char* str, size_t length);
+
+// Returns the id of the string, adding it to the table if it is not there yet
+// The string does not have to be null-terminated, hash must be utils_intern_hash(str, length)
+utils_intern_id_t utils_intern_string(utils_intern_table_t* t, const char* str, size_t length, uint32_t hash);
+
+// Returns the id of the string, or UTILS_INTERN_NONE if it was never interned
+// Does not modify the table
+utils_intern_id_t utils_intern_find(const utils_intern_table_t* t, const char* str, size_t length, uint32_t hash);
+
+// Appends all the strings to blob, null-terminated and in the order of ids, and stores the offset of
+// every one of them in offsets (which needs room for num_strings elements)
+void utils_intern_table_pack(const utils_intern_table_t* t, utils_strbuf_t* blob, uint32_t* offsets);
+
+// Interns num_strings packed strings in order, so that the string at offsets[i] gets the id i
+// The table may already hold a prefix of them (like the names of builtin types), but nothing else
+// Return value: 0 if ok, 1 if the strings are not null-terminated within the blob or the ids do not match
+int utils_intern_table_unpack(utils_intern_table_t* t, const char* blob, size_t blob_length, const uint32_t* offsets, size_t num_strings);
+
+// Null-terminated stored copy of the string with the given id, valid until the table is destroyed
+#define UTILS_INTERN_GET(t, id) ((t)->strings[id])
+#define UTILS_INTERN_LENGTH(t, id) ((size_t) (t)->lengths[id])
+
+#endif
@@ -0,0 +1,86 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// strbuf - Growable buffer of chars, used to build strings piece by piece
+
+#include "strbuf.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_STRBUF_ALLOC 64
+
+void utils_strbuf_init(utils_strbuf_t* buf) {
+    buf->length = 0;
+    buf->alloc = 0;
+    buf->data = NULL;
+}
+
+void utils_strbuf_deinit(utils_strbuf_t* buf) {
+    free(buf->data);
+    utils_strbuf_init(buf);
+}
+
+void utils_strbuf_reserve(utils_strbuf_t* buf, size_t length) {
+    size_t needed = buf->length + length + 1;
+    if(needed <= buf->alloc) return;
+
+    size_t alloc = buf->alloc != 0 ? buf->alloc : DEFAULT_STRBUF_ALLOC;
+    while(alloc < needed) alloc *= 2;
+
+    buf->data = realloc(buf->data, alloc);
+    buf->alloc = alloc;
+}
+
+void utils_strbuf_append(utils_strbuf_t* buf, const char* str, size_t length) {
+    utils_strbuf_reserve(buf, length);
+
+    memcpy(buf->data + buf->length, str, length);
+    buf->length += length;
+    buf->data[buf->length] = '\0';
+}
+
+void utils_strbuf_append_cstr(utils_strbuf_t* buf, const char* str) {
+    utils_strbuf_append(buf, str, strlen(str));
+}
+
+void utils_strbuf_append_char(utils_strbuf_t* buf, char c) {
+    utils_strbuf_reserve(buf, 1);
+
+    buf->data[buf->length] = c;
+    buf->length += 1;
+    buf->data[buf->length] = '\0';
+}
+
+void utils_strbuf_clear(utils_strbuf_t* buf) {
+    buf->length = 0;
+    if(buf->data != NULL) buf->data[0] = '\0';
+}
+
+void utils_strbuf_flush(utils_strbuf_t* buf, FILE* outfile) {
+    if(buf->length != 0) fwrite(buf->data, 1, buf->length, outfile);
+    utils_strbuf_clear(buf);
+}
+
+char* utils_strbuf_release(utils_strbuf_t* buf) {
+    // Even an empty buffer gives a valid string
+    if(buf->data == NULL) utils_strbuf_reserve(buf, 0);
+    buf->data[buf->length] = '\0';
+
+    char* data = buf->data;
+    utils_strbuf_init(buf);
+    return data;
+}
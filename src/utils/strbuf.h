@@ -0,0 +1,57 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// strbuf - Growable buffer of chars, used to build strings piece by piece
+
+// The contents are always null-terminated (once anything was appended), so they can be
+// used as a regular C string. Appending is amortized O(1), the buffer doubles when full.
+
+#ifndef _I_UTILS_STRBUF_H_
+#define _I_UTILS_STRBUF_H_
+
+#include <stddef.h>
+#include <stdio.h>
+
+struct utils_strbuf_t {
+    size_t length; // Without the null byte
+    size_t alloc;
+    char* data; // NULL until something is appended
+};
+typedef struct utils_strbuf_t utils_strbuf_t;
+
+void utils_strbuf_init(utils_strbuf_t* buf);
+void utils_strbuf_deinit(utils_strbuf_t* buf);
+
+// Makes sure that length more chars (and the null byte) fit without growing
+void utils_strbuf_reserve(utils_strbuf_t* buf, size_t length);
+
+void utils_strbuf_append(utils_strbuf_t* buf, const char* str, size_t length);
+void utils_strbuf_append_cstr(utils_strbuf_t* buf, const char* str);
+void utils_strbuf_append_char(utils_strbuf_t* buf, char c);
+
+// Empties the buffer, the memory is kept for reuse
+void utils_strbuf_clear(utils_strbuf_t* buf);
+
+// Writes the contents to the file and empties the buffer
+void utils_strbuf_flush(utils_strbuf_t* buf, FILE* outfile);
+
+// Returns the contents, the buffer is left empty and the caller has to free() them
+char* utils_strbuf_release(utils_strbuf_t* buf);
+
+#define UTILS_STRBUF_LENGTH(buf) ((buf)->length)
+#define UTILS_STRBUF_DATA(buf) ((buf)->data)
+
+#endif
@@ -0,0 +1,146 @@
+// decrout - declare routine - language one level above assembly
+// Copyright (C) 2023  Maciej Sawka <maciejsawka@gmail.com> <msaw328@kretes.xyz>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// vec - macros which declare/implement a dynamic array storing elements by value (emulating generics)
+
+#ifndef _I_UTILS_VEC_H_
+#define _I_UTILS_VEC_H_
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A vec holds the elements themselves in one contiguous array, grown with realloc,
+// not pointers to separately allocated elements.
+//
+// The vec structure is meant to be embedded in other structures or live on the stack,
+// it is set up with <type_prefix>_vec_init() and its array freed with <type_prefix>_vec_deinit().
+//
+// A small vec additionally has room for inline_size elements inside of the structure itself,
+// so short vecs (like args of a routine) never allocate at all. Since arr points into the
+// structure then, a small vec must not be copied or moved while in use.
+//
+// Pointers to the elements are only valid until the vec grows.
+//
+// Whenever a vec of a certain type is needed, one of the declaration macros should be used in the
+// header file and the matching implementation macro in the source file.
+#define UTILS_VEC_MAKE_DECLARATION(type_prefix, inner_type) \
+    struct type_prefix##_vec_t {    \
+        size_t num_elements;        \
+        size_t alloc_elements;      \
+        inner_type* arr;            \
+    };                              \
+    _UTILS_VEC_MAKE_PROTOTYPES(type_prefix, inner_type)
+
+#define UTILS_VEC_MAKE_SMALL_DECLARATION(type_prefix, inner_type, inline_size) \
+    struct type_prefix##_vec_t {    \
+        size_t num_elements;        \
+        size_t alloc_elements;      \
+        inner_type* arr;            \
+        inner_type inline_arr[inline_size]; \
+    };                              \
+    _UTILS_VEC_MAKE_PROTOTYPES(type_prefix, inner_type)
+
+#define _UTILS_VEC_MAKE_PROTOTYPES(type_prefix, inner_type) \
+    typedef struct type_prefix##_vec_t type_prefix##_vec_t; \
+    void type_prefix##_vec_init(type_prefix##_vec_t* v);   \
+    void type_prefix##_vec_deinit(type_prefix##_vec_t* v); \
+    void type_prefix##_vec_reserve(type_prefix##_vec_t* v, size_t num_elements); \
+    void type_prefix##_vec_push(type_prefix##_vec_t* v, inner_type elem); \
+    void type_prefix##_vec_append(type_prefix##_vec_t* v, const inner_type* elems, size_t num_elems); \
+    inner_type type_prefix##_vec_pop(type_prefix##_vec_t* v); \
+    void type_prefix##_vec_truncate(type_prefix##_vec_t* v, size_t num_elements);
+
+// Implementation details:
+// vec_init() sets up an empty vec, which does not allocate anything until the first element is added
+// (a small one has room for inline_size elements before that)
+// vec_reserve() makes sure that there is room for at least num_elements elements in total, so that
+// a known (or estimated) number of elements can be added without growing the array many times
+// the default grow strategy is to increase the capacity 2x, starting from default_size
+// vec_push() copies the element into the vec, vec_append() copies num_elems elements at once
+// vec_pop() removes the last element and returns it, the vec must not be empty
+// vec_truncate() drops all the elements past the first num_elements, capacity stays the same
+// There is no cleanup callback - elements which own something have to be cleaned up by the owner of the vec
+#define UTILS_VEC_MAKE_IMPLEMENTATION(type_prefix, inner_type, default_size) \
+    void type_prefix##_vec_init(type_prefix##_vec_t* v) {  \
+        v->num_elements = 0;    \
+        v->alloc_elements = 0;  \
+        v->arr = NULL;  \
+    }   \
+    _UTILS_VEC_MAKE_COMMON_IMPLEMENTATION(type_prefix, inner_type, default_size, 0, NULL)
+
+#define UTILS_VEC_MAKE_SMALL_IMPLEMENTATION(type_prefix, inner_type, default_size) \
+    void type_prefix##_vec_init(type_prefix##_vec_t* v) {  \
+        v->num_elements = 0;    \
+        v->alloc_elements = sizeof(v->inline_arr) / sizeof(v->inline_arr[0]); \
+        v->arr = v->inline_arr; \
+    }   \
+    _UTILS_VEC_MAKE_COMMON_IMPLEMENTATION(type_prefix, inner_type, default_size, 1, v->inline_arr)
+
+// inline_arr is the expression for the inline storage of v (NULL if there is none, then has_inline is 0)
+#define _UTILS_VEC_MAKE_COMMON_IMPLEMENTATION(type_prefix, inner_type, default_size, has_inline, inline_arr) \
+    void type_prefix##_vec_deinit(type_prefix##_vec_t* v) {    \
+        if(v->arr != inline_arr) free(v->arr);   \
+        v->num_elements = 0;    \
+    }   \
+    \
+    void type_prefix##_vec_reserve(type_prefix##_vec_t* v, size_t num_elements) {  \
+        if(num_elements <= v->alloc_elements) return;   \
+        size_t alloc_elements = v->alloc_elements != 0 ? v->alloc_elements : (size_t) default_size; \
+        while(alloc_elements < num_elements) alloc_elements *= 2;   \
+        if(has_inline && v->arr == inline_arr) {   \
+            inner_type* new_arr = malloc(alloc_elements * sizeof(inner_type));  \
+            if(v->num_elements != 0) memcpy(new_arr, v->arr, v->num_elements * sizeof(inner_type));  \
+            v->arr = new_arr;   \
+        } else {    \
+            v->arr = realloc(v->arr, alloc_elements * sizeof(inner_type));  \
+        }   \
+        v->alloc_elements = alloc_elements; \
+    }   \
+    \
+    void type_prefix##_vec_push(type_prefix##_vec_t* v, inner_type elem) { \
+        if(v->num_elements >= v->alloc_elements) {  \
+            type_prefix##_vec_reserve(v, v->num_elements + 1);  \
+        }   \
+        v->arr[v->num_elements] = elem; \
+        v->num_elements += 1;   \
+    }   \
+    \
+    void type_prefix##_vec_append(type_prefix##_vec_t* v, const inner_type* elems, size_t num_elems) {  \
+        if(num_elems == 0) return;  \
+        type_prefix##_vec_reserve(v, v->num_elements + num_elems);  \
+        memcpy(v->arr + v->num_elements, elems, num_elems * sizeof(inner_type));  \
+        v->num_elements += num_elems;   \
+    }   \
+    \
+    inner_type type_prefix##_vec_pop(type_prefix##_vec_t* v) { \
+        v->num_elements -= 1;   \
+        return v->arr[v->num_elements]; \
+    }   \
+    \
+    void type_prefix##_vec_truncate(type_prefix##_vec_t* v, size_t num_elements) { \
+        if(num_elements < v->num_elements) v->num_elements = num_elements;   \
+    }
+
+#define UTILS_VEC_LENGTH(vec_ptr) ((vec_ptr)->num_elements)
+
+// Element at index, without any checks (for iteration)
+#define UTILS_VEC_AT(vec_ptr, index) ((vec_ptr)->arr[index])
+
+// Pointer to the element at index, or NULL if out of range
+#define UTILS_VEC_GET(vec_ptr, index) (((index) < (vec_ptr)->num_elements) ? &((vec_ptr)->arr[index]) : NULL)
+
+#endif